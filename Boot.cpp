@@ -0,0 +1,45 @@
+/*
+ * Definition of the boot timeline
+ */
+
+#include "Boot.h"
+
+
+unsigned long bootTimes[BOOT_PHASES];       // Time each boot phase has been reached; unit: ms since power-on
+bool bootReached[BOOT_PHASES];              // Boot phase has been reached
+
+
+// Record time a boot phase has been reached
+void bootMark(byte phase) {
+  // I want to check if boot phase is reached the first time, e. g. not after a reconnection
+  if (phase >= BOOT_PHASES || bootReached[phase]) {
+    return;
+  }
+
+  bootTimes[phase] = millis();
+  bootReached[phase] = true;
+
+  #ifdef DEBUG
+    // I want to check if booting is complete
+    if (phase == BOOT_ACQUIRED) {
+      bootPrint(Serial);
+    }
+  #endif
+}
+
+// Print time of each boot phase reached
+void bootPrint(Print &out) {
+  static const char* phaseTxt[BOOT_PHASES] = { "setup", "hardware", "WiFi", "WiThrottle server", "roster", "loco acquired" };
+                                            // Boot phase as a text
+  unsigned long last = 0;                   // Time previous boot phase has been reached
+
+  out.println("Boot timeline:");
+  out.printf("  %-18s %6lu ms\n", "power-on", 0UL);
+  for (byte phase = 0; phase < BOOT_PHASES; phase++) {
+    // I want to check if boot phase has been reached
+    if (bootReached[phase]) {
+      out.printf("  %-18s %6lu ms (+%lu ms)\n", phaseTxt[phase], bootTimes[phase], bootTimes[phase] - last);
+      last = bootTimes[phase];
+    }
+  }
+}
@@ -0,0 +1,29 @@
+/*
+ * Declaration of the boot timeline
+ *
+ * The time each phase of booting is reached is recorded once, so the
+ * critical path from power-on to a drivable loco can be followed. The
+ * timeline is printed as soon as the first loco has been acquired.
+ */
+
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+#include "CrossFunc.h"
+#include <Arduino.h>
+
+
+// Boot phases
+#define BOOT_SETUP          0               // Setup entered, i. e. core started
+#define BOOT_HARDWARE       1               // Buttons, speed input, display and EEPROM initialized
+#define BOOT_WIFI           2               // Connected to WiFi
+#define BOOT_JMRI           3               // Connected to WiThrottle server
+#define BOOT_ROSTER         4               // Roster received
+#define BOOT_ACQUIRED       5               // First loco acquired, i. e. drivable
+#define BOOT_PHASES         6               // Number of boot phases
+
+
+// Boot timeline
+void bootMark(byte phase);                  // Record time a boot phase has been reached; only the first time counts
+void bootPrint(Print &out);                 // Print time of each boot phase reached
+#endif
@@ -0,0 +1,153 @@
+/*
+ * Definition of the protocol capture
+ */
+
+#include "Capture.h"
+
+
+// Structures
+
+// Header of a record in the ring buffer
+typedef struct {
+  uint32_t time;                            // Timestamp; unit: ms
+  uint16_t length;                          // Bytes of data following the header
+  char direction;                           // CAPTURE_SENT or CAPTURE_RECEIVED
+  bool isCut;                               // Data has been cut off at CAPTURE_DATA_MAX
+} captureHeader;
+
+
+// Ring buffer
+uint8_t captureRing[CAPTURE_SIZE];          // Records, each a header followed by its data
+unsigned int captureHead = 0;               // Start of oldest record
+unsigned int captureUsed = 0;               // Bytes of ring buffer in use
+unsigned int captureCount = 0;              // Number of records in ring buffer
+unsigned long captureDropped = 0;           // Records overwritten since last dump
+Print* captureTraceOut = NULL;              // Records are written here as soon as recorded; NULL if tracing is off
+
+
+// Copy bytes into ring buffer at <position>
+void captureWrite(unsigned int position, const void* data, unsigned int length) {
+  unsigned int first = min(length, CAPTURE_SIZE - position);
+                                            // Bytes fitting in before end of ring buffer
+
+  memcpy(captureRing + position, data, first);
+  memcpy(captureRing, (const uint8_t*)data + first, length - first);
+}
+
+// Copy bytes out of ring buffer at <position>
+void captureRead(unsigned int position, void* data, unsigned int length) {
+  unsigned int first = min(length, CAPTURE_SIZE - position);
+                                            // Bytes available before end of ring buffer
+
+  memcpy(data, captureRing + position, first);
+  memcpy((uint8_t*)data + first, captureRing, length - first);
+}
+
+// Remove oldest record from ring buffer
+void captureDropOldest() {
+  captureHeader header;                     // Header of oldest record
+
+  captureRead(captureHead, &header, sizeof(header));
+  captureHead = (captureHead + sizeof(header) + header.length) % CAPTURE_SIZE;
+  captureUsed -= sizeof(header) + header.length;
+  captureCount--;
+  captureDropped++;
+}
+
+// Write record at <position> as a line of text trace; returns start of next record
+unsigned int capturePrint(Print &out, unsigned int position) {
+  captureHeader header;                     // Header of record
+  uint8_t c;                                // Actual byte of data
+
+  captureRead(position, &header, sizeof(header));
+  position = (position + sizeof(header)) % CAPTURE_SIZE;
+
+  out.printf("%lu %c \"", (unsigned long)header.time, header.direction);
+  for (unsigned int i = 0; i < header.length; i++) {
+    c = captureRing[position];
+    position = (position + 1) % CAPTURE_SIZE;
+
+    // I want to check if byte has to be escaped
+    if (c == '\r') {
+      out.print("\\r");
+    }
+    else if (c == '\n') {
+      out.print("\\n");
+    }
+    else if (c == '\\' || c == '"') {
+      out.print('\\');
+      out.print((char)c);
+    }
+    else if (c < 0x20 || c >= 0x7f) {
+      out.printf("\\x%02x", c);
+    }
+    else {
+      out.print((char)c);
+    }
+  }
+  out.println(header.isCut ? "\" # cut" : "\"");
+
+  return position;
+}
+
+
+// Capture
+
+// Record data written to or read from WiThrottle server
+void captureData(char direction, const void* data, unsigned int length) {
+  captureHeader header;                     // Header of record
+  unsigned int position;                    // Start of new record
+
+  // I want to check if there is anything to record
+  if (length == 0) {
+    return;
+  }
+
+  header.time = millis();
+  header.length = min(length, (unsigned int)CAPTURE_DATA_MAX);
+  header.direction = direction;
+  header.isCut = length > CAPTURE_DATA_MAX;
+
+  // Make room by overwriting the oldest records
+  while (captureUsed + sizeof(header) + header.length > CAPTURE_SIZE) {
+    captureDropOldest();
+  }
+
+  position = (captureHead + captureUsed) % CAPTURE_SIZE;
+  captureWrite(position, &header, sizeof(header));
+  captureWrite((position + sizeof(header)) % CAPTURE_SIZE, data, header.length);
+  captureUsed += sizeof(header) + header.length;
+  captureCount++;
+
+  // I want to check if records are traced
+  if (captureTraceOut != NULL) {
+    capturePrint(*captureTraceOut, position);
+  }
+}
+
+// Write all records as text trace
+void captureDump(Print &out) {
+  unsigned int position = captureHead;      // Start of actual record
+
+  out.println("# WiThrottle capture v1");
+  out.printf("# %u records, %lu older records overwritten, now %lu ms\n", captureCount, captureDropped, (unsigned long)millis());
+
+  for (unsigned int record = 0; record < captureCount; record++) {
+    position = capturePrint(out, position);
+  }
+
+  captureDropped = 0;
+}
+
+// Write each record as soon as it is recorded
+void captureTrace(Print* out) {
+  captureTraceOut = out;
+}
+
+// Discard all records
+void captureClear() {
+  captureHead = 0;
+  captureUsed = 0;
+  captureCount = 0;
+  captureDropped = 0;
+}
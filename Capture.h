@@ -0,0 +1,49 @@
+/*
+ * Declaration of the protocol capture
+ *
+ * Everything written to and read from WiThrottle server is recorded with
+ * a timestamp in a ring buffer in RAM, so the traffic leading to a
+ * misbehaviour can be analysed afterwards. Each record holds the bytes
+ * of one write or read on the socket as they are; recording costs a
+ * header and a memcpy, so capturing stays on in production.
+ *
+ * captureDump() writes the records as a text trace, one record per line:
+ *
+ *   # WiThrottle capture v1
+ *   <time> <direction> "<data>"
+ *
+ * <time> is in ms since boot, <direction> is '>' for data sent and '<'
+ * for data received, <data> is C escaped (\r, \n, \\, \" and \xHH for
+ * other unprintable bytes). Lines starting with '#' are comments.
+ *
+ * captureTrace() additionally writes each record in the same format as
+ * soon as it is recorded, e. g. to watch the traffic on the console.
+ */
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include "Clock.h"
+#include <Arduino.h>
+
+
+// Capture
+#define CAPTURE_SIZE     8192               // Size of ring buffer; the oldest records are overwritten
+#define CAPTURE_DATA_MAX 1024               // Data recorded per record at most; the rest is cut off
+
+// Directions
+#define CAPTURE_SENT      '>'               // Data written to WiThrottle server
+#define CAPTURE_RECEIVED  '<'               // Data read from WiThrottle server
+
+
+// Capture
+/*
+ * Records are written and read by the loop task only, so the ring
+ * buffer needs no locking.
+ */
+void captureData(char direction, const void* data, unsigned int length);
+                                            // Record data written to or read from WiThrottle server
+void captureDump(Print &out);               // Write all records as text trace
+void captureClear();                        // Discard all records
+void captureTrace(Print* out);              // Write each record as soon as it is recorded; NULL turns tracing off
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Definition of the virtual clock
+ */
+
+#include "Clock.h"
+
+#ifdef VIRTUAL_TIME
+  uint64_t virtualTime = 0;                 // Virtual time passed since start; unit: us
+
+
+  // Read virtual clock
+  uint32_t virtualMillis() {
+    virtualTime += VIRTUAL_TIME_STEP;
+
+    // Wraps around at 32 bit like the hardware timer
+    return VIRTUAL_TIME_START + (uint32_t)(virtualTime / 1000);
+  }
+
+  // Read virtual clock
+  uint32_t virtualMicros() {
+    virtualTime += VIRTUAL_TIME_STEP;
+
+    // Wraps around at 32 bit like the hardware timer
+    return VIRTUAL_MICROS_START + (uint32_t)virtualTime;
+  }
+
+  // Advance virtual clock instead of waiting
+  void virtualDelay(unsigned long ms) {
+    virtualTime += (uint64_t)ms * 1000;
+  }
+
+  // Advance virtual clock
+  void virtualAdvance(uint64_t us) {
+    virtualTime += us;
+  }
+#endif
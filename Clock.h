@@ -0,0 +1,47 @@
+/*
+ * Declaration of the virtual clock
+ *
+ * If VIRTUAL_TIME is defined, millis(), micros() and delay() of all
+ * sources including this header refer to a virtual clock instead of the
+ * hardware timer. Virtual time only advances by delay(), by waiting idle
+ * between loop passes, by virtualAdvance() and by VIRTUAL_TIME_STEP on
+ * each reading, so waiting loops still make progress.
+ *
+ * Timing logic, e. g. heartbeat, notch timeout, long press of buttons,
+ * error blinking and fast clock, then runs as fast as the CPU allows:
+ * hours of an operating session pass in seconds. millis() and micros()
+ * start shortly before they wrap around, so the wraparound is passed in
+ * every run. They return uint32_t and wrap at 32 bit like the hardware
+ * timer on the handset, also on hosts with 64 bit long; timestamps are
+ * kept in uint32_t for the same reason, so differences of them wrap
+ * alike. Given the same inputs, a run is reproducible as long as all
+ * code reading the clock runs in a single thread, i. e. on a host.
+ */
+
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#include <Arduino.h>
+
+
+// Turn on virtual clock for simulation of timing logic
+//#define VIRTUAL_TIME
+
+#ifdef VIRTUAL_TIME
+  #define VIRTUAL_TIME_START ((uint32_t)0 - 65536)
+                                            // Start of millis(), about 65 s before it wraps around; unit: ms
+  #define VIRTUAL_MICROS_START ((uint32_t)0 - 65536000)
+                                            // Start of micros(), about 65 s before it wraps around; unit: us
+  #define VIRTUAL_TIME_STEP   1             // Time passing each time the clock is read; unit: us
+
+  // Virtual clock
+  uint32_t virtualMillis();                 // Read virtual clock; unit: ms
+  uint32_t virtualMicros();                 // Read virtual clock; unit: us
+  void virtualDelay(unsigned long ms);      // Advance virtual clock instead of waiting
+  void virtualAdvance(uint64_t us);         // Advance virtual clock, e. g. by a simulation driving WiThrottle
+
+  #define millis() virtualMillis()
+  #define micros() virtualMicros()
+  #define delay(ms) virtualDelay(ms)
+#endif
+#endif
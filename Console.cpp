@@ -0,0 +1,183 @@
+/*
+ * Definition of the serial console
+ */
+
+#include "Console.h"
+#include "Boot.h"
+#include "Capture.h"
+#include "LocoCache.h"
+#include "Log.h"
+
+
+// Constructor
+Console::Console(WiThrottle &throttle, PowerManager &power) : throttle(throttle), power(power) {
+  line[0] = '\0';
+}
+
+
+// Console operation
+
+// Collect input received since last call
+void Console::loop() {
+  char c;                                   // Character received
+
+  // I want to check if loco has been acquired since prompt has been shown
+  if (throttle.loco[0].getAcquired()) {
+    prompted = false;
+  }
+
+  // Only the bytes already received are read, so the loop pass never waits for input
+  while (Serial.available() > 0) {
+    c = Serial.read();
+
+    // I want to check if line is complete
+    if (c == '\r' || c == '\n') {
+      // Ignore empty lines, e. g. LF of CR LF
+      if (length > 0 || isCut) {
+        line[length] = '\0';
+        execute();
+      }
+      length = 0;
+      isCut = false;
+    }
+    else if (c == CONSOLE_BACKSPACE || c == CONSOLE_DELETE) {
+      if (length > 0) {
+        length--;
+      }
+    }
+    else if (length < CONSOLE_LINE_SIZE - 1) {
+      line[length++] = c;
+    }
+    else {
+      isCut = true;
+    }
+  }
+}
+
+// Ask for DCC address once while no loco is acquired
+void Console::prompt() {
+  if (!prompted) {
+    Serial.println("Please enter DCC address.");
+    prompted = true;
+  }
+}
+
+// Execute line typed
+void Console::execute() {
+  unsigned long address;                    // DCC address of loco
+  bool isValidAddress;                      // True if line is a valid DCC address
+  locoCacheEntry cached;                    // Loco driven recently
+
+  LOG_DEBUG("Console: %s", line);
+
+  // I want to check if line has been too long for any command
+  if (isCut) {
+    Serial.println("Input is too long.");
+    return;
+  }
+
+  // I want to check if line is a DCC address
+  if (isDigit(line[0])) {
+    // I want to check if each digit of the input is numeric
+    isValidAddress = length <= 5;
+    for (byte i = 0; i < length; i++) {
+      isValidAddress = isDigit(line[i]) && isValidAddress;
+    }
+
+    // I want to check if input is in extended DCC address range (1 to 10239)
+    address = strtoul(line, NULL, 10);
+    if (isValidAddress && address > 0 && address <= 10239) {
+      acquire(address, address > 127 ? 'L' : 'S', NULL);
+    }
+    else {
+      Serial.printf("%s is not a valid DCC address.\nValid DCC addresses are from 1 to 10239.\n", line);
+    }
+  }
+  else if (strncmp(line, "loco ", 5) == 0) {
+    acquire(0, 'S', line + 5);
+  }
+  else if (strcmp(line, "stats") == 0) {
+    // I want to check if any command has been sent since last report
+    if (!printCmdStats(Serial)) {
+      Serial.println("No commands sent since last report.");
+    }
+    throttle.printConnectionStats(Serial);
+    power.printStats(Serial);
+    bootPrint(Serial);
+    Serial.printf("Acquisition took %lu ms, at most %lu ms.\n",
+      throttle.loco[0].getAcquireTime(), throttle.loco[0].getAcquireTimeMax());
+  }
+  else if (strcmp(line, "recent") == 0) {
+    locoCachePrint(Serial);
+  }
+  else if (strncmp(line, "recent ", 7) == 0) {
+    // I want to check if number is the one of a loco driven recently
+    if (locoCacheGet(atoi(line + 7) - 1, cached)) {
+      acquire(cached.address, cached.addressType, NULL);
+    }
+    else {
+      Serial.printf("%s is not a number of a recently driven loco.\n", line + 7);
+    }
+  }
+  else if (strcmp(line, "dump") == 0) {
+    captureDump(Serial);
+  }
+  else if (strcmp(line, "trace") == 0) {
+    tracing = !tracing;
+    captureTrace(tracing ? &Serial : NULL);
+    Serial.println(tracing ? "Trace on." : "Trace off.");
+  }
+  else {
+    Serial.println("Commands: <DCC address>, loco <ID>, recent [<number>], stats, dump, trace, help");
+  }
+}
+
+// Acquire loco by address type and DCC address or by ID of roster
+void Console::acquire(unsigned int address, char addressType, const char* id) {
+  unsigned int first;                       // First roster entry starting with ID
+  unsigned int count;                       // Number of roster entries starting with ID
+  unsigned int entry = ROSTER_MAX;          // Roster entry matching ID; ROSTER_MAX if loco is selected by DCC address
+
+  // I want to check if WiThrottle is ready for operation
+  if (throttle.getConnectionState() != CONN_READY) {
+    Serial.println("WiThrottle is not connected to WiThrottle server.");
+    return;
+  }
+
+  // I want to check if another loco is being acquired
+  if (throttle.loco[0].getAcquiring()) {
+    Serial.println("A loco is being acquired.");
+    return;
+  }
+
+  // I want to check if loco is selected by ID
+  if (id != NULL) {
+    count = throttle.roster.find(id, first);
+
+    // I want to check which of the entries starting with ID matches exactly
+    for (unsigned int i = first; i < first + count; i++) {
+      if (strcmp(id, throttle.roster.getId(i)) == 0) {
+        entry = i;
+        break;
+      }
+    }
+
+    // I want to check if ID is in roster
+    if (entry == ROSTER_MAX) {
+      Serial.printf("%s is not in roster.\n", id);
+      return;
+    }
+  }
+
+  // Active loco is dispatched in favour of the new one at once, so the new one can be selected
+  throttle.loco[0].dispatch();
+
+  // Try to acquire loco; DCC address is kept once WiThrottle server has confirmed it
+  if (entry < ROSTER_MAX) {
+    throttle.loco[0].select(throttle.roster, entry);
+  }
+  else {
+    throttle.loco[0].select(address, addressType, true);
+  }
+  throttle.loco[0].acquire();
+}
@@ -0,0 +1,61 @@
+/*
+ * Declaration of the serial console
+ *
+ * Input from serial monitor is collected byte by byte on every loop
+ * pass, so the throttle keeps running while a line is being typed. A
+ * line ends with CR or LF; backspace removes the last character.
+ *
+ * Commands:
+ *
+ *   <address>   Acquire loco by DCC address (1 to 10239)
+ *   loco <id>   Acquire loco of roster by ID
+ *   stats       Print statistics of commands, reconnections and power, boot timeline and acquisition time
+ *   recent      List locos driven recently, numbered, most recently used first
+ *   recent <n>  Acquire loco number <n> of the list by its address type and DCC address
+ *   dump        Write protocol capture as text trace
+ *   trace       Turn writing each record of protocol capture on or off
+ *   help        List commands
+ */
+
+#ifndef _CONSOLE_H_
+#define _CONSOLE_H_
+
+#include "CrossFunc.h"
+#include "Power.h"
+#include "WiThrottle.h"
+#include <Arduino.h>
+
+
+// Console
+#define CONSOLE_LINE_SIZE  48               // Maximum length of a line incl. terminating '\0'
+#define CONSOLE_BACKSPACE  0x08             // Removes last character
+#define CONSOLE_DELETE     0x7F             // Removes last character; sent by most terminals for backspace
+
+class Console {
+  private:
+    // WiThrottle
+    WiThrottle &throttle;                   // WiThrottle operated by the console
+    PowerManager &power;                    // Power manager reporting its statistics
+
+    // Line editor
+    char line[CONSOLE_LINE_SIZE];           // Line being typed
+    byte length = 0;                        // Length of <line>
+    bool isCut = false;                     // Line has been longer than CONSOLE_LINE_SIZE - 1
+
+    // Console state
+    bool prompted = false;                  // Prompt for DCC address has been shown since loco has been acquired
+    bool tracing = false;                   // Protocol capture is traced
+
+    void execute();                         // Execute line typed
+    void acquire(unsigned int address, char addressType, const char* id);
+                                            // Acquire loco by address type and DCC address or by ID of roster
+
+  public:
+    // Constructor
+    Console(WiThrottle &throttle, PowerManager &power);
+
+    // Console operation
+    void loop();                            // Collect input received since last call; executed every loop pass
+    void prompt();                          // Ask for DCC address once while no loco is acquired
+};
+#endif
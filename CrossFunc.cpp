@@ -3,15 +3,8 @@
  */
 
 #include "CrossFunc.h"
-#include "Symbols.h"
-
-#ifdef HL_DISP
-  #include <Adafruit_GFX.h>
-  #include <Adafruit_SSD1306.h>
-
-  // I2C OLED display
-  Adafruit_SSD1306 display(OLED_WIDTH, OLED_HEIGHT, &Wire, OLED_RESET);
-#endif
+#include "Capture.h"
+#include "Log.h"
 
 // WiFi
 
@@ -29,46 +22,337 @@ WiFiClient client;                      // This throttle's WiFi client
 
 // WiThrottle server settings
 hostConfig hostSettings {
-  (char*)"0.0.0.0",
-  12090,
+  {
+    { (char*)"0.0.0.0", 12090 },            // Primary WiThrottle server
+    { (char*)"0.0.0.0", 12090 }             // Standby WiThrottle server
+  },
   2,
   (char*)"",
   0
 };
 
-unsigned long lastHeartbeat;            // Timestamp of last heartbeat sent to WiThrottle server
+uint32_t lastHeartbeat;                 // Timestamp of last heartbeat sent to WiThrottle server
+
+// Commands sent to WiThrottle server
+/*
+ * Commands are collected in <cmdBatch> and written to the socket by
+ * flushCmd() once per loop pass. Together with TCP_NODELAY every loop
+ * pass results in a single segment.
+ */
+char cmdBatch[CMD_BATCH_SIZE];          // Commands not yet written to WiThrottle server
+unsigned int cmdBatchLength = 0;        // Length of pending commands
+cmdStatistics cmdStats;                 // Statistics of commands sent to WiThrottle server
+
+// Emergency stop
+volatile bool stopRequested = false;    // Emergency stop button has been pressed since last stop
+volatile uint32_t stopRequestTime = 0;
+                                        // Timestamp emergency stop button has been pressed; unit: us
+portMUX_TYPE stopMux = portMUX_INITIALIZER_UNLOCKED;
+                                        // Protects <stopRequested> and <stopRequestTime>
+
+// Command to be sent to WiThrottle server
+
+// Constructor
+CmdBuffer::CmdBuffer() {
+  buffer[0] = '\0';
+}
+
+// Append text
+CmdBuffer &CmdBuffer::add(const char* text) {
+  while (*text != '\0' && length < CMD_SIZE - 1) {
+    buffer[length++] = *text++;
+  }
+  buffer[length] = '\0';
+
+  return *this;
+}
+
+// Append character
+CmdBuffer &CmdBuffer::add(char character) {
+  if (length < CMD_SIZE - 1) {
+    buffer[length++] = character;
+    buffer[length] = '\0';
+  }
+
+  return *this;
+}
+
+// Append decimal value
+CmdBuffer &CmdBuffer::add(int value) {
+  char digits[12];                          // Digits in reverse order
+  unsigned int count = 0;                   // Number of digits
+  unsigned int magnitude;                   // Absolute value
+
+  // I want to check if value is negative
+  if (value < 0) {
+    add('-');
+    magnitude = -(unsigned int)value;
+  }
+  else {
+    magnitude = value;
+  }
+
+  do {
+    digits[count++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude > 0);
+
+  while (count > 0) {
+    add(digits[--count]);
+  }
+
+  return *this;
+}
+
+// Get command text
+const char* CmdBuffer::c_str() const {
+  return buffer;
+}
+
+// Get length of command text
+unsigned int CmdBuffer::size() const {
+  return length;
+}
+
 
 // Send command to WiThrottle server
-void sendCmd(String command, bool waitAfterCommand) {
-  client.println(command);
+void sendCmd(const char* command, bool waitAfterCommand) {
+  /*
+   * Command is queued until flushCmd() is called; if WiThrottle has to
+   * wait after the command, pending commands are written immediately.
+   */
+  unsigned int length = strlen(command);  // Length of command
+
+  // I want to check if command fits into pending commands
+  if (cmdBatchLength + length + 2 > CMD_BATCH_SIZE) {
+    flushCmd();
+  }
+
+  // I want to check if command fits into an empty buffer at all
+  if (length + 2 > CMD_BATCH_SIZE) {
+    client.println(command);
+    captureData(CAPTURE_SENT, command, length);
+    captureData(CAPTURE_SENT, "\r\n", 2);
+    cmdStats.segments++;
+    cmdStats.bytes += length + 2;
+  }
+  else {
+    memcpy(cmdBatch + cmdBatchLength, command, length);
+    cmdBatchLength += length;
+    cmdBatch[cmdBatchLength++] = '\r';
+    cmdBatch[cmdBatchLength++] = '\n';
+  }
+  cmdStats.commands++;
   lastHeartbeat = millis();
 
-  #ifdef DEBUG
-    Serial.println("-->: " + command);
-  #endif
+  LOG_DEBUG("-->: %s", command);
 
   if (waitAfterCommand) {
+    flushCmd();
     delay(JMRI_DELAY);
   }
 }
 
-// Read command from WiThrottle server
-String readCmd() {
-  String command;                       // Command string sent by WiThrottle server
-  String tmpCommand;                    // Modified command string used for debugging
+// Send command to WiThrottle server
+void sendCmd(String command, bool waitAfterCommand) {
+  sendCmd(command.c_str(), waitAfterCommand);
+}
+
+// Write all pending commands to WiThrottle server at once
+bool flushCmd() {
+  bool flushed = false;                 // Commands have been written
+
+  // I want to check if commands are pending
+  if (cmdBatchLength > 0) {
+    client.write((const uint8_t*)cmdBatch, cmdBatchLength);
+    captureData(CAPTURE_SENT, cmdBatch, cmdBatchLength);
+    cmdStats.segments++;
+    cmdStats.bytes += cmdBatchLength;
+    cmdBatchLength = 0;
+    flushed = true;
+  }
+
+  #if LOG_LEVEL >= LOG_LEVEL_INFO
+    // I want to check if statistics have to be reported
+    if (millis() - cmdStats.since >= CMD_STATS_INTERVAL && !printCmdStats(Serial)) {
+      // Nothing to report; next period starts now
+      cmdStats.since = millis();
+    }
+  #endif
+
+  return flushed;
+}
+
+// Print statistics of commands sent to WiThrottle server
+bool printCmdStats(Print &out) {
+  /*
+   * Statistics are printed directly, regardless of LOG_LEVEL, so the
+   * console can report them in any build. They are reset after
+   * printing, so every report covers the period since the previous
+   * one; if there is nothing to print, they are kept.
+   */
+  unsigned long period = millis() - cmdStats.since;
+                                          // Statistics period; unit: ms
+  bool printed = false;                   // Anything has been printed
+
+  // I want to check if any segment has been sent
+  if (cmdStats.segments > 0 && period > 0) {
+    out.printf("Sent %lu commands in %lu segments: %.2f segments/s, %.1f bytes/segment.\n",
+      cmdStats.commands, cmdStats.segments, cmdStats.segments * 1000.0 / period, double(cmdStats.bytes) / cmdStats.segments);
+    printed = true;
+  }
+
+  // I want to check if any command has been suppressed
+  if (cmdStats.suppressed > 0) {
+    out.printf("Suppressed %lu redundant commands.\n", cmdStats.suppressed);
+    printed = true;
+  }
+
+  // I want to check if any emergency stop has been requested by button
+  if (cmdStats.stops > 0) {
+    out.printf("Sent %lu emergency stops: %lu us average, %lu us maximum latency.\n",
+      cmdStats.stops, cmdStats.stopLatency / cmdStats.stops, cmdStats.stopLatencyMax);
+    printed = true;
+  }
+
+  // I want to check if any command has been confirmed, separately for WiFi power save off and on
+  for (byte powerSave = 0; powerSave < 2; powerSave++) {
+    if (cmdStats.confirmed[powerSave] > 0) {
+      out.printf("Confirmed %lu commands with WiFi power save %s: %.1f ms average, %lu ms maximum.\n",
+        cmdStats.confirmed[powerSave], powerSave ? "on" : "off", double(cmdStats.confirmTime[powerSave]) / cmdStats.confirmed[powerSave], cmdStats.confirmTimeMax[powerSave]);
+      printed = true;
+    }
+  }
+
+  // I want to check if anything has been printed; otherwise statistics are kept
+  if (!printed) {
+    return false;
+  }
+
+  for (byte powerSave = 0; powerSave < 2; powerSave++) {
+    cmdStats.confirmed[powerSave] = 0;
+    cmdStats.confirmTime[powerSave] = 0;
+    cmdStats.confirmTimeMax[powerSave] = 0;
+  }
+
+  cmdStats.commands = 0;
+  cmdStats.segments = 0;
+  cmdStats.bytes = 0;
+  cmdStats.suppressed = 0;
+  cmdStats.stops = 0;
+  cmdStats.stopLatency = 0;
+  cmdStats.stopLatencyMax = 0;
+  cmdStats.since = millis();
+
+  return true;
+}
+
+// Count a command not sent because WiThrottle server already has the state it would set
+void suppressCmd() {
+  cmdStats.suppressed++;
+}
+
+// Note time from sending a command until WiThrottle server confirmed it
+void confirmCmd(unsigned long latency) {
+  byte powerSave = WiFi.getSleep() != WIFI_PS_NONE;
+                                            // WiFi power save is on
+
+  cmdStats.confirmed[powerSave]++;
+  cmdStats.confirmTime[powerSave] += latency;
+  cmdStats.confirmTimeMax[powerSave] = max(cmdStats.confirmTimeMax[powerSave], latency);
+}
+
+// Check if WiThrottle server sent a command
+bool availableCmd() {
+  return client.available() > 0;
+}
+
+
+// Emergency stop
+
+// Note emergency stop button pressed
+void IRAM_ATTR requestStop() {
+  portENTER_CRITICAL_ISR(&stopMux);
+  // I want to keep the time of the first press, so chatter doesn't shorten the latency
+  if (!stopRequested) {
+    stopRequestTime = micros();
+    stopRequested = true;
+  }
+  portEXIT_CRITICAL_ISR(&stopMux);
+}
+
+// Check if emergency stop button has been pressed since last stop
+bool isStopRequested() {
+  return stopRequested;
+}
+
+// Forget emergency stop button pressed
+void cancelStop() {
+  portENTER_CRITICAL(&stopMux);
+  stopRequested = false;
+  portEXIT_CRITICAL(&stopMux);
+}
+
+// Write pre-encoded emergency stop ahead of all pending commands
+void sendStopCmd(const char* command, unsigned int length) {
+  bool requested;                       // Emergency stop button has been pressed
+  uint32_t requestTime;                 // Timestamp emergency stop button has been pressed; unit: us
+  uint32_t latency;                     // Time from pressing emergency stop button until stop has been written; unit: us
+
+  client.write((const uint8_t*)command, length);
+  latency = micros();
+
+  portENTER_CRITICAL(&stopMux);
+  requested = stopRequested;
+  requestTime = stopRequestTime;
+  stopRequested = false;
+  portEXIT_CRITICAL(&stopMux);
+
+  captureData(CAPTURE_SENT, command, length);
+  cmdStats.commands++;
+  cmdStats.segments++;
+  cmdStats.bytes += length;
+  lastHeartbeat = millis();
+
+  // I want to check if stop has been requested by emergency stop button
+  if (requested) {
+    latency -= requestTime;
+    cmdStats.stops++;
+    cmdStats.stopLatency += latency;
+    cmdStats.stopLatencyMax = max(cmdStats.stopLatencyMax, (unsigned long)latency);
+    LOG_INFO("Emergency stop written %lu us after pressing button.", latency);
+  }
+}
+
+// Drop pending commands starting with <prefix> followed by <action>
+bool dropCmd(const char* prefix, char action) {
+  /*
+   * Commands still pending are written behind an emergency stop, so
+   * speed and direction queued before it, e. g. by sync(), would undo
+   * it. They are removed from <cmdBatch>, the other commands keep
+   * their order.
+   */
+  unsigned int length = strlen(prefix);   // Length of prefix
+  unsigned int kept = 0;                  // Length of commands kept
+  unsigned int next;                      // Start of next command
+  bool dropped = false;                   // Any command has been dropped
 
-  if (client.available() > 0) {
-    command = client.readString();
-    client.flush();
+  for (unsigned int start = 0; start < cmdBatchLength; start = next) {
+    next = start;
+    while (next < cmdBatchLength && cmdBatch[next++] != '\n') {
+    }
 
-    #ifdef DEBUG
-      if (command != "\r\n\r\n" && command != "") {
-        tmpCommand = command.substring(0, command.length() - 4);
-        tmpCommand.replace("\r\n\r\n", "\r\n<--: ");
-        Serial.println("<--: " + tmpCommand);
-      }
-    #endif
+    // I want to check if command is the one to drop
+    if (next - start > length && memcmp(cmdBatch + start, prefix, length) == 0 && cmdBatch[start + length] == action) {
+      cmdStats.commands--;
+      dropped = true;
+    }
+    else {
+      memmove(cmdBatch + kept, cmdBatch + start, next - start);
+      kept += next - start;
+    }
   }
+  cmdBatchLength = kept;
 
-  return command; 
+  return dropped;
 }
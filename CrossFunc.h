@@ -5,13 +5,20 @@
 #ifndef _CROSS_FUNC_H_
 #define _CROSS_FUNC_H_
 
+#include "Clock.h"
 #include <Arduino.h>
 #include <WiFi.h>
 
 // Turn on serial output for debuging
-#define DEBUG
+//#define DEBUG
 
 // Define hardware layout
+/*
+ * The defines select the hardware policies the handset is composed of
+ * in ESP32_WiThrottle.ino (see Handset.h). Apart from that only
+ * OLED_I2C_CLOCK below depends on them, as the display has to share
+ * the I2C bus with the PCF8574 at its lower clock.
+ */
 //#define HL_DISP                             // If defined hardware uses display setup
 //#define ROT_ENCODER                         // If defined hardware uses rotary encoder instead of poti
 //#define FCT_WITH_I2C                        // If defined hardware uses pcf8574 instead of direct connection of F-Buttons
@@ -73,12 +80,18 @@
 #define BTN_FCT_07          0               // Function button # 7 --> set to 0, if not used in hardware setup
 #define BTN_FCT_08          0               // Function button # 8 --> set to 0, if not used in hardware setup
 #define BTN_FCT_09          0               // Function button # 9 --> set to 0, if not used in hardware setup
+#define BTN_DEBOUNCE       20               // Time function buttons have to be stable before a change is accepted; unit: ms
 
 // Direction switch (tri state)
 #define DIR_SW             16               // Direction switch
 
 // Rotary potentiometer
-#define POT_SIG            36               // Variable output of potentiometer for speed control
+#define POT_SIG            36               // Variable output of potentiometer for speed control; has to be an ADC1 pin
+#define POT_SAMPLE_FREQ 20000               // Sampling rate of potentiometer by ADC continuous mode; unit: Hz (minimum of ESP32)
+#define POT_BLOCK_SIZE     64               // Samples averaged to one block value
+#define POT_BLOCK_TIME      4               // Time to convert a block at POT_SAMPLE_FREQ, rounded up; unit: ms
+#define POT_SAMPLE_INTERVAL 25              // Interval of converting a block; ADC is stopped in between; unit: ms
+#define POT_FILTER_SIZE     5               // Block values flattened by median filter
 
 // VBatt
 #define V_BATT						  0
@@ -93,11 +106,20 @@
 #define ENC_DT             26               // Data line from rotary encoder DT
 #define ENC_BTN            15               // Switch from rotary encoder SW
 #define ENC_PWR            -1               // VCC pin # (-1 = powered separately)
+#define ENC_STEPS           4               // Quadrature transitions per detent
+#define ENC_ACCEL_TIME    100               // Detents turned faster than this are accelerated; unit: ms per detent
+#define ENC_ACCEL_MAX       8               // Maximum number of DCC notches per detent
 
 // I2C OLED display
 #define OLED_SDA           23               // Data line for I2C OLED display SDA
 #define OLED_SCL           22               // Clock line for I2C OLED display SCL
 #define OLED_RESET         -1               // Reset pin # (-1 = sharing Arduino reset pin)
+#ifdef FCT_WITH_I2C
+  #define OLED_I2C_CLOCK 100000             // I2C clock; PCF8574 on the same bus is limited to 100 kHz
+#else
+  #define OLED_I2C_CLOCK 400000             // I2C clock
+#endif
+#define OLED_CHUNK_SIZE    64               // Bytes of framebuffer sent per I2C transmission
 
 // I2C OLED display
 #define OLED_I2C         0x3c               // I2C address
@@ -139,17 +161,29 @@
 #define OLED_FWD_X         57               // X position of the FWD symbol
 #define OLED_REV_X          0               // X position of the REV symbol
 
+// I2C port expander for function buttons
+#define PCF_I2C          0x20               // I2C address of PCF8574
+#define PCF_BTN_COUNT       8               // Number of function buttons connected to PCF8574
+#define PCF_INT            27               // Interrupt line from PCF8574 INT; LOW after a pin has changed
+
 
 // Other constants
 #define LIFO_SIZE          50               // Size of LIFO array used for smoothing speed DCC notch reference read from potentiometer
-#define EEPROM_SIZE        64               // EEPROM config
-#define notchRange        126               // Range of DCC notches
+#define EEPROM_SIZE       768               // EEPROM config
+#define EEPROM_HOST_IP      3               // EEPROM address of cached IP address of WiThrottle server (4 bytes)
+#define EEPROM_HOST_PORT    7               // EEPROM address of cached port of WiThrottle server (2 bytes)
+#define EEPROM_LOCO_CACHE  16               // EEPROM address of cache of locos driven recently (see LocoCache.h)
+#define EEPROM_ADDRESS_LONG 0x8000          // Flag of a long DCC address below 128 in last active DCC address
+#define NOTCH_MAX         126               // Maximum notch sent to WiThrottle server
                                             /*
-                                             * Valid ranges:
-                                             * 0 to 13  (NMRA: optional)
-                                             * 0 to 27  (NMRA: mandatory)
-                                             * 0 to 126 (NMRA: optional)
+                                             * WiThrottle server always expects notches
+                                             * from 0 to 126 and scales them to the speed
+                                             * step mode of the loco, see
+                                             * VirtualLoco::getNotchRange()
                                              */
+#define ADC_TABLE_SHIFT     3               // Each entry of an ADC to notch table covers 2^ADC_TABLE_SHIFT ADC values
+#define ADC_TABLE_SIZE    (4096 >> ADC_TABLE_SHIFT)
+                                            // Entries of an ADC to notch table
 
 
 // WiFi communication
@@ -162,24 +196,118 @@ typedef struct {
                                             // Error is thrown by code, if connection is not established after <attempts> attempts
 } wiFiConfig;
 
+#define WIFI_CONNECT_TIMEOUT 3500           // Timeout of an attempt to connect to WiFi; unit: ms
+
 
 // WiThrottle server communication
 
 #define JMRI_DELAY        350               // Delay for a stable server communication
+#define JMRI_RACE_STAGGER 250               // Delay before connecting to the next WiThrottle server of a race; unit: ms
+#define JMRI_RACE_TIMEOUT 2500              // Timeout for any WiThrottle server of a race to greet; unit: ms
+#define JMRI_DISCOVERY_TIMEOUT 3500         // Timeout for discovering WiThrottle server by mDNS; unit: ms
 
-// WiThrottle server settings
+// Reconnection
+#define CONN_BACKOFF_MIN  250               // Delay before first attempt to reconnect; unit: ms
+#define CONN_BACKOFF_MAX 8000               // Maximum delay between attempts to reconnect; unit: ms
+#define CONN_HANDSHAKE_TIMEOUT 3000         // Timeout for WiThrottle server to greet after connecting; unit: ms
+#define CONN_REDISCOVER     3               // Failed attempts before WiThrottle server is discovered again
+#define CONN_GIVE_UP   300000               // WiThrottle is turned off if connection can't be restored within this time; unit: ms
+#define CMD_SIZE           64               // Maximum length of a command sent to WiThrottle server
+#define CMD_PREFIX_SIZE    16               // Maximum length of a command prefix, e. g. "M0AL10239<;>"
+#define CMD_BATCH_SIZE    256               // Size of buffer collecting the commands of one loop pass
+#define CMD_STATS_INTERVAL 10000            // Interval for reporting statistics of sent segments; unit: ms
+#define CMD_LINE_SIZE     512               // Maximum length of a line received from WiThrottle server; longer lines are truncated
+#define CMD_CONFIRM_TIMEOUT 1000            // Reports of WiThrottle server contradicting a state sent are ignored for this time; unit: ms
+#define CMD_STOP_SIZE      (CMD_PREFIX_SIZE + 3)
+                                            // Size of pre-encoded emergency stop incl. CR LF, e. g. "M0AL10239<;>X\r\n"
+
+// WiThrottle server endpoint
 typedef struct {
   char* ip;                                 // IP address of WiThrottle server
+                                            // Optional: "0.0.0.0" = unused
   unsigned int port;                        // Port used by WiThrottle server
                                             // Default port: 12090 according to WiThrottle server settings
+} hostEndpoint;
+
+#define HOST_ENDPOINTS      2               // Number of configured WiThrottle servers, e. g. primary and standby
+#define HOST_CANDIDATES (HOST_ENDPOINTS + 2)
+                                            // WiThrottle servers raced at most: last connected, configured and discovered
+
+// WiThrottle server settings
+typedef struct {
+  hostEndpoint endpoints[HOST_ENDPOINTS];   // WiThrottle servers in order of preference
+                                            // Optional: all "0.0.0.0" = use WiThrottle server discovered by mDNS only
   unsigned int attempts;                    // Attempts to try to connect to WiThrottle server
                                             // Error is thrown by code, if connection is not established after <attempts> attempts
   String protocolVersion;                   // Version number of the WiThrottle protocol used by WiThrottle server
   unsigned int heartbeat;                   // Withrottle server expecteds heartbeat after <heartbeat> seconds
 } hostConfig;
 
+// Statistics of commands sent to WiThrottle server
+typedef struct {
+  unsigned long commands = 0;               // Commands sent
+  unsigned long segments = 0;               // Segments, i. e. socket writes, sent
+  unsigned long bytes = 0;                  // Bytes sent
+  unsigned long suppressed = 0;             // Commands not sent because WiThrottle server already has the state they would set
+  unsigned long confirmed[2] = { 0, 0 };    // Commands confirmed by WiThrottle server; index: WiFi power save off, on
+  unsigned long confirmTime[2] = { 0, 0 };  // Sum of times until confirmation; index as <confirmed>; unit: ms
+  unsigned long confirmTimeMax[2] = { 0, 0 };
+                                            // Maximum time until confirmation; index as <confirmed>; unit: ms
+  unsigned long stops = 0;                  // Emergency stops requested by button and sent
+  unsigned long stopLatency = 0;            // Sum of times from pressing emergency stop button until stop has been written; unit: us
+  unsigned long stopLatencyMax = 0;         // Maximum time from pressing emergency stop button until stop has been written; unit: us
+  uint32_t since = 0;                       // Start of statistics period; unit: ms
+} cmdStatistics;
+
+// Command to be sent to WiThrottle server
+/*
+ * Commands are formatted into a fixed buffer on the stack, so building
+ * a command doesn't allocate any heap memory. Text exceeding CMD_SIZE is
+ * truncated.
+ */
+class CmdBuffer {
+  private:
+    char buffer[CMD_SIZE];                  // Command text
+    unsigned int length = 0;                // Length of command text
+
+  public:
+    // Constructor
+    CmdBuffer();
+
+    // Build command
+    CmdBuffer &add(const char* text);       // Append text
+    CmdBuffer &add(char character);         // Append character
+    CmdBuffer &add(int value);              // Append decimal value
+
+    // Read command
+    const char* c_str() const;              // Get command text
+    unsigned int size() const;              // Get length of command text
+};
+
+void sendCmd(const char* command, bool waitAfterCommand = true);
+                                            // Send command to WiThrottle server
 void sendCmd(String command, bool waitAfterCommand = true);
                                             // Send command to WiThrottle server
-String readCmd();                           // Read command from WiThrottle server
+bool flushCmd();                            // Write all pending commands to WiThrottle server at once
+bool printCmdStats(Print &out);             // Print statistics of commands sent to WiThrottle server and reset them; false if there was nothing to print
+void suppressCmd();                         // Count a command not sent because WiThrottle server already has the state it would set
+void confirmCmd(unsigned long latency);     // Note time from sending a command until WiThrottle server confirmed it
+
+// Emergency stop
+/*
+ * The emergency stop button is sampled by an interrupt, which only
+ * notes the time it has been pressed. The stop is handled first thing
+ * in the next loop pass (waiting idle ends at once) and its pre-encoded
+ * command is written to the socket immediately, ahead of all commands
+ * pending in the batch and without any delay after the command.
+ */
+void IRAM_ATTR requestStop();               // Note emergency stop button pressed; to be called by interrupt service routine
+bool isStopRequested();                     // Check if emergency stop button has been pressed since last stop
+void cancelStop();                          // Forget emergency stop button pressed, e. g. for dispatching
+void sendStopCmd(const char* command, unsigned int length);
+                                            // Write pre-encoded emergency stop incl. CR LF ahead of all pending commands
+bool dropCmd(const char* prefix, char action);
+                                            // Drop pending commands <prefix><action>..., e. g. speed superseded by an emergency stop
+bool availableCmd();                        // Check if WiThrottle server sent a command
 
 #endif
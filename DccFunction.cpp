@@ -3,13 +3,17 @@
  */
 
 #include "DccFunction.h"
+#include "Log.h"
 
 
 // Constructor
 DccFunction::DccFunction() {
   fn = 0;
   state = OFF;
+  serverState = OFF;
+  pending = false;
   label = "";
+  cmdPrefix[0] = '\0';
 }
 
 
@@ -18,12 +22,15 @@ DccFunction::DccFunction() {
 // Set function number
 void DccFunction::setFn(byte fn) {
   this->fn = fn;
-  label = String("F" + fn);
+  label = "F" + String(fn);
+  state = OFF;
+  serverState = OFF;
+  pending = false;
 }
 
 // Set Prefix for WiThrottle server communication
-void DccFunction::setPrefix(String cmdPrefix) {
-  this->cmdPrefix = cmdPrefix;
+void DccFunction::setPrefix(const char* cmdPrefix) {
+  strlcpy(this->cmdPrefix, cmdPrefix, sizeof(this->cmdPrefix));
 }
 
 
@@ -31,36 +38,63 @@ void DccFunction::setPrefix(String cmdPrefix) {
 
 // Change state
 void DccFunction::toggle() {
-  #ifdef DEBUG
-    Serial.println("Toggle function F" + String(fn) + ".");
-  #endif
+  LOG_DEBUG("Toggle function F%u.", fn);
 
   state = !state;
-  sendCmd(cmdPrefix + "<;>F" + state + fn);	// ZIM: ON changed to state???
+  send();
 }
 
 // Change state to On
 void DccFunction::on() {
-  #ifdef DEBUG
-    Serial.print("Turn function F" + String(fn) + " on --> ");
-  #endif
+  LOG_DEBUG("Turn function F%u on.", fn);
 
-  // I want to check if state has to be changed
-  if (state == OFF) {
-    toggle();
-  }
+  state = ON;
+  send();
 }
 
 // Change state to Off
 void DccFunction::off() {
-  #ifdef DEBUG
-    Serial.print("Turn function F" + String(fn) + " off --> ");
-  #endif
+  LOG_DEBUG("Turn function F%u off.", fn);
 
-  // I want to check if state has to be changed
-  if (state == ON) {
-    toggle();
+  state = OFF;
+  send();
+}
+
+// Send state unless WiThrottle server already has it
+void DccFunction::send() {
+  /*
+   * <serverState> is the state WiThrottle server has or will have as
+   * soon as the commands already sent are processed, so only a real
+   * difference is sent.
+   */
+  CmdBuffer cmd;                            // Command to be sent to WiThrottle server
+
+  // I want to check if WiThrottle server already has the state
+  if (state == serverState) {
+    suppressCmd();
+    return;
   }
+
+  cmd.add(cmdPrefix).add('F').add(state).add(fn);	// ZIM: ON changed to state???
+  sendCmd(cmd.c_str(), false);
+  serverState = state;
+  pending = true;
+  pendingTime = millis();
+}
+
+// Get state
+byte DccFunction::getState() {
+  return state;
+}
+
+// Get name of the function
+String DccFunction::getLabel() {
+  return label;
+}
+
+// Set name of the function
+void DccFunction::setLabel(const char* label) {
+  this->label = label;
 }
 
 
@@ -73,13 +107,27 @@ void DccFunction::listenToLoco(String serverInfo) {
     // I want to check if function state information belongs to this function
     if (serverInfo.substring(2, serverInfo.length()).toInt() == fn) {
       // State information
-      state = serverInfo.substring(1, 2).toInt();
-
-      #ifdef DEBUG
-        Serial.print("DCC Function F" + String(fn));
-        if (label != "") Serial.print(" '" + label + "'");
-        Serial.println(" is " + stateTxt[state] + ".");
-      #endif
+      byte reported = serverInfo.substring(1, 2).toInt();
+                                            // State reported by WiThrottle server
+
+      // I want to check if state reported is valid
+      if (reported != OFF && reported != ON) {
+        LOG_WARN("DCC Function F%u '%s' invalid report %u ignored.", fn, label, reported);
+        return;
+      }
+
+      // I want to check if report has been sent before WiThrottle server processed the state sent
+      if (pending && reported != serverState && millis() - pendingTime < CMD_CONFIRM_TIMEOUT) {
+        LOG_DEBUG("DCC Function F%u '%s' outdated report %s ignored.", fn, label, stateTxt[reported]);
+        return;
+      }
+
+      // State is confirmed or has been changed by WiThrottle server, e. g. by another throttle
+      state = reported;
+      serverState = reported;
+      pending = false;
+
+      LOG_DEBUG("DCC Function F%u '%s' is %s.", fn, label, stateTxt[state]);
     }
   }
   else if (serverInfo.startsWith("]\\[")) {
@@ -90,14 +138,10 @@ void DccFunction::listenToLoco(String serverInfo) {
       serverInfo.replace(label, "");
     }
 
-    #ifdef DEBUG
-      Serial.println("DCC Function F" + String(fn) + " is named '" + label + "'.");
-    #endif
+    LOG_DEBUG("DCC Function F%u is named '%s'.", fn, label);
   }
   else {
     // Unknown command
-    #ifdef DEBUG
-      Serial.println("Class Dccfunction: Unknown command '" + serverInfo + "'.");
-    #endif
+    LOG_WARN("Class Dccfunction: Unknown command '%s'.", serverInfo);
   }
 }
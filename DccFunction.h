@@ -21,15 +21,19 @@ class DccFunction {
                                             /*
                                              * 0 ... 28 
                                              */
-    byte state;                             // State of the function
+    byte state;                             // State of the function as set by WiThrottle
                                             /*
                                              * OFF, ON 
                                              */
+    byte serverState;                       // State WiThrottle server has, i. e. last state sent or reported
+    bool pending;                           // State has been sent but not yet confirmed by WiThrottle server
+    uint32_t pendingTime;                   // Timestamp state has been sent
     String stateTxt[2] = { "OFF", "ON" };   // State as a text --> used for debugging
     String label;                           // Name of the function
 
     // WiThrottle server communication
-    String cmdPrefix;                       // Prefix to be used in the communication to WiThrottle server
+    char cmdPrefix[CMD_PREFIX_SIZE];        // Prefix to be used in the communication to WiThrottle server
+    void send();                            // Send state unless WiThrottle server already has it
 
   public:
     // Constructor
@@ -37,12 +41,15 @@ class DccFunction {
 
     // Initialize Class
     void setFn(byte fn);                    // Set function number
-    void setPrefix(String cmdPrefix);       // Set Prefix for WiThrottle server communication
+    void setPrefix(const char* cmdPrefix);  // Set Prefix for WiThrottle server communication
 
     // Change state of the function
     void toggle();                          // Change state
     void on();                              // Change state to On
     void off();                             // Change state to Off
+    byte getState();                        // Get state
+    String getLabel();                      // Get name of the function
+    void setLabel(const char* label);       // Set name of the function, e. g. from loco cache
 
     // WiThrottle server communication
     void listenToLoco(String serverInfo);   // Use information sent by WiThrottle server to WiThrottle to update the DCC function's information about state and label
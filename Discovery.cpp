@@ -0,0 +1,93 @@
+/*
+ * Definition of the discovery of WiThrottle servers by mDNS
+ */
+
+#include "Discovery.h"
+#include "Log.h"
+#include <ESPmDNS.h>
+
+
+// Discovery task
+void ServerDiscovery::task(void* parameter) {
+  ServerDiscovery* discovery = (ServerDiscovery*)parameter;
+  int count;                                // Number of WiThrottle servers found
+
+  count = MDNS.queryService(JMRI_MDNS_SERVICE, JMRI_MDNS_PROTO);
+
+  // I want to check if a WiThrottle server has been found
+  if (count > 0) {
+    discovery->ip = MDNS.IP(0);
+    discovery->port = MDNS.port(0);
+    discovery->found = true;
+  }
+  discovery->done = true;
+
+  vTaskDelete(NULL);
+}
+
+
+// mDNS host name
+
+// Build mDNS host name from name of throttle and MAC address
+void ServerDiscovery::buildHostname(const char* name) {
+  /*
+   * The service name is only queried; as host name of its own each
+   * throttle needs a unique one, so two throttles flashed alike don't
+   * collide. Characters not allowed in a host name become '-'.
+   */
+  uint8_t mac[6];                           // MAC address of WiThrottle
+  size_t length = 0;                        // Length of host name without MAC suffix
+
+  for (; name[length] != '\0' && length < MDNS_HOST_SIZE - 8; length++) {
+    hostname[length] = isAlphaNumeric(name[length]) ? tolower(name[length]) : '-';
+  }
+
+  WiFi.macAddress(mac);
+  snprintf(hostname + length, MDNS_HOST_SIZE - length, "-%02x%02x%02x", mac[3], mac[4], mac[5]);
+}
+
+
+// Discovery
+
+// Start discovery in the background
+void ServerDiscovery::start(const char* name) {
+  // I want to check if a discovery is still running
+  if (!done) {
+    return;
+  }
+
+  found = false;
+
+  // I want to check if mDNS has to be started
+  if (!started) {
+    buildHostname(name);
+    if (!MDNS.begin(hostname)) {
+      LOG_ERROR("Failed to start mDNS.");
+      return;
+    }
+    started = true;
+    LOG_INFO("mDNS host name is %s.", hostname);
+  }
+
+  done = false;
+  if (xTaskCreate(task, "discovery", 4096, this, 1, NULL) != pdPASS) {
+    done = true;
+  }
+}
+
+// Check if discovery has finished
+bool ServerDiscovery::isDone() {
+  return done;
+}
+
+// Get discovered WiThrottle server
+bool ServerDiscovery::getServer(IPAddress &ip, uint16_t &port) {
+  // I want to check if a WiThrottle server has been discovered
+  if (done && found) {
+    ip = this->ip;
+    port = this->port;
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,41 @@
+/*
+ * Declaration of the discovery of WiThrottle servers by mDNS
+ */
+
+#ifndef _DISCOVERY_H_
+#define _DISCOVERY_H_
+
+#include "CrossFunc.h"
+#include <Arduino.h>
+#include <WiFi.h>
+
+
+// mDNS service announced by WiThrottle server
+#define JMRI_MDNS_SERVICE "withrottle"      // Service name of _withrottle._tcp
+#define JMRI_MDNS_PROTO   "tcp"             // Protocol of _withrottle._tcp
+#define MDNS_HOST_SIZE      32              // Size of mDNS host name of WiThrottle incl. terminating '\0'
+
+class ServerDiscovery {
+  private:
+    /*
+     * The mDNS query blocks for up to 3 seconds, so it runs in a task of
+     * its own. The task only writes the result and sets <done> last.
+     */
+    volatile bool done = true;              // Discovery has finished
+    bool found = false;                     // WiThrottle server has been discovered
+    IPAddress ip;                           // IP address of discovered WiThrottle server
+    uint16_t port = 0;                      // Port of discovered WiThrottle server
+    bool started = false;                   // mDNS has been started
+    char hostname[MDNS_HOST_SIZE];          // mDNS host name of WiThrottle, e. g. "esp32-withrottle-a1b2c3"
+
+    void buildHostname(const char* name);   // Build mDNS host name from name of throttle and MAC address
+    static void task(void* parameter);      // Query WiThrottle servers; <parameter> is the discovery
+
+  public:
+    // Discovery
+    void start(const char* name);           // Start discovery in the background; <name> is the name of the throttle
+    bool isDone();                          // Check if discovery has finished
+    bool getServer(IPAddress &ip, uint16_t &port);
+                                            // Get discovered WiThrottle server
+};
+#endif
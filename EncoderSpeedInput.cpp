@@ -0,0 +1,29 @@
+/*
+ * Definition of the interrupt service routine of the rotary encoder
+ *
+ * Data shared with the interrupt service routine is defined here once,
+ * so EncoderSpeedInput.h stays includable by any number of sources.
+ */
+
+#include "EncoderSpeedInput.h"
+
+
+// Rotary encoder
+volatile int encoderTransitions = 0;        // Quadrature transitions counted since last read; sign is direction
+volatile byte encoderLines = 0;             // Last two states of CLK and DT
+portMUX_TYPE encoderMux = portMUX_INITIALIZER_UNLOCKED;
+                                            // Protects <encoderTransitions>
+
+// Count quadrature transitions of rotary encoder
+void IRAM_ATTR encoderISR() {
+  // Transition from previous to actual state of CLK and DT: +1, -1 or 0 (invalid or bounce)
+  static const DRAM_ATTR int8_t transition[16] = { 0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0 };
+
+  portENTER_CRITICAL_ISR(&encoderMux);
+  encoderLines = ((encoderLines << 2) | (digitalRead(ENC_CLK) << 1) | digitalRead(ENC_DT)) & 0x0F;
+  encoderTransitions += transition[encoderLines];
+  portEXIT_CRITICAL_ISR(&encoderMux);
+
+  // Turning the encoder ends waiting idle between loop passes
+  PowerManager::wake();
+}
@@ -0,0 +1,185 @@
+/*
+ * Declaration of the speed input policy for hardware with rotary encoder
+ */
+
+#ifndef _ENCODER_SPEED_INPUT_H_
+#define _ENCODER_SPEED_INPUT_H_
+
+#include "CrossFunc.h"
+#include "Power.h"
+#include "VirtualLoco.h"
+#include <Arduino.h>
+#include <limits.h>
+
+
+// Rotary encoder
+/*
+ * The encoder lines are decoded by an interrupt service routine, which
+ * only counts quadrature transitions. Everything else is done by
+ * readNotch() in the main loop.
+ */
+extern volatile int encoderTransitions;      // Quadrature transitions counted since last read; sign is direction
+extern volatile byte encoderLines;          // Last two states of CLK and DT
+extern portMUX_TYPE encoderMux;             // Protects <encoderTransitions>
+
+void IRAM_ATTR encoderISR();                // Count quadrature transitions of rotary encoder
+
+class EncoderSpeedInput {
+  private:
+    int position = 0;                       // Reference speed step set by rotary encoder
+    byte positionRange = NOTCH_MAX;         // Number of speed steps <position> refers to
+    int remainder = 0;                      // Transitions not yet making up a detent
+    uint32_t moveTime = 0;                  // Timestamp of last detent
+    bool btnState = HIGH;                   // Last state of encoder button
+    uint32_t btnTime = 0;                   // Timestamp of last change of encoder button
+
+  public:
+    static const bool hasDirectionSwitch = false;
+                                            // Hardware has no direction switch
+    static const unsigned int notchTimeout = 100;
+                                            // Time before notch information is send next time to WiThrottle server
+    static const bool canNavigate = true;   // Speed input can operate the menu
+
+    // Speed input initialization
+    void begin();
+
+    // Direction
+    int readDirection();                    // Read reference direction
+
+    // Notch
+    bool readNotch(unsigned int &notch, byte notchRange);
+                                            // Read reference notch from rotary encoder
+    bool isAtZero();                        // Check if rotary encoder is set to 0
+    void stop();                            // Set reference notch to 0 after emergency stop
+    unsigned long getSampleTimeout() { return ULONG_MAX; }
+                                            // Rotary encoder is sampled by interrupt; waiting idle doesn't end for it
+
+    // Menu
+    int readSteps();                        // Read detents turned since last call without changing reference notch
+};
+
+
+// Speed input initialization
+inline void EncoderSpeedInput::begin() {
+  pinMode(ENC_CLK, INPUT_PULLUP);
+  pinMode(ENC_DT, INPUT_PULLUP);
+  pinMode(ENC_BTN, INPUT_PULLUP);
+
+  encoderLines = (digitalRead(ENC_CLK) << 1) | digitalRead(ENC_DT);
+  attachInterrupt(digitalPinToInterrupt(ENC_CLK), encoderISR, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENC_DT), encoderISR, CHANGE);
+}
+
+
+// Direction
+
+// Read reference direction
+inline int EncoderSpeedInput::readDirection() {
+  return IDLE;
+}
+
+
+// Notch
+
+// Read reference notch from rotary encoder
+inline bool EncoderSpeedInput::readNotch(unsigned int &notch, byte notchRange) {
+  /*
+   * Detents are accelerated depending on the rotation speed: a slow
+   * turn changes the speed step by 1 per detent, a quick spin by up to
+   * ENC_ACCEL_MAX (scaled to the speed step mode), so the full range is
+   * passed with a single spin.
+   *
+   * Each detent is one speed step of the loco, which is scaled to the
+   * 0 to 126 range of WiThrottle server.
+   *
+   * The reference notch is returned on every call; the handset only
+   * sends it if it differs from the loco's notch.
+   */
+
+  int transitions;                          // Transitions counted by interrupt service routine
+  int detents;                              // Detents turned since last call
+  unsigned long interval;                   // Time per detent; unit: ms
+  int acceleration = 1;                     // Speed steps per detent
+  int accelerationMax = (ENC_ACCEL_MAX * notchRange + NOTCH_MAX - 1) / NOTCH_MAX;
+                                            // Maximum speed steps per detent
+  bool btn;                                 // State of encoder button
+
+  // I want to take over the transitions counted by the interrupt service routine
+  portENTER_CRITICAL(&encoderMux);
+  transitions = encoderTransitions;
+  encoderTransitions = 0;
+  portEXIT_CRITICAL(&encoderMux);
+
+  // I want to check if speed step mode has changed
+  if (notchRange != positionRange) {
+    position = (position * notchRange + positionRange / 2) / positionRange;
+    positionRange = notchRange;
+  }
+
+  remainder += transitions;
+  detents = remainder / ENC_STEPS;
+  remainder -= detents * ENC_STEPS;
+
+  // I want to check if encoder has been turned
+  if (detents != 0) {
+    interval = (millis() - moveTime) / abs(detents);
+    moveTime = millis();
+
+    // I want to check if encoder is turned fast enough to be accelerated
+    if (interval < ENC_ACCEL_TIME) {
+      acceleration = min((unsigned long)accelerationMax, ENC_ACCEL_TIME / max(interval, 1UL));
+    }
+
+    position = min(max(position + detents * acceleration, 0), (int)notchRange);
+  }
+
+  // I want to check if encoder button has its own pin; otherwise it is the emergency stop button
+  if (ENC_BTN != BTN_STOP) {
+    btn = digitalRead(ENC_BTN);
+
+    // I want to check if encoder button has been pressed; ignore chatter for 20 ms
+    if (btn != btnState && millis() - btnTime > 20) {
+      btnState = btn;
+      btnTime = millis();
+      if (btn == LOW) {
+        // Push to stop
+        stop();
+      }
+    }
+  }
+
+  notch = (position * NOTCH_MAX + notchRange / 2) / notchRange;
+
+  return true;
+}
+
+// Check if rotary encoder is set to 0
+inline bool EncoderSpeedInput::isAtZero() {
+  return position == 0;
+}
+
+// Set reference notch to 0 after emergency stop
+inline void EncoderSpeedInput::stop() {
+  position = 0;
+  remainder = 0;
+}
+
+
+// Menu
+
+// Read detents turned since last call without changing reference notch
+inline int EncoderSpeedInput::readSteps() {
+  int detents;                              // Detents turned since last call
+
+  // I want to take over the transitions counted by the interrupt service routine
+  portENTER_CRITICAL(&encoderMux);
+  remainder += encoderTransitions;
+  encoderTransitions = 0;
+  portEXIT_CRITICAL(&encoderMux);
+
+  detents = remainder / ENC_STEPS;
+  remainder -= detents * ENC_STEPS;
+
+  return detents;
+}
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Declaration of the function button policy for hardware with function
+ * buttons connected directly to GPIOs
+ */
+
+#ifndef _GPIO_BUTTONS_H_
+#define _GPIO_BUTTONS_H_
+
+#include "CrossFunc.h"
+#include <Arduino.h>
+
+
+class GpioButtons {
+  private:
+    unsigned int btnFctCount = 0;           // Number of function buttons used in hardware setup
+    const unsigned int btnFctPin[10] = { BTN_FCT_01, BTN_FCT_02, BTN_FCT_03, BTN_FCT_04, BTN_FCT_05, BTN_FCT_06, BTN_FCT_07, BTN_FCT_08, BTN_FCT_09, 0 }; // added '0' for safe limitation in "begin()"
+                                            // Ordered list of input pins
+
+  public:
+    // Function button initialization
+    void begin();
+
+    // Function buttons
+    unsigned int count();                   // Get number of function buttons
+    void scan();                            // Read state of function buttons
+    bool isPressed(unsigned int btn);       // Check if function button is pressed
+};
+
+
+// Function button initialization
+inline void GpioButtons::begin() {
+  btnFctCount = 0;
+  while (btnFctPin[btnFctCount] != 0) {
+    pinMode(btnFctPin[btnFctCount], INPUT_PULLUP);
+    btnFctCount++;
+  }
+}
+
+
+// Function buttons
+
+// Get number of function buttons
+inline unsigned int GpioButtons::count() {
+  return btnFctCount;
+}
+
+// Read state of function buttons
+inline void GpioButtons::scan() {
+  // Function buttons are read directly by isPressed()
+}
+
+// Check if function button is pressed
+inline bool GpioButtons::isPressed(unsigned int btn) {
+  return digitalRead(btnFctPin[btn]) == LOW;
+}
+#endif
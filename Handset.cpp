@@ -0,0 +1,15 @@
+/*
+ * Definition of the interrupt service routine of the emergency stop button
+ */
+
+#include "Handset.h"
+
+
+// Emergency stop button
+
+// Note emergency stop button pressed and end waiting idle
+void IRAM_ATTR btnStopISR() {
+  // The press is noted with its time and waiting idle between loop passes ends immediately
+  requestStop();
+  PowerManager::wake();
+}
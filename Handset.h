@@ -0,0 +1,465 @@
+/*
+ * Declaration of the handset, i. e. the hardware WiThrottle is operated with
+ *
+ * The hardware layout is composed at compile time of three policies:
+ *
+ * Display:    NoDisplay, OledDisplay
+ * SpeedInput: PotSpeedInput, EncoderSpeedInput
+ * Buttons:    GpioButtons, Pcf8574Buttons
+ *
+ * All policies are resolved by the compiler, so the protocol classes
+ * WiThrottle and VirtualLoco don't depend on the hardware layout and a
+ * handset without display doesn't contain any display code.
+ *
+ * The menu is available if the handset has a display and a speed input
+ * that can operate it: holding the shift button opens and closes the
+ * menu, turning the encoder moves the cursor and pressing the shift
+ * button executes the row.
+ */
+
+#ifndef _HANDSET_H_
+#define _HANDSET_H_
+
+#include "Console.h"
+#include "CrossFunc.h"
+#include "Menu.h"
+#include "Power.h"
+#include "VirtualLoco.h"
+#include "WiThrottle.h"
+#include <Arduino.h>
+
+
+// Emergency stop button
+void IRAM_ATTR btnStopISR();                // Note emergency stop button pressed and end waiting idle
+
+template <class Display, class SpeedInput, class Buttons>
+class Handset {
+  private:
+    // WiThrottle
+    WiThrottle &throttle;                   // WiThrottle operated by the handset
+
+    // Notch
+    uint32_t notchTime = 0;                 // Timestamp of last transmisson of reference notch to WiThrottle server
+
+    // Function buttons
+    unsigned int btnRaw = 0;                // Function buttons pressed at last scan; bit i = button i
+    unsigned int btnStable = 0;             // Function buttons pressed after debouncing; bit i = button i
+    uint32_t btnChangeTime = 0;             // Timestamp of last change of <btnRaw>
+
+    // Shift button
+    bool shiftState = HIGH;                 // Last state of shift button
+    uint32_t shiftTime = 0;                 // Timestamp of last change of shift button
+    bool shiftUsed = false;                 // Shift button has been used since it has been pressed
+
+    // LED for indicating the loco's direction
+    const unsigned int ledDirPin[2] = { LED_REV, LED_FWD };
+                                            // Ordered list of output pins
+    bool ledBlink = LOW;                    // State of direction LED blinking after emergency stop
+    uint32_t ledBlinkTime = 0;              // Timestamp of last change of <ledBlink>
+
+    // Loops
+    void btnStopLoop();                     // Checks if emergency stop button has been pressed
+    void btnFnLoop();                       // Checks if a function button is pressed
+    void ledLoop();                         // Checks if a loco is active
+    void directionLoop();                   // Checks if direction of loco needs to change
+    void speedLoop();                       // Checks if speed of loco needs to change
+    void menuLoop();                        // Checks if menu is operated
+
+  public:
+    // Hardware policies
+    Display display;                        // Display
+    SpeedInput speed;                       // Speed input
+    Buttons buttons;                        // Function buttons
+
+    // Power saving
+    PowerManager power;                     // Waits idle between loop passes
+
+    // Menu
+    Menu menu;                              // Menu operated by speed input and shift button
+
+    // Serial console
+    Console console;                        // Commands typed on serial monitor
+
+    // Constructor
+    Handset(WiThrottle &throttle) : throttle(throttle), menu(throttle), console(throttle, power) {}
+
+    // Handset initialization
+    void begin();
+
+    // Handset operation
+    void loop();                            // Executed repetitively
+};
+
+
+// Handset initialization
+template <class Display, class SpeedInput, class Buttons>
+void Handset<Display, SpeedInput, Buttons>::begin() {
+  // Define input and output pins
+  pinMode(BTN_STOP, INPUT_PULLUP);
+  pinMode(BTN_FCT_SH, INPUT_PULLUP);
+  buttons.begin();
+
+  pinMode(LED_STOP, OUTPUT);
+  pinMode(LED_FWD, OUTPUT);
+  pinMode(LED_REV, OUTPUT);
+
+  // WiThrottle will wakeup by pressing emergency stop button
+  /*
+   * ATTENTION:
+   * gpio_num_t has to be the same GPIO as BTN_STOP
+   */
+  esp_sleep_enable_ext0_wakeup(GPIO_NUM_15, LOW);
+
+  // Emergency stop button is sampled by interrupt and ends waiting idle between loop passes immediately
+  power.begin();
+  attachInterrupt(digitalPinToInterrupt(BTN_STOP), btnStopISR, FALLING);
+
+  speed.begin();
+
+  // I want to check if hardware has a display
+  if (Display::present) {
+    throttle.setMessageHandler(Display::showMessage);
+
+    // I want to check if WiThrottle was able to start display
+    if (!display.begin()) {
+      // Error
+      throttle.errorHandling("Failed to\ninitialize\nI2C OLED\ndisplay");
+    }
+  }
+}
+
+
+// Handset operation
+
+// Executed repetitively
+template <class Display, class SpeedInput, class Buttons>
+void Handset<Display, SpeedInput, Buttons>::loop() {
+  /*
+   * Order of calling the subs is by descencing importance.
+   *
+   * If nothing has been sent or received for IDLE_AFTER, the loop pass
+   * ends with waiting idle until the next deadline, i. e. next heartbeat
+   * or next sampling of speed input and buttons after IDLE_LATENCY.
+   *
+   * Emergency stop is handled first, before anything else can delay it.
+   */
+  btnStopLoop();
+  throttle.connectionLoop();
+  console.loop();
+
+  // I want to check if WiThrottle is ready for operation; otherwise connection is being restored
+  if (throttle.getConnectionState() == CONN_READY) {
+    if (SpeedInput::hasDirectionSwitch) {
+      directionLoop();
+    }
+    ledLoop();
+    btnFnLoop();
+    menuLoop();
+
+    // I want to check if speed input operates the menu
+    if (!menu.isOpen()) {
+      speedLoop();
+    }
+    throttle.sendHeartbeat();
+
+    // WiFi latency matters while a loco is moving or the handset is operated
+    power.wiFiLoop(throttle.loco[0].getNotch() > 0 || throttle.loco[0].getAcquiring() || btnRaw != 0 || menu.isOpen());
+  }
+
+  // I want to check if anything has been sent or received in this loop pass
+  if (flushCmd() || availableCmd()) {
+    power.activity();
+  }
+  throttle.listenToServer();
+  display.showMenu(menu);
+  display.update(throttle);
+  power.idle(min(throttle.getHeartbeatTimeout(), speed.getSampleTimeout()));
+}
+
+
+// Loops
+
+// Checks if emergency stop button has been pressed
+template <class Display, class SpeedInput, class Buttons>
+void Handset<Display, SpeedInput, Buttons>::btnStopLoop() {
+  /*
+   * If shift button is pressed together with emergencystop button,
+   * loco will be despatched. Version without display will turn off
+   * after dispatch.
+   *
+   * If emergency button only is pressed, speed is set to 0 (notch -126)
+   * and the potentiometer is set out of order.
+   *
+   * Pressing button longer than 5 seconds will turnoff WiThrottle.
+   *
+   * WiThrottle can be switched on again by pressing the button again.
+   */
+
+  uint32_t startTime;                       // Start time emergency stop button has been pressed
+  bool pressed;                             // Emergency stop button is or has been pressed since last loop pass
+
+  // A press shorter than a loop pass has been noted by the interrupt service routine
+  pressed = digitalRead(BTN_STOP) == LOW || isStopRequested();
+
+  // I want to check if emergency stop button has been pressed together with shift button
+  if (digitalRead(BTN_FCT_SH) == LOW && pressed) {
+    // Loco will be dispatchedturn off
+    cancelStop();
+    throttle.loco[0].dispatch();
+    throttle.setLastAddress(0);
+
+    // Loop while emergency button is pressed to avoid chatter effect
+    while (digitalRead(BTN_STOP) == LOW) {
+    }
+  }
+  else if (pressed && throttle.loco[0].getNotch() != ESTOP) {
+    // Loco will be stopped for emergency
+    throttle.loco[0].setNotch((throttle.loco[0].getNotch() >= 0) * ESTOP);
+    speed.stop();
+    startTime = millis();
+
+    // Loop while emergency button is pressed to avoid chatter effect
+    while (digitalRead(BTN_STOP) == LOW) {
+      // I want to check the time the emergency stop button is beeing pressed
+      if ((millis() - startTime) >= 5000) {
+        // WiThrottle will be turned off
+        throttle.shutdown();
+      }
+    }
+  }
+
+  // A press not leading to a stop, e. g. chatter or no loco acquired, is forgotten
+  cancelStop();
+}
+
+// Checks if a function button is pressed
+template <class Display, class SpeedInput, class Buttons>
+void Handset<Display, SpeedInput, Buttons>::btnFnLoop() {
+  /*
+   * Function buttons are read in combination with the shift button.
+   *
+   * A change is accepted after the buttons have been stable for
+   * BTN_DEBOUNCE, the same way for every function button policy. As
+   * long as a function button is pressed function is only toggled once.
+   */
+
+  unsigned int btnFctCount = buttons.count();
+                                            // Number of function buttons used in hardware setup
+  unsigned int btn = 0;                     // Function buttons pressed; bit i = button i
+  unsigned int pressed;                     // Function buttons pressed since last accepted change
+
+  buttons.scan();
+  for (unsigned int i = 0; i < btnFctCount; i++) {
+    if (buttons.isPressed(i)) {
+      bitSet(btn, i);
+    }
+  }
+
+  // I want to check if function buttons are chattering
+  if (btn != btnRaw) {
+    btnRaw = btn;
+    btnChangeTime = millis();
+    return;
+  }
+
+  // I want to check if a stable change has to be accepted
+  if (btn == btnStable || millis() - btnChangeTime < BTN_DEBOUNCE) {
+    return;
+  }
+  pressed = btn & ~btnStable;
+  btnStable = btn;
+
+  // I want to check which function buttons have been pressed
+  for (unsigned int i = 0; i < btnFctCount; i++) {
+    if (bitRead(pressed, i)) {
+      throttle.loco[0].function[i + (btnFctCount * (digitalRead(BTN_FCT_SH) == LOW))].toggle();
+      shiftUsed = true;
+    }
+  }
+}
+
+// Checks if a loco is active
+template <class Display, class SpeedInput, class Buttons>
+void Handset<Display, SpeedInput, Buttons>::ledLoop() {
+  /*
+   * Controls LED for direction and emergency stop; checks, wheather
+   * a new loco has to be acquiredand turns heartbeat on and off.
+   *
+   * TODO:
+   * IDLE-state --> both LED FWD and REV on
+   */
+
+  unsigned int direction;                   // Actual direction of loco
+
+  // I want to check if a loco is acquired
+  if (throttle.loco[0].getAcquired()) {
+    // A loco is acquired
+    direction = throttle.loco[0].getDirection();
+
+    // I want to check if the loco has already been stopped for emergency
+    if (throttle.loco[0].getNotch() == ESTOP) {
+      // Loco has already been stopped for emergency; LED blinks while reference notch > 0 without holding up the loop pass
+      if (!speed.isAtZero() && millis() - ledBlinkTime >= LED_DELAY) {
+        // Inverse LED state
+        ledBlink = !ledBlink;
+        ledBlinkTime = millis();
+        digitalWrite(ledDirPin[direction], ledBlink);
+      }
+    }
+    else if (digitalRead(ledDirPin[direction] == LOW)) {
+      // Indicate the loco's direction
+      digitalWrite(LED_STOP, LOW);
+      digitalWrite(ledDirPin[direction], HIGH);
+      digitalWrite(ledDirPin[!direction], LOW);
+    }
+  }
+  else if (!throttle.loco[0].getAcquiring()) {
+    // No loco is acquired
+    digitalWrite(LED_STOP, HIGH);
+    digitalWrite(LED_FWD, LOW);
+    digitalWrite(LED_REV, LOW);
+
+    // I want to check if a new loco can be selected from the roster by menu
+    if (Display::present && SpeedInput::canNavigate) {
+      if (!menu.isOpen()) {
+        menu.open(MENU_LOCO);
+      }
+      return;
+    }
+
+    // A new loco is acquired by DCC address typed on serial console
+    console.prompt();
+  }
+}
+
+// Checks if direction of loco needs to change
+template <class Display, class SpeedInput, class Buttons>
+void Handset<Display, SpeedInput, Buttons>::directionLoop() {
+  /*
+   * Reads reference direction from direction switch and compares
+   * actual direction with reference direction; ifactual direction
+   * is different from reference direction it is checked wheather
+   * actual DCC notch is above 0. If so loco will be stopped
+   * immediately, but direction will not change unless potentiometer
+   * has been set to 0.
+   */
+
+  int directionReference;                   // Reference direction
+
+  directionReference = speed.readDirection();
+
+  // I want to check if direction of loco needs to be changed
+  if (directionReference != int(throttle.loco[0].getDirection())) {
+    // The direction of the loco is different from the reference direction
+    switch(directionReference) {
+      case IDLE:
+        /*
+         * TODO:
+         * Define idle behaviour
+         *
+         * Idea:
+         * Use a tri state switch with 2 x 10 kOhm resistors: VCC to
+         * signal and signal to GND
+         *
+         * Code:
+         * directionReference = map(analogRead(DIR_SW), 0, 4095, 0, 2);
+         * default:
+         * directionReference = directionReference / 2;
+         *
+         * throttle.loco[0].setDirection(directionReference);
+         */
+        break;
+
+      default:
+        // I want to check if loco has to be stopped first
+        if (throttle.loco[0].getNotch() > 0) {
+          // Notch > 0, loco will be stopped
+          throttle.loco[0].setNotch(ESTOP);
+        }
+        else {
+          // Notch = 0, direction of loco is changed
+          throttle.loco[0].setDirection(directionReference);
+        }
+
+        break;
+    }
+  }
+}
+
+// Checks if speed of loco needs to change
+template <class Display, class SpeedInput, class Buttons>
+void Handset<Display, SpeedInput, Buttons>::speedLoop() {
+  unsigned int notch;                       // Reference speed translated into DCC notches
+
+  // I want to check if speed input supplied a reference notch
+  if (!speed.readNotch(notch, throttle.loco[0].getNotchRange())) {
+    return;
+  }
+
+  // I want to check if direction switch is in IDLE position
+  if (throttle.loco[0].getDirection() == IDLE) {
+    // Loco in idle mode means notch = 0
+    notch = 0;
+  }
+
+  // I want to check if loco has been stopped for emergency; it stays stopped until speed input is set to 0
+  if (throttle.loco[0].getNotch() == ESTOP && notch != 0) {
+    return;
+  }
+
+  // I want to check if notch has to be sent
+  if (millis() - notchTime >= SpeedInput::notchTimeout) {
+    // <notchTimeout> senconds passed since notch has been sent last time
+    notchTime = millis();
+    throttle.loco[0].setNotch(notch);
+  }
+}
+
+// Checks if menu is operated
+template <class Display, class SpeedInput, class Buttons>
+void Handset<Display, SpeedInput, Buttons>::menuLoop() {
+  /*
+   * Holding the shift button for MENU_OPEN_TIME opens or closes the
+   * menu, a short press executes the row the cursor is on. Using the
+   * shift button together with a function button does neither.
+   */
+
+  bool shift;                               // State of shift button
+
+  // I want to check if hardware can operate a menu
+  if (!Display::present || !SpeedInput::canNavigate) {
+    return;
+  }
+
+  shift = digitalRead(BTN_FCT_SH);
+
+  // I want to check if shift button has been pressed or released; ignore chatter
+  if (shift != shiftState && millis() - shiftTime > BTN_DEBOUNCE) {
+    shiftState = shift;
+    shiftTime = millis();
+
+    if (shift == LOW) {
+      shiftUsed = false;
+    }
+    else if (!shiftUsed && menu.isOpen()) {
+      menu.select();
+    }
+  }
+
+  // I want to check if shift button has been held long enough to open or close the menu
+  if (shiftState == LOW && !shiftUsed && millis() - shiftTime >= MENU_OPEN_TIME) {
+    shiftUsed = true;
+    if (menu.isOpen()) {
+      menu.close();
+    }
+    else {
+      menu.open(MENU_MAIN);
+    }
+  }
+
+  // I want to check if cursor has to be moved
+  if (menu.isOpen()) {
+    menu.move(speed.readSteps());
+  }
+}
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Definition of the cache of locos driven recently
+ */
+
+#include "LocoCache.h"
+#include "Log.h"
+#include <EEPROM.h>
+
+
+static_assert(EEPROM_LOCO_CACHE + LOCO_CACHE_SIZE * sizeof(locoCacheEntry) <= EEPROM_SIZE, "Loco cache doesn't fit into EEPROM");
+
+
+// EEPROM address of cache entry at <position>
+int locoCacheAddress(byte position) {
+  return EEPROM_LOCO_CACHE + position * sizeof(locoCacheEntry);
+}
+
+// Get cached loco by position, most recently used first
+bool locoCacheGet(byte position, locoCacheEntry &entry) {
+  // I want to check if position is in cache
+  if (position >= LOCO_CACHE_SIZE) {
+    return false;
+  }
+
+  EEPROM.get(locoCacheAddress(position), entry);
+
+  // Texts are terminated even if EEPROM has been written by another layout
+  entry.id[ROSTER_ID_SIZE - 1] = '\0';
+  entry.labels[LOCO_CACHE_LABELS - 1] = '\0';
+
+  // Erased EEPROM reads 0 or 65535
+  return entry.address != 0 && entry.address != 65535 && (entry.addressType == 'S' || entry.addressType == 'L');
+}
+
+// Get cached loco by address type and DCC address
+bool locoCacheFind(char addressType, unsigned int address, locoCacheEntry &entry) {
+  for (byte position = 0; position < LOCO_CACHE_SIZE; position++) {
+    // I want to check if entry holds the loco
+    if (locoCacheGet(position, entry) && entry.address == address && entry.addressType == addressType) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Put loco in front of cache
+void locoCacheStore(const locoCacheEntry &entry) {
+  /*
+   * <entry> has to be zeroed before it is filled, so unused bytes
+   * compare equal to the stored entry.
+   */
+  locoCacheEntry cached;                    // Entry stored in cache
+  byte position = LOCO_CACHE_SIZE - 1;      // Position of loco in cache; least recently used if not cached
+
+  for (byte i = 0; i < LOCO_CACHE_SIZE; i++) {
+    EEPROM.get(locoCacheAddress(i), cached);
+
+    // I want to check if entry holds the loco
+    if (cached.address == entry.address && cached.addressType == entry.addressType) {
+      position = i;
+      break;
+    }
+  }
+
+  // I want to check if loco is already in front and unchanged; then flash isn't written
+  if (position == 0 && memcmp(&cached, &entry, sizeof(entry)) == 0) {
+    return;
+  }
+
+  // Move locos used more recently one position back
+  for (byte i = position; i > 0; i--) {
+    EEPROM.get(locoCacheAddress(i - 1), cached);
+    EEPROM.put(locoCacheAddress(i), cached);
+  }
+  EEPROM.put(locoCacheAddress(0), entry);
+  EEPROM.commit();
+
+  LOG_DEBUG("Loco %c%u %s cached.", entry.addressType, entry.address, entry.id);
+}
+
+// Print cached locos numbered by position, most recently used first
+void locoCachePrint(Print &out) {
+  locoCacheEntry entry;                     // Cached loco
+
+  out.println("Recently driven locos:");
+  for (byte position = 0; position < LOCO_CACHE_SIZE; position++) {
+    // I want to check if entry is in use
+    if (locoCacheGet(position, entry)) {
+      out.printf("  %u: %5u %c %s\n", position + 1, entry.address, entry.addressType, entry.id);
+    }
+  }
+}
@@ -0,0 +1,48 @@
+/*
+ * Declaration of the cache of locos driven recently
+ *
+ * The locos a driver switches between in a session are kept in flash
+ * (emulated EEPROM), most recently used first, with their roster ID
+ * and function labels. A loco is identified by address type and DCC
+ * address, as short address 3 and long address 3 are different locos.
+ * Selecting a cached loco shows its labels at once; the label list
+ * WiThrottle server sends on acquisition only confirms them, so flash
+ * is written only if anything changed or the loco moved to the front.
+ * The loco is still acquired as selected: a roster ID kept in the cache
+ * may have been renamed since.
+ */
+
+#ifndef _LOCO_CACHE_H_
+#define _LOCO_CACHE_H_
+
+#include "CrossFunc.h"
+#include "Roster.h"
+#include <Arduino.h>
+
+
+// Loco cache
+#define LOCO_CACHE_SIZE     4               // Number of locos cached
+#define LOCO_CACHE_LABELS 160               // Space for the labels of F0 to F28 of a loco, each terminated by '\0'; the rest is cut off
+
+
+// Structures
+
+// Cached loco
+typedef struct {
+  uint16_t address;                         // DCC address; 0 if entry is empty
+  char addressType;                         // Address type; S = short, L = long
+  char id[ROSTER_ID_SIZE];                  // ID in roster, e. g. "BR 218"; "# <address>" if acquired by DCC address
+  byte labelCount;                          // Number of labels in <labels>
+  char labels[LOCO_CACHE_LABELS];           // Labels of F0 to F28 one after another, each terminated by '\0'
+} locoCacheEntry;
+
+
+// Loco cache
+bool locoCacheGet(byte position, locoCacheEntry &entry);
+                                            // Get cached loco by position, most recently used first
+bool locoCacheFind(char addressType, unsigned int address, locoCacheEntry &entry);
+                                            // Get cached loco by address type and DCC address
+void locoCacheStore(const locoCacheEntry &entry);
+                                            // Put loco in front of cache; the least recently used loco is dropped
+void locoCachePrint(Print &out);            // Print cached locos numbered by position, most recently used first
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Definition of logging
+ */
+
+#include "Log.h"
+
+
+// Ring buffer
+logRecord logRing[LOG_RECORDS];         // Log records not written yet
+unsigned int logHead = 0;               // Next record to be written to UART
+unsigned int logCount = 0;              // Number of records in ring buffer
+unsigned int logDropped = 0;            // Records dropped because ring buffer was full
+portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+                                        // Protects the ring buffer
+TaskHandle_t logTask = NULL;            // Task writing log records to UART
+
+
+// Take oldest log record out of ring buffer
+bool logPop(logRecord &record, unsigned int &dropped) {
+  bool popped = false;                  // A record has been taken out
+
+  portENTER_CRITICAL(&logMux);
+  if (logCount > 0) {
+    memcpy(&record, &logRing[logHead], sizeof(logRecord));
+    logHead = (logHead + 1) % LOG_RECORDS;
+    logCount--;
+    popped = true;
+  }
+  dropped = logDropped;
+  logDropped = 0;
+  portEXIT_CRITICAL(&logMux);
+
+  return popped;
+}
+
+// Format log record
+size_t logFormat(const logRecord &record, char* line, size_t size) {
+  /*
+   * Each conversion of the format is formatted on its own with the
+   * argument in the type the conversion expects.
+   */
+
+  static const char levels[] = "?EWID";     // Letters of log levels
+  const char* c = record.format;            // Actual character of format
+  const char* start;                        // Start of conversion
+  char spec[16];                            // Conversion
+  size_t length;                            // Length of formatted text
+  byte arg = 0;                             // Next argument
+  uint32_t value;                           // Argument
+  float floatValue;                         // Floating point argument
+  bool isLong;                              // Conversion has length modifier l
+
+  length = snprintf(line, size, "%lu.%03lu %c ", record.time / 1000, record.time % 1000, levels[min((int)record.level, 4)]);
+
+  while (*c != '\0' && length < size - 1) {
+    // I want to check if a conversion starts
+    if (*c != '%') {
+      line[length++] = *c++;
+      continue;
+    }
+    if (c[1] == '%') {
+      line[length++] = '%';
+      c += 2;
+      continue;
+    }
+
+    // Find conversion character
+    start = c++;
+    isLong = false;
+    while (*c != '\0' && strchr("diouxXcsfFeEgG", *c) == NULL) {
+      isLong |= (*c == 'l');
+      c++;
+    }
+    if (*c == '\0') {
+      break;
+    }
+    c++;
+    strlcpy(spec, start, min((size_t)(c - start + 1), sizeof(spec)));
+    value = arg < record.argCount ? record.args[arg] : 0;
+    arg++;
+
+    switch (c[-1]) {
+      case 's':
+        length += snprintf(line + length, size - length, spec, arg <= record.argCount ? record.text + value : "");
+        break;
+
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+        memcpy(&floatValue, &value, sizeof(floatValue));
+        length += snprintf(line + length, size - length, spec, (double)floatValue);
+        break;
+
+      default:
+        if (isLong) {
+          length += snprintf(line + length, size - length, spec, (unsigned long)value);
+        }
+        else {
+          length += snprintf(line + length, size - length, spec, (unsigned int)value);
+        }
+        break;
+    }
+    length = min(length, size - 1);
+  }
+
+  line[length++] = '\n';
+  line[length] = '\0';
+
+  return length;
+}
+
+// Write log records to UART
+void logWriteAll() {
+  logRecord record;                     // Log record
+  char line[LOG_LINE_SIZE + 2];         // Formatted log record incl. line feed
+  size_t length;                        // Length of formatted log record
+  unsigned int dropped;                 // Records dropped
+
+  while (logPop(record, dropped)) {
+    if (dropped > 0) {
+      Serial.printf("%u log records dropped\n", dropped);
+    }
+    length = logFormat(record, line, LOG_LINE_SIZE);
+    Serial.write((const uint8_t*)line, length);
+  }
+}
+
+// Log task
+void logSinkTask(void* parameter) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    logWriteAll();
+  }
+}
+
+
+// Logging
+
+// Start writing log records to UART in the background
+void logBegin() {
+  /*
+   * The task runs on core 0 next to the WiFi stack with low priority,
+   * while the loop runs on core 1.
+   */
+  if (logTask == NULL) {
+    xTaskCreatePinnedToCore(logSinkTask, "log", 3072, NULL, 1, &logTask, 0);
+  }
+}
+
+// Put log record into ring buffer
+void logPush(const logRecord &record) {
+  portENTER_CRITICAL(&logMux);
+  // I want to check if ring buffer is full
+  if (logCount == LOG_RECORDS) {
+    logDropped++;
+  }
+  else {
+    memcpy(&logRing[(logHead + logCount) % LOG_RECORDS], &record, sizeof(logRecord));
+    logCount++;
+  }
+  portEXIT_CRITICAL(&logMux);
+
+  if (logTask != NULL) {
+    xTaskNotifyGive(logTask);
+  }
+}
+
+// Write all log records to UART immediately, e. g. before going to sleep
+void logFlush() {
+  logWriteAll();
+  Serial.flush();
+}
+
+
+// Argument packing
+
+// Add argument to log record
+void logPutWord(logRecord &record, uint32_t value) {
+  if (record.argCount < LOG_ARGS_MAX) {
+    record.args[record.argCount++] = value;
+  }
+}
+
+// Add string argument to log record
+void logPut(logRecord &record, const char* value) {
+  /*
+   * The string is copied, as it may be gone when the record is written.
+   * Strings not fitting into the record are truncated.
+   */
+  size_t space = LOG_TEXT_SIZE - record.textLength;
+                                        // Space left for strings; at least the terminating '\0'
+  size_t length;                        // Length of string
+
+  length = strlcpy(record.text + record.textLength, value != NULL ? value : "", space);
+  logPutWord(record, record.textLength);
+  record.textLength = min(record.textLength + min(length + 1, space), (size_t)LOG_TEXT_SIZE - 1);
+}
+
+// Add floating point argument to log record
+void logPut(logRecord &record, double value) {
+  float floatValue = value;             // Argument as float
+  uint32_t bits;                        // Bits of argument
+
+  memcpy(&bits, &floatValue, sizeof(bits));
+  logPutWord(record, bits);
+}
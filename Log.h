@@ -0,0 +1,132 @@
+/*
+ * Declaration of logging
+ *
+ * Log messages are written by the macros LOG_ERROR, LOG_WARN, LOG_INFO
+ * and LOG_DEBUG with a printf-like format, e. g.
+ *
+ *   LOG_DEBUG("Set notch of loco %s to %d.", addressKey, notch);
+ *
+ * Levels above LOG_LEVEL are removed by the preprocessor, including the
+ * evaluation of their arguments. Enabled messages only store the format
+ * (a pointer to the literal) and their arguments in binary form in a
+ * ring buffer; formatting and writing to UART is done by a background
+ * task, so the caller never waits for the serial port.
+ *
+ * Format strings must be literals. Supported conversions are d, i, u,
+ * x, X, o, c, s, f, e and g, with flags, width, precision and l.
+ */
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include "CrossFunc.h"
+#include <Arduino.h>
+
+
+// Log levels
+#define LOG_LEVEL_NONE      0               // Nothing is logged
+#define LOG_LEVEL_ERROR     1               // Errors
+#define LOG_LEVEL_WARN      2               // Warnings
+#define LOG_LEVEL_INFO      3               // State changes
+#define LOG_LEVEL_DEBUG     4               // Everything sent and received
+
+#ifndef LOG_LEVEL
+  #ifdef DEBUG
+    #define LOG_LEVEL LOG_LEVEL_DEBUG       // Highest level logged
+  #else
+    #define LOG_LEVEL LOG_LEVEL_NONE        // Highest level logged
+  #endif
+#endif
+
+// Ring buffer
+#define LOG_RECORDS        32               // Number of records held by the ring buffer
+#define LOG_ARGS_MAX        6               // Maximum number of arguments of a record
+#define LOG_TEXT_SIZE      96               // Space for the string arguments of a record incl. terminating '\0's
+#define LOG_LINE_SIZE     192               // Maximum length of a formatted record
+
+
+// Structures
+
+// Log record
+typedef struct {
+  unsigned long time;                       // Timestamp; unit: ms
+  const char* format;                       // Format
+  byte level;                               // Log level
+  byte argCount;                            // Number of arguments
+  byte textLength;                          // Bytes of <text> in use
+  uint32_t args[LOG_ARGS_MAX];              // Arguments; strings are offsets in <text>, floating point values are float bits
+  char text[LOG_TEXT_SIZE];                 // String arguments, each terminated by '\0'
+} logRecord;
+
+
+// Logging
+void logBegin();                            // Start writing log records to UART in the background
+void logPush(const logRecord &record);      // Put log record into ring buffer
+void logFlush();                            // Write all log records to UART immediately, e. g. before going to sleep
+
+// Argument packing
+void logPutWord(logRecord &record, uint32_t value);
+                                            // Add argument to log record
+void logPut(logRecord &record, const char* value);
+                                            // Add string argument to log record
+inline void logPut(logRecord &record, const String &value) { logPut(record, value.c_str()); }
+inline void logPut(logRecord &record, char value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, signed char value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, unsigned char value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, short value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, unsigned short value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, int value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, unsigned int value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, long value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, unsigned long value) { logPutWord(record, value); }
+inline void logPut(logRecord &record, bool value) { logPutWord(record, value); }
+void logPut(logRecord &record, double value);
+                                            // Add floating point argument to log record
+
+inline void logPack(logRecord &record) {}
+template <typename T, typename... Args>
+inline void logPack(logRecord &record, const T &value, const Args&... args) {
+  logPut(record, value);
+  logPack(record, args...);
+}
+
+// Write log record
+template <typename... Args>
+void logWrite(byte level, const char* format, const Args&... args) {
+  logRecord record;                         // Log record
+
+  record.time = millis();
+  record.format = format;
+  record.level = level;
+  record.argCount = 0;
+  record.textLength = 0;
+  record.text[LOG_TEXT_SIZE - 1] = '\0';
+  logPack(record, args...);
+  logPush(record);
+}
+
+// Log macros
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+  #define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+  #define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+  #define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+  #define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+  #define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+  #define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  #define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+  #define LOG_DEBUG(...) do {} while (0)
+#endif
+#endif
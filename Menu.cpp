@@ -0,0 +1,259 @@
+/*
+ * Definition of the menu operated by rotary encoder and shift button
+ */
+
+#include "Menu.h"
+#include "Log.h"
+
+
+// Main menu
+const char* Menu_lvl_1[] = { "Loco", "Function", "Layout", "Throttle" };
+
+
+// Constructor
+Menu::Menu(WiThrottle &throttle) : throttle(throttle) {
+  prefix[0] = '\0';
+}
+
+
+// Menu state
+
+// Open menu at <level>
+void Menu::open(byte level) {
+  opened = true;
+  enter(level);
+}
+
+// Close menu
+void Menu::close() {
+  opened = false;
+  revision++;
+}
+
+// Check if menu is open
+bool Menu::isOpen() {
+  return opened;
+}
+
+// Show menu level
+void Menu::enter(byte level) {
+  this->level = level;
+  cursor = 0;
+  top = 0;
+
+  // I want to check if roster search has to start from scratch
+  if (level == MENU_LOCO) {
+    prefix[0] = '\0';
+    prefixLength = 0;
+    search();
+  }
+  revision++;
+}
+
+// Narrow roster to entries matching <prefix>
+void Menu::search() {
+  /*
+   * The roster is sorted by ID, so the entries matching <prefix> are
+   * found by binary search. The characters offered to extend <prefix>
+   * are the ones following it in these entries; entries with the same
+   * next character are adjacent.
+   */
+
+  char next;                                // Character following <prefix> in an ID
+
+  #if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    uint32_t startTime = micros();          // Start time of search
+  #endif
+
+  count = throttle.roster.find(prefix, first);
+
+  charCount = 0;
+  for (unsigned int i = first; i < first + count && charCount < MENU_CHARS_MAX; i++) {
+    next = toupper(throttle.roster.getId(i)[prefixLength]);
+
+    // I want to check if ID is longer than prefix and character hasn't been offered yet
+    if (next != '\0' && (charCount == 0 || chars[charCount - 1] != next)) {
+      chars[charCount++] = next;
+    }
+  }
+
+  LOG_DEBUG("Roster search '%s': %u entries, %u characters in %lu us.", prefix, count, charCount, micros() - startTime);
+}
+
+
+// Menu operation
+
+// Move cursor by <steps> rows
+void Menu::move(int steps) {
+  int row = min(max((int)cursor + steps, 0), (int)size() - 1);
+                                            // Row the cursor moves to
+
+  // I want to check if cursor has moved at all
+  if (steps == 0 || (unsigned int)row == cursor) {
+    return;
+  }
+  cursor = row;
+
+  // Keep cursor in the rows shown
+  if (cursor < top) {
+    top = cursor;
+  }
+  else if (cursor >= top + MENU_ROWS) {
+    top = cursor - MENU_ROWS + 1;
+  }
+  revision++;
+}
+
+// Execute row the cursor is on
+void Menu::select() {
+  unsigned int entry;                       // Roster entry selected
+
+  switch (level) {
+    case MENU_MAIN:
+      enter(MENU_LOCO + cursor);
+      break;
+
+    case MENU_LOCO:
+      if (cursor == 0) {
+        // I want to check if prefix can be shortened; otherwise go back to main menu
+        if (prefixLength == 0) {
+          enter(MENU_MAIN);
+          break;
+        }
+        prefix[--prefixLength] = '\0';
+      }
+      else if (cursor <= charCount) {
+        // Extend prefix by the selected character
+        if (prefixLength < sizeof(prefix) - 1) {
+          prefix[prefixLength++] = chars[cursor - 1];
+          prefix[prefixLength] = '\0';
+        }
+      }
+      else {
+        // Acquire loco selected from roster
+        entry = first + cursor - 1 - charCount;
+        throttle.loco[0].dispatch();
+        throttle.loco[0].select(throttle.roster, entry);
+        throttle.loco[0].acquire();
+        close();
+        break;
+      }
+      search();
+      cursor = 0;
+      top = 0;
+      revision++;
+      break;
+
+    case MENU_FUNCTION:
+      if (cursor == 0) {
+        enter(MENU_MAIN);
+      }
+      else {
+        throttle.loco[0].function[cursor - 1].toggle();
+        revision++;
+      }
+      break;
+
+    case MENU_LAYOUT:
+      if (cursor == 0) {
+        enter(MENU_MAIN);
+      }
+      else if (cursor == 1) {
+        throttle.switchDCCPowerOn();
+      }
+      else {
+        throttle.switchDCCPowerOff();
+      }
+      break;
+
+    case MENU_THROTTLE:
+      if (cursor == 0) {
+        enter(MENU_MAIN);
+      }
+      else if (cursor == 1) {
+        throttle.loco[0].dispatch();
+        throttle.setLastAddress(0);
+        close();
+      }
+      else {
+        throttle.shutdown();
+      }
+      break;
+  }
+}
+
+
+// Menu rendering
+
+// Get number of rows of menu level
+unsigned int Menu::size() {
+  switch (level) {
+    case MENU_MAIN:
+      return sizeof(Menu_lvl_1) / sizeof(Menu_lvl_1[0]);
+
+    case MENU_LOCO:
+      return 1 + charCount + count;
+
+    case MENU_FUNCTION:
+      return 1 + sizeof(throttle.loco[0].function) / sizeof(throttle.loco[0].function[0]);
+
+    default:
+      return 3;
+  }
+}
+
+// Get row selected
+unsigned int Menu::getCursor() {
+  return cursor;
+}
+
+// Get first row shown
+unsigned int Menu::getTop() {
+  return top;
+}
+
+// Get revision of rows shown
+unsigned int Menu::getRevision() {
+  return revision;
+}
+
+// Get text of <row>
+void Menu::getRow(unsigned int row, char* text, size_t size) {
+  static const char* layoutRows[] = { "< Back", "Power on", "Power off" };
+  static const char* throttleRows[] = { "< Back", "Dispatch", "Sleep" };
+
+  switch (level) {
+    case MENU_MAIN:
+      strlcpy(text, Menu_lvl_1[row], size);
+      break;
+
+    case MENU_LOCO:
+      if (row == 0) {
+        snprintf(text, size, prefixLength == 0 ? "< Back" : "< %s", prefix);
+      }
+      else if (row <= charCount) {
+        snprintf(text, size, "+ %c", chars[row - 1]);
+      }
+      else {
+        strlcpy(text, throttle.roster.getId(first + row - 1 - charCount), size);
+      }
+      break;
+
+    case MENU_FUNCTION:
+      if (row == 0) {
+        strlcpy(text, "< Back", size);
+      }
+      else {
+        snprintf(text, size, "%c%s", throttle.loco[0].function[row - 1].getState() == ON ? '*' : ' ', throttle.loco[0].function[row - 1].getLabel().c_str());
+      }
+      break;
+
+    case MENU_LAYOUT:
+      strlcpy(text, layoutRows[row], size);
+      break;
+
+    case MENU_THROTTLE:
+      strlcpy(text, throttleRows[row], size);
+      break;
+  }
+}
@@ -0,0 +1,76 @@
+/*
+ * Declaration of the menu operated by rotary encoder and shift button
+ */
+
+#ifndef _MENU_H_
+#define _MENU_H_
+
+#include "CrossFunc.h"
+#include "Roster.h"
+#include "WiThrottle.h"
+#include <Arduino.h>
+
+
+// Menu levels
+#define MENU_MAIN           0               // Main menu
+#define MENU_LOCO           1               // Roster with prefix search
+#define MENU_FUNCTION       2               // Functions of active loco
+#define MENU_LAYOUT         3               // Track power
+#define MENU_THROTTLE       4               // Dispatch and sleep
+
+// Menu layout
+#define MENU_ROWS          11               // Rows shown at once; fits OLED_AREA_3
+#define MENU_TEXT_SIZE     11               // Maximum length of a row incl. terminating '\0'
+#define MENU_CHARS_MAX     40               // Maximum number of characters offered to extend the search prefix
+#define MENU_OPEN_TIME   1000               // Holding shift button this long opens or closes the menu; unit: ms
+
+class Menu {
+  private:
+    // WiThrottle
+    WiThrottle &throttle;                   // WiThrottle operated by the menu
+
+    // Menu state
+    bool opened = false;                    // Menu is open
+    byte level = MENU_MAIN;                 // Menu level shown
+    unsigned int cursor = 0;                // Row selected
+    unsigned int top = 0;                   // First row shown
+    unsigned int revision = 0;              // Incremented whenever the rows shown change
+
+    // Roster search
+    char prefix[ROSTER_ID_SIZE];            // Prefix of IDs searched for
+    byte prefixLength = 0;                  // Length of <prefix>
+    unsigned int first = 0;                 // First roster entry matching <prefix>
+    unsigned int count = 0;                 // Number of roster entries matching <prefix>
+    char chars[MENU_CHARS_MAX];             // Characters extending <prefix> to a match
+    byte charCount = 0;                     // Number of characters in <chars>
+
+    void enter(byte level);                 // Show menu level
+    void search();                          // Narrow roster to entries matching <prefix>
+
+  public:
+    // Constructor
+    Menu(WiThrottle &throttle);
+
+    // Menu state
+    void open(byte level);                  // Open menu at <level>
+    void close();                           // Close menu
+    bool isOpen();                          // Check if menu is open
+
+    // Menu operation
+    void move(int steps);                   // Move cursor by <steps> rows
+    void select();                          // Execute row the cursor is on
+
+    // Menu rendering
+    /*
+     * Only the rows from getTop() to getTop() + MENU_ROWS have to be
+     * rendered; the rows are built on request from the roster and the
+     * loco, so the size of the roster doesn't matter.
+     */
+    unsigned int size();                    // Get number of rows of menu level
+    unsigned int getCursor();               // Get row selected
+    unsigned int getTop();                  // Get first row shown
+    unsigned int getRevision();             // Get revision of rows shown
+    void getRow(unsigned int row, char* text, size_t size);
+                                            // Get text of <row>
+};
+#endif
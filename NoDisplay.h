@@ -0,0 +1,26 @@
+/*
+ * Declaration of the display policy for hardware without display
+ */
+
+#ifndef _NO_DISPLAY_H_
+#define _NO_DISPLAY_H_
+
+#include "Menu.h"
+#include "WiThrottle.h"
+#include <Arduino.h>
+
+
+class NoDisplay {
+  public:
+    static const bool present = false;      // Hardware has no display
+
+    // Display initialization
+    bool begin() { return true; }
+
+    // Display update
+    void update(WiThrottle &throttle) {}    // Show state of WiThrottle
+    void showMenu(Menu &menu) {}            // Show rows of menu
+    static void showMessage(const String &message, byte messageType) {}
+                                            // Show message
+};
+#endif
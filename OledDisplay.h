@@ -0,0 +1,389 @@
+/*
+ * Declaration of the display policy for hardware with I2C OLED display
+ */
+
+#ifndef _OLED_DISPLAY_H_
+#define _OLED_DISPLAY_H_
+
+#include "CrossFunc.h"
+#include "Menu.h"
+#include "Symbols.h"
+#include "VirtualLoco.h"
+#include "WiThrottle.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+#include <TimeLib.h>  // https://github.com/PaulStoffregen/Time
+
+
+// I2C OLED display
+/*
+ * The policy headers are included by the sketch only, but they are
+ * header-only, so everything defined here is inline; objects are
+ * function-local statics created on first use.
+ */
+inline Adafruit_SSD1306 &oled() {
+  static Adafruit_SSD1306 display(OLED_WIDTH, OLED_HEIGHT, &Wire, OLED_RESET);
+                                            // I2C OLED display
+  return display;
+}
+
+// Asynchronous transfer
+/*
+ * Everything is drawn into the back buffer of oled(). At the end of a
+ * frame the back buffer is copied into the front buffer, and a
+ * background task transfers the front buffer to the display. So loop
+ * passes never wait for the I2C bus; a frame finished while a transfer
+ * is running is handed over at the next update.
+ *
+ * Wire serializes the transmissions of the transfer task and of the
+ * loop task, e. g. reading the PCF8574.
+ */
+typedef struct {
+  uint8_t front[OLED_WIDTH * OLED_HEIGHT / 8];
+                                            // Frame being transferred to display
+  volatile bool busy;                       // Transfer of front buffer is running
+  TaskHandle_t task;                        // Task transferring front buffer
+} oledTransferState;
+
+// Get state of asynchronous transfer
+inline oledTransferState &oledTransferring() {
+  static oledTransferState state = {};      // State of asynchronous transfer
+  return state;
+}
+
+// Transfer front buffer to display
+inline void oledTransfer() {
+  static const uint8_t window[] = { 0x00, SSD1306_PAGEADDR, 0, 0xFF, SSD1306_COLUMNADDR, 0, OLED_WIDTH - 1 };
+                                            // Command stream setting the whole display as target
+  const uint8_t* front = oledTransferring().front;
+                                            // Frame being transferred
+  const size_t size = sizeof(oledTransferring().front);
+                                            // Size of frame
+
+  Wire.beginTransmission(OLED_I2C);
+  Wire.write(window, sizeof(window));
+  Wire.endTransmission();
+
+  for (unsigned int i = 0; i < size; i += OLED_CHUNK_SIZE) {
+    Wire.beginTransmission(OLED_I2C);
+    Wire.write(0x40);                       // Data stream follows
+    Wire.write(front + i, min((size_t)OLED_CHUNK_SIZE, size - i));
+    Wire.endTransmission();
+  }
+}
+
+// Transfer front buffer whenever a frame has been handed over
+inline void oledTransferTask(void *parameter) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    oledTransfer();
+    oledTransferring().busy = false;
+  }
+}
+
+// Loco symbol
+#define OLED_LOCO_NONE      0               // No loco selected
+#define OLED_LOCO_SELECTED  1               // Loco selected
+#define OLED_LOCO_ACQUIRED  2               // Loco acquired
+
+// Menu
+#define OLED_MENU_ROW_H    10               // Height of a menu row in pixels
+
+class OledDisplay {
+  private:
+    // Boot sequence
+    bool bootMessage = false;               // Boot sequence message is shown
+    uint32_t bootTime;                      // Timestamp boot sequence message has been shown
+
+    // State shown on display
+    bool wiFiShown = false;                 // WiFi symbol is shown
+    bool jmriShown = false;                 // JMRI symbol is shown
+    byte locoShown = OLED_LOCO_NONE;        // Loco symbol shown
+    byte directionShown = IDLE;             // Direction symbol shown
+    unsigned long timeStampFC = 0;          // Fast clock time shown
+    bool menuShown = false;                 // Menu is shown
+    unsigned int menuRevision = 0;          // Revision of menu rows shown
+
+    // Asynchronous transfer
+    bool pending = false;                   // Frame has been drawn, but not handed over yet
+    static bool swap(bool wait);            // Hand drawn frame over to transfer task
+
+  public:
+    static const bool present = true;       // Hardware has a display
+
+    // Display initialization
+    bool begin();
+
+    // Display update
+    void update(WiThrottle &throttle);      // Show state of WiThrottle
+    void showMenu(Menu &menu);              // Show rows of menu
+    static void showMessage(const String &message, byte messageType);
+                                            // Show message
+};
+
+
+// Display initialization
+inline bool OledDisplay::begin() {
+  String bootMessage;                       // Boot sequence message
+
+  // Start OLED display
+  /*
+   * SSD1306_SWITCHCAPVCC = generate display voltage from 3.3V internally
+   */
+
+  // I want to check if WiThrottle was able to start display
+  if (!oled().begin(SSD1306_SWITCHCAPVCC, OLED_I2C)) {
+    return false;
+  }
+
+  // I want to check if WiThrottle was able to start transfer task
+  if (xTaskCreate(oledTransferTask, "oled", 2048, NULL, 1, &oledTransferring().task) != pdPASS) {
+    return false;
+  }
+  Wire.setClock(OLED_I2C_CLOCK);
+
+  // Display is active
+  oled().setRotation(3);
+  oled().setTextSize(1);
+  oled().setTextColor(OLED_COLOR_WHITE);
+  oled().clearDisplay();
+
+  // Write boot sequence message to display
+  bootMessage = "WiThrottle\n\nAn FSMD\nproject\nV " + String(SW_VERSION) + "\n\n(c) " + String(SW_RELEASE_YEAR) + "\n\n" + String(SW_LICENSE);
+  oled().setCursor(0, 48);
+  oled().println(bootMessage);
+  oled().drawBitmap(4, 4, imgBootSequence56x32, 56, 32, OLED_COLOR_WHITE);
+  swap(true);
+
+  this->bootMessage = true;
+  bootTime = millis();
+
+  return true;
+}
+
+
+// Display update
+
+// Show state of WiThrottle
+inline void OledDisplay::update(WiThrottle &throttle) {
+  bool changed = false;                     // Display has to be refreshed
+  bool wiFi = throttle.getConnectedToWiFi();
+  bool jmri = throttle.getConnectedToJMRI();
+  byte loco = OLED_LOCO_NONE;
+  byte direction = IDLE;
+  unsigned long timeStampAct;               // Actual timestamp for fast clock
+  unsigned int x = (OLED_HEIGHT - (5 * 6)) / 2 + 2;
+                                            // x-position of fast clock on display
+
+  // I want to check if boot sequence message is still shown
+  if (bootMessage) {
+    // Wait to keep boot message readable
+    if (millis() - bootTime < 2500) {
+      return;
+    }
+    bootMessage = false;
+    oled().clearDisplay();
+    changed = true;
+  }
+
+  // WiFi symbol
+  if (wiFi != wiFiShown) {
+    oled().drawBitmap(OLED_WIFI_X, OLED_AREA_1_Y, imgWiFi16x16, 16, 16, wiFi ? OLED_COLOR_WHITE : OLED_COLOR_BLACK);
+    wiFiShown = wiFi;
+    changed = true;
+  }
+
+  // JMRI symbol
+  if (jmri != jmriShown) {
+    if (jmri) {
+      // Clear other areas on display
+      oled().fillRect(OLED_AREA_2_X, OLED_AREA_2_Y, OLED_AREA_2_W, OLED_AREA_2_H, OLED_COLOR_BLACK);
+      oled().fillRect(OLED_AREA_3_X, OLED_AREA_3_Y, OLED_AREA_3_W, OLED_AREA_3_H, OLED_COLOR_BLACK);
+      directionShown = IDLE;
+      timeStampFC = 0;
+      menuShown = false;
+    }
+    oled().drawBitmap(OLED_JMRI_X, OLED_AREA_1_Y, imgJMRI16x16, 16, 16, jmri ? OLED_COLOR_WHITE : OLED_COLOR_BLACK);
+    jmriShown = jmri;
+    changed = true;
+  }
+
+  // Symbol for 1 loco
+  if (throttle.loco[0].getAddress() != 0) {
+    loco = throttle.loco[0].getAcquired() ? OLED_LOCO_ACQUIRED : OLED_LOCO_SELECTED;
+  }
+  if (loco != locoShown) {
+    oled().drawBitmap(0, 0, imgOneInverted16x16, 16, 16, OLED_COLOR_BLACK);
+    oled().drawBitmap(0, 0, imgOne16x16, 16, 16, OLED_COLOR_BLACK);
+    if (loco == OLED_LOCO_SELECTED) {
+      oled().drawBitmap(0, 0, imgOne16x16, 16, 16, OLED_COLOR_WHITE);
+    }
+    else if (loco == OLED_LOCO_ACQUIRED) {
+      oled().drawBitmap(0, 0, imgOneInverted16x16, 16, 16, OLED_COLOR_WHITE);
+    }
+    locoShown = loco;
+    changed = true;
+  }
+
+  // Direction symbols
+  if (loco == OLED_LOCO_ACQUIRED) {
+    direction = throttle.loco[0].getDirection();
+  }
+  if (direction != directionShown) {
+    oled().drawBitmap(OLED_FWD_X, OLED_AREA_2_Y, imgFWD7x7, 7, 7, direction == FWD);
+    oled().drawBitmap(OLED_REV_X, OLED_AREA_2_Y, imgREV7x7, 7, 7, direction == REV);
+    directionShown = direction;
+    changed = true;
+  }
+
+  // Fast clock
+  if (jmri) {
+    timeStampAct = throttle.getFastClock();
+    if (hour(timeStampAct) != hour(timeStampFC) || minute(timeStampAct) != minute(timeStampFC)) {
+      oled().setTextColor(OLED_COLOR_BLACK);
+      oled().setCursor(x, OLED_AREA_2_Y);
+      oled().printf("%02d:%02d", hour(timeStampFC), minute(timeStampFC));
+
+      timeStampFC = timeStampAct;
+
+      oled().setTextColor(OLED_COLOR_WHITE);
+      oled().setCursor(x, OLED_AREA_2_Y);
+      oled().printf("%02d:%02d", hour(timeStampFC), minute(timeStampFC));
+      changed = true;
+    }
+  }
+
+  // I want to check if display has to be refreshed
+  if (changed) {
+    pending = true;
+  }
+  if (pending && swap(false)) {
+    pending = false;
+  }
+}
+
+// Show rows of menu
+inline void OledDisplay::showMenu(Menu &menu) {
+  /*
+   * Only the rows visible in OLED_AREA_3 are requested from the menu,
+   * and only if they have changed.
+   */
+
+  char text[MENU_TEXT_SIZE];                // Text of menu row
+  unsigned int y;                           // y-position of menu row on display
+
+  // I want to check if boot sequence message is still shown
+  if (bootMessage) {
+    return;
+  }
+
+  // I want to check if menu has been closed
+  if (!menu.isOpen()) {
+    if (menuShown) {
+      oled().fillRect(OLED_AREA_3_X, OLED_AREA_3_Y, OLED_AREA_3_W, OLED_AREA_3_H, OLED_COLOR_BLACK);
+      menuShown = false;
+      pending = true;
+    }
+    return;
+  }
+
+  // I want to check if rows shown have changed
+  if (menuShown && menu.getRevision() == menuRevision) {
+    return;
+  }
+
+  oled().fillRect(OLED_AREA_3_X, OLED_AREA_3_Y, OLED_AREA_3_W, OLED_AREA_3_H, OLED_COLOR_BLACK);
+  for (unsigned int row = menu.getTop(); row < menu.size() && row < menu.getTop() + MENU_ROWS; row++) {
+    menu.getRow(row, text, sizeof(text));
+    y = OLED_AREA_3_Y + (row - menu.getTop()) * OLED_MENU_ROW_H;
+
+    // I want to check if row is selected
+    if (row == menu.getCursor()) {
+      oled().fillRect(OLED_AREA_3_X, y, OLED_AREA_3_W, OLED_MENU_ROW_H, OLED_COLOR_WHITE);
+      oled().setTextColor(OLED_COLOR_BLACK);
+    }
+    else {
+      oled().setTextColor(OLED_COLOR_WHITE);
+    }
+    oled().setCursor(OLED_AREA_3_X + 1, y + 1);
+    oled().print(text);
+  }
+  oled().setTextColor(OLED_COLOR_WHITE);
+
+  menuShown = true;
+  menuRevision = menu.getRevision();
+  pending = true;
+}
+
+// Hand drawn frame over to transfer task
+inline bool OledDisplay::swap(bool wait) {
+  /*
+   * If <wait> is false, nothing is done while a transfer is running;
+   * otherwise WiThrottle waits for the running transfer to finish.
+   */
+
+  oledTransferState &transfer = oledTransferring();
+                                            // State of asynchronous transfer
+
+  // I want to check if the front buffer is still being transferred
+  while (transfer.busy) {
+    if (!wait) {
+      return false;
+    }
+    vTaskDelay(1);
+  }
+
+  memcpy(transfer.front, oled().getBuffer(), sizeof(transfer.front));
+
+  // I want to check if transfer task is running; otherwise transfer directly
+  if (transfer.task == NULL) {
+    oledTransfer();
+    return true;
+  }
+  transfer.busy = true;
+  xTaskNotifyGive(transfer.task);
+
+  return true;
+}
+
+// Show message
+inline void OledDisplay::showMessage(const String &message, byte messageType) {
+  /*
+   * Line breaks are necessary for a proper readable message
+   * and have to be part of the text set by <message>
+   */
+
+  oled().clearDisplay();
+
+  switch (messageType) {
+    case MSG_ERROR:
+      // Write error message and error symbol on display
+      oled().setCursor(0, 30);
+      oled().println(message);
+      oled().drawBitmap(0, 0, imgExlamation16x16, 16, 16, OLED_COLOR_WHITE);
+      swap(true);
+      break;
+
+    case MSG_SHUTDOWN:
+      // Write shutdown sequence message on display
+      oled().setCursor(0, 48);
+      oled().println(message);
+      oled().drawBitmap(4, 4, imgBootSequence56x32, 56, 32, OLED_COLOR_WHITE);
+      swap(true);
+
+      // Wait to keep shutdown message readable
+      delay(2500);
+
+      oled().clearDisplay();
+      swap(true);
+
+      // Wait for display to be cleared before WiThrottle goes to sleep
+      while (oledTransferring().busy) {
+        vTaskDelay(1);
+      }
+      break;
+  }
+}
+#endif
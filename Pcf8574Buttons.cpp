@@ -0,0 +1,20 @@
+/*
+ * Definition of the interrupt service routine of the PCF8574 INT line
+ *
+ * Data shared with the interrupt service routine is defined here once,
+ * so Pcf8574Buttons.h stays includable by any number of sources.
+ */
+
+#include "Pcf8574Buttons.h"
+
+
+// Interrupt line
+volatile bool pcfChanged = true;            // Port has changed since last read; true to read initial state
+
+// Note change of port expander's pins
+void IRAM_ATTR pcfISR() {
+  pcfChanged = true;
+
+  // Pressing a function button ends waiting idle between loop passes
+  PowerManager::wake();
+}
@@ -0,0 +1,84 @@
+/*
+ * Declaration of the function button policy for hardware with function
+ * buttons connected to an I2C port expander PCF8574
+ */
+
+#ifndef _PCF8574_BUTTONS_H_
+#define _PCF8574_BUTTONS_H_
+
+#include "CrossFunc.h"
+#include "Power.h"
+#include <Arduino.h>
+#include <Wire.h>
+
+
+// Interrupt line
+/*
+ * The PCF8574 pulls INT low whenever one of its pins changes and
+ * releases it when the port is read. So the port is only read via I2C
+ * after INT fired, and the bus is left to the display otherwise.
+ */
+extern volatile bool pcfChanged;            // Port has changed since last read; true to read initial state
+
+void IRAM_ATTR pcfISR();                    // Note change of port expander's pins
+
+class Pcf8574Buttons {
+  private:
+    byte port = 0xFF;                       // Last state of the port expander's pins; LOW = pressed
+
+  public:
+    // Function button initialization
+    void begin();
+
+    // Function buttons
+    unsigned int count();                   // Get number of function buttons
+    void scan();                            // Read state of function buttons
+    bool isPressed(unsigned int btn);       // Check if function button is pressed
+};
+
+
+// Function button initialization
+inline void Pcf8574Buttons::begin() {
+  Wire.begin(OLED_SDA, OLED_SCL);
+
+  // All pins are used as inputs with weak pull-up
+  Wire.beginTransmission(PCF_I2C);
+  Wire.write(0xFF);
+  Wire.endTransmission();
+
+  pinMode(PCF_INT, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(PCF_INT), pcfISR, FALLING);
+}
+
+
+// Function buttons
+
+// Get number of function buttons
+inline unsigned int Pcf8574Buttons::count() {
+  return PCF_BTN_COUNT;
+}
+
+// Read state of function buttons
+inline void Pcf8574Buttons::scan() {
+  // I want to check if a pin has changed since last read
+  if (!pcfChanged) {
+    return;
+  }
+
+  // Clear flag before reading, so a change during the transfer is not lost
+  pcfChanged = false;
+
+  // I want to check if port expander answered; otherwise try again next time
+  if (Wire.requestFrom(PCF_I2C, 1) == 1) {
+    port = Wire.read();
+  }
+  else {
+    pcfChanged = true;
+  }
+}
+
+// Check if function button is pressed
+inline bool Pcf8574Buttons::isPressed(unsigned int btn) {
+  return bitRead(port, btn) == LOW;
+}
+#endif
@@ -0,0 +1,265 @@
+/*
+ * Declaration of the speed input policy for hardware with potentiometer
+ * and direction switch
+ */
+
+#ifndef _POT_SPEED_INPUT_H_
+#define _POT_SPEED_INPUT_H_
+
+#include "CrossFunc.h"
+#include "VirtualLoco.h"
+#include <Arduino.h>
+#include <limits.h>
+#include <driver/adc.h>
+#include <MedianFilter.h>   // https://github.com/daPhoosa/MedianFilter
+
+
+// ADC to notch tables
+#define ADC_TABLE_14        0               // DCC 14 speed step mode
+#define ADC_TABLE_28        1               // DCC 28 speed step mode
+#define ADC_TABLE_128       2               // DCC 128 speed step mode
+
+class PotSpeedInput {
+  private:
+    MedianFilter signalFiltered;            // Filter the block values for proper notching
+    byte adcTable[3][ADC_TABLE_SIZE];       // ADC to notch tables for each speed step mode
+    byte channel;                           // ADC1 channel of potentiometer
+    unsigned int signal = 0;                // Filtered signal read from potentiometer
+    uint32_t sampleTime = 0;                // Timestamp ADC has been started for last block
+    bool converting = false;                // ADC is converting a block
+    uint8_t block[POT_BLOCK_SIZE * SOC_ADC_DIGI_RESULT_BYTES];
+                                            // Conversion results of one block read from DMA buffer
+
+    void buildTable(byte table, unsigned int notchRange, unsigned int boundaryArea);
+                                            // Precompute ADC to notch table
+    bool sample();                          // Convert a block of samples if it is due
+
+  public:
+    static const bool hasDirectionSwitch = true;
+                                            // Hardware has a direction switch
+    static const unsigned int notchTimeout = 250;
+                                            // Time before notch information is send next time to WiThrottle server
+    static const bool canNavigate = false;  // Speed input can't operate the menu
+
+    // Constructor
+    PotSpeedInput() : signalFiltered(POT_FILTER_SIZE, 0) {}
+
+    // Speed input initialization
+    void begin();
+
+    // Direction
+    int readDirection();                    // Read reference direction from direction switch
+
+    // Notch
+    bool readNotch(unsigned int &notch, byte notchRange);
+                                            // Read reference notch from potentiometer
+    bool isAtZero();                        // Check if potentiometer is set to 0
+    void stop() {}                          // Reference notch is set by turning the potentiometer back to 0
+    unsigned long getSampleTimeout();       // Get time until the block being converted can be collected; unit: ms
+
+    // Menu
+    int readSteps() { return 0; }           // Potentiometer doesn't operate the menu
+};
+
+
+// Speed input initialization
+inline void PotSpeedInput::begin() {
+  pinMode(DIR_SW, INPUT);
+
+  // I want to make min and max area less sensitive depending on the DCC speed step mode
+  buildTable(ADC_TABLE_14, 13, 1);
+  buildTable(ADC_TABLE_28, 27, 3);
+  buildTable(ADC_TABLE_128, 126, 10);
+
+  // Sample potentiometer by ADC continuous mode into DMA buffer
+  /*
+   * ADC1 converts the potentiometer at POT_SAMPLE_FREQ without CPU load,
+   * but only one block every POT_SAMPLE_INTERVAL (see sample()).
+   * analogRead() must not be used on ADC1 pins any more.
+   */
+  adc_digi_init_config_t dmaConfig;         // DMA buffer configuration
+  adc_digi_configuration_t adcConfig;       // ADC continuous mode configuration
+  adc_digi_pattern_config_t pattern;        // Channel converted by ADC
+
+  channel = digitalPinToAnalogChannel(POT_SIG);
+
+  dmaConfig.max_store_buf_size = 2 * sizeof(block);
+  dmaConfig.conv_num_each_intr = sizeof(block);
+  dmaConfig.adc1_chan_mask = 1 << channel;
+  dmaConfig.adc2_chan_mask = 0;
+  adc_digi_initialize(&dmaConfig);
+
+  pattern.atten = ADC_ATTEN_DB_11;
+  pattern.channel = channel;
+  pattern.unit = 0;                         // ADC1
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adcConfig.conv_limit_en = true;
+  adcConfig.conv_limit_num = 250;
+  adcConfig.pattern_num = 1;
+  adcConfig.adc_pattern = &pattern;
+  adcConfig.sample_freq_hz = POT_SAMPLE_FREQ;
+  adcConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  adcConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  adc_digi_controller_configure(&adcConfig);
+}
+
+// Precompute ADC to notch table
+inline void PotSpeedInput::buildTable(byte table, unsigned int notchRange, unsigned int boundaryArea) {
+  /*
+   * Each entry holds the notch to be sent for the ADC values it covers:
+   * the speed step is taken from the middle of the potentiometer's
+   * travel, leaving <boundaryArea> speed steps at both ends, and scaled
+   * to the 0 to 126 range of WiThrottle server. So only notches that
+   * fall on a speed step of the loco are sent.
+   */
+
+  unsigned int potentiometerSignal;         // Signal read from potentiometer; value ranges from 0 to 4095 (12 bit resolution)
+  unsigned int step;                        // Speed step
+
+  for (unsigned int i = 0; i < ADC_TABLE_SIZE; i++) {
+    potentiometerSignal = (i << ADC_TABLE_SHIFT) + (1 << ADC_TABLE_SHIFT) / 2;
+    step = map(potentiometerSignal, 0, 4095, 0, notchRange + 2 * boundaryArea);
+    step = min(max(step, boundaryArea), notchRange + boundaryArea) - boundaryArea;
+    adcTable[table][i] = (step * NOTCH_MAX + notchRange / 2) / notchRange;
+  }
+}
+
+
+// Convert a block of samples if it is due
+inline bool PotSpeedInput::sample() {
+  /*
+   * The ADC only runs while a block is converted: while started, the
+   * driver of ADC continuous mode holds a power management lock at
+   * maximum APB frequency, which keeps the CPU out of light sleep while
+   * waiting idle between loop passes (see Power.cpp). So the ADC is
+   * started every POT_SAMPLE_INTERVAL and stopped again as soon as the
+   * block has been collected. The block isn't waited for: a later loop
+   * pass collects it once converted, i. e. after POT_BLOCK_TIME, and
+   * waiting idle ends then (see getSampleTimeout()).
+   *
+   * Each block is averaged to one value, which is flattened by a median
+   * filter; so the filter is fed with evenly spaced values regardless
+   * of the time a loop pass takes.
+   */
+
+  uint32_t length;                          // Number of bytes read from DMA buffer
+  esp_err_t result;                         // Result of reading a block
+  unsigned long sum = 0;                    // Sum of samples in block
+  unsigned int count = 0;                   // Number of samples in block
+  adc_digi_output_data_t *conversion;       // Conversion result
+
+  // I want to check if a block is being converted
+  if (!converting) {
+    // I want to check if next block is due
+    if (millis() - sampleTime < POT_SAMPLE_INTERVAL) {
+      return false;
+    }
+    sampleTime = millis();
+
+    // Blocks converted before the last stop took effect are stale
+    while (adc_digi_read_bytes(block, sizeof(block), &length, 0) == ESP_OK) {
+    }
+
+    adc_digi_start();
+    converting = true;
+    return false;
+  }
+
+  // I want to check if block has been converted
+  result = adc_digi_read_bytes(block, sizeof(block), &length, 0);
+  if (result != ESP_OK) {
+    // I want to check if block is overdue; then ADC is started again when next block is due
+    if (millis() - sampleTime >= POT_SAMPLE_INTERVAL) {
+      adc_digi_stop();
+      converting = false;
+    }
+    return false;
+  }
+  adc_digi_stop();
+  converting = false;
+
+  for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+    conversion = (adc_digi_output_data_t*)&block[i];
+    if (conversion->type1.channel == channel) {
+      sum += conversion->type1.data;
+      count++;
+    }
+  }
+
+  // I want to check if block holds any sample of the potentiometer
+  if (count == 0) {
+    return false;
+  }
+  signal = signalFiltered.in(sum / count);
+
+  return true;
+}
+
+
+// Direction
+
+// Read reference direction from direction switch
+inline int PotSpeedInput::readDirection() {
+  return !digitalRead(DIR_SW);
+}
+
+
+// Notch
+
+// Read reference notch from potentiometer
+inline bool PotSpeedInput::readNotch(unsigned int &notch, byte notchRange) {
+  /*
+   * To avoid unnecessary server communication the average value is 
+   * flattened by a median filter.
+   *
+   * A reference notch is only supplied if a new block of samples has
+   * been converted since last call.
+   */
+
+  byte table;                               // ADC to notch table matching the speed step mode
+
+  // I want to check if a new block of samples has been converted
+  if (!sample()) {
+    return false;
+  }
+
+  switch(notchRange) {
+    case 13:
+      table = ADC_TABLE_14;
+      break;
+
+    case 27:
+      table = ADC_TABLE_28;
+      break;
+
+    default:
+      table = ADC_TABLE_128;
+      break;
+  }
+
+  notch = adcTable[table][signal >> ADC_TABLE_SHIFT];
+
+  return true;
+}
+
+// Check if potentiometer is set to 0
+inline bool PotSpeedInput::isAtZero() {
+  sample();
+
+  return (signal >> ADC_TABLE_SHIFT) == 0;
+}
+
+// Get time until the block being converted can be collected; unit: ms
+inline unsigned long PotSpeedInput::getSampleTimeout() {
+  unsigned long elapsed = millis() - sampleTime;
+                                            // Time since ADC has been started; unit: ms
+
+  // I want to check if a block is being converted
+  if (!converting) {
+    return ULONG_MAX;
+  }
+
+  return elapsed < POT_BLOCK_TIME ? POT_BLOCK_TIME - elapsed : 1;
+}
+#endif
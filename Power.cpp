@@ -0,0 +1,187 @@
+/*
+ * Definition of power saving between loop passes
+ */
+
+#include "Power.h"
+#include "Log.h"
+
+#ifdef CONFIG_PM_ENABLE
+  #include <esp_pm.h>
+#endif
+
+
+TaskHandle_t loopTask = NULL;           // Task executing the loop passes
+
+
+// Power manager initialization
+void PowerManager::begin() {
+  loopTask = xTaskGetCurrentTaskHandle();
+  activityTime = millis();
+  statsTime = millis();
+  driveTime = millis();
+
+  #ifdef CONFIG_PM_ENABLE
+    // If power management is built into the core, idle waits enter light sleep automatically
+    esp_pm_config_esp32_t pmConfig;
+    pmConfig.max_freq_mhz = 240;
+    pmConfig.min_freq_mhz = 80;
+    pmConfig.light_sleep_enable = true;
+    esp_pm_configure(&pmConfig);
+  #endif
+}
+
+
+// Idle detection
+
+// Note activity, e. g. input or communication
+void PowerManager::activity() {
+  activityTime = millis();
+}
+
+// Check if there has been no activity for IDLE_AFTER
+bool PowerManager::isIdle() {
+  return millis() - activityTime >= IDLE_AFTER;
+}
+
+// Wait for <timeout> ms at most, but not longer than IDLE_LATENCY
+void PowerManager::idle(unsigned long timeout) {
+  /*
+   * The loop task blocks instead of spinning, so the CPU is clock gated
+   * by the idle task (and put into light sleep with WiFi kept in modem
+   * sleep, if the core is built with power management).
+   *
+   * Waiting ends early on
+   * - an interrupt calling wake(), e. g. emergency stop button,
+   * - data sent by WiThrottle server, checked every IDLE_POLL.
+   */
+
+  uint32_t startTime = millis();            // Start of idle wait
+  uint32_t startMicros = micros();          // Start of idle wait, for statistics
+  unsigned long duration;                   // Duration of idle wait; unit: ms
+  unsigned long elapsed;                    // Time waited so far; unit: ms
+
+  #if LOG_LEVEL >= LOG_LEVEL_INFO
+    // I want to check if statistics have to be reported
+    if (millis() - statsTime >= POWER_STATS_INTERVAL) {
+      printStats(Serial);
+    }
+  #endif
+
+  // I want to check if loop passes are idle and next deadline is ahead
+  if (!isIdle() || timeout == 0) {
+    return;
+  }
+
+  duration = min(timeout, (unsigned long)IDLE_LATENCY);
+
+  #ifdef VIRTUAL_TIME
+    // Waiting idle only advances the virtual clock
+    delay(duration);
+    idleTime += duration * 1000;
+    return;
+  #endif
+
+  // Forget wake ups that happened while loop pass was executed, but not an emergency stop
+  ulTaskNotifyTake(pdTRUE, 0);
+  if (isStopRequested()) {
+    return;
+  }
+
+  do {
+    // I want to check if wait has been ended by an interrupt
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(min(duration - (millis() - startTime), (unsigned long)IDLE_POLL))) > 0) {
+      activity();
+      break;
+    }
+
+    // I want to check if WiThrottle server sent data
+    if (availableCmd()) {
+      break;
+    }
+
+    elapsed = millis() - startTime;
+  } while (elapsed < duration);
+
+  idleTime += micros() - startMicros;
+}
+
+// Wake up from waiting idle; to be called by interrupt service routines
+void IRAM_ATTR PowerManager::wake() {
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  if (loopTask != NULL) {
+    vTaskNotifyGiveFromISR(loopTask, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+  }
+}
+
+
+// WiFi power save
+
+// Turn WiFi power save off while driving and on again WIFI_PS_AFTER later
+void PowerManager::wiFiLoop(bool driving) {
+  /*
+   * In modem sleep, the WiFi station only wakes up for beacons, so data
+   * sent by WiThrottle server is delayed by up to a beacon interval
+   * (typically 100 ms). That doesn't matter while the loco stands, but
+   * while driving every speed change and its confirmation would wait.
+   */
+
+  if (driving) {
+    driveTime = millis();
+
+    // I want to check if WiFi is still in modem sleep
+    if (wiFiPowerSave) {
+      WiFi.setSleep(WIFI_PS_NONE);
+      wiFiPowerSave = false;
+      wiFiAwakeSince = millis();
+      LOG_DEBUG("WiFi power save off.");
+    }
+  }
+  else if (!wiFiPowerSave && millis() - driveTime >= WIFI_PS_AFTER) {
+    WiFi.setSleep(WIFI_PS_MIN_MODEM);
+    wiFiPowerSave = true;
+    wiFiAwakeTime += millis() - wiFiAwakeSince;
+    LOG_DEBUG("WiFi power save on.");
+  }
+}
+
+
+// Statistics
+
+// Print duty cycle, WiFi power save and estimated current
+bool PowerManager::printStats(Print &out) {
+  /*
+   * Statistics are printed directly, regardless of LOG_LEVEL, and reset
+   * after printing, so every report covers the period since the
+   * previous one.
+   */
+  unsigned long period = millis() - statsTime;
+                                            // Statistics period; unit: ms
+  double dutyCycle;                         // Share of time loop passes are executed
+  double wiFiAwake;                         // Share of time WiFi power save is off
+  double current;                           // Estimated average current; unit: mA
+
+  // I want to check if any time has passed since last report; otherwise statistics are kept
+  if (period == 0) {
+    return false;
+  }
+
+  // I want to check if WiFi power save is off right now
+  if (!wiFiPowerSave) {
+    wiFiAwakeTime += millis() - wiFiAwakeSince;
+    wiFiAwakeSince = millis();
+  }
+
+  dutyCycle = 1.0 - min(1.0, idleTime / 1000.0 / period);
+  wiFiAwake = min(1.0, double(wiFiAwakeTime) / period);
+  current = dutyCycle * POWER_CURRENT_ACTIVE + (1.0 - dutyCycle) * POWER_CURRENT_IDLE + wiFiAwake * POWER_CURRENT_WIFI;
+  out.printf("Duty cycle %.1f %%, WiFi power save off %.1f %%, estimated current %.0f mA, estimated runtime %.1f h.\n",
+    dutyCycle * 100, wiFiAwake * 100, current, POWER_BATTERY / current);
+
+  statsTime = millis();
+  idleTime = 0;
+  wiFiAwakeTime = 0;
+
+  return true;
+}
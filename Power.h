@@ -0,0 +1,56 @@
+/*
+ * Declaration of power saving between loop passes
+ */
+
+#ifndef _POWER_H_
+#define _POWER_H_
+
+#include "CrossFunc.h"
+#include <Arduino.h>
+#include <WiFi.h>
+
+
+// Idle detection
+#define IDLE_AFTER       2000               // Loop passes are idle after this time without activity; unit: ms
+#define IDLE_LATENCY       40               // Maximum delay of sampled input, e. g. potentiometer, by idle waits; unit: ms
+#define IDLE_POLL          10               // Interval of checking for data sent by WiThrottle server while idle; unit: ms
+
+// WiFi power save
+#define WIFI_PS_AFTER   10000               // WiFi returns to modem sleep after this time without driving; unit: ms
+
+// Power consumption
+#define POWER_CURRENT_ACTIVE 70             // Estimated current while loop passes are executed; unit: mA
+#define POWER_CURRENT_IDLE   25             // Estimated current while waiting idle; unit: mA
+#define POWER_CURRENT_WIFI   50             // Estimated additional current while WiFi power save is off; unit: mA
+#define POWER_BATTERY       500             // Capacity of battery; unit: mAh
+#define POWER_STATS_INTERVAL 60000          // Interval for reporting statistics of power consumption; unit: ms
+
+class PowerManager {
+  private:
+    uint32_t activityTime = 0;              // Timestamp of last activity
+    uint32_t statsTime = 0;                 // Start of statistics period; unit: ms
+    unsigned long idleTime = 0;             // Time spent waiting idle in statistics period; unit: us
+
+    // WiFi power save
+    bool wiFiPowerSave = true;              // WiFi is in modem sleep, i. e. it only wakes up for beacons
+    uint32_t driveTime = 0;                 // Timestamp of last loop pass with a driving loco or handset being operated
+    uint32_t wiFiAwakeSince = 0;            // Timestamp WiFi power save has been turned off or statistics period started
+    unsigned long wiFiAwakeTime = 0;        // Time with WiFi power save off in statistics period; unit: ms
+
+  public:
+    // Power manager initialization
+    void begin();
+
+    // Idle detection
+    void activity();                        // Note activity, e. g. input or communication
+    bool isIdle();                          // Check if there has been no activity for IDLE_AFTER
+    void idle(unsigned long timeout);       // Wait for <timeout> ms at most, but not longer than IDLE_LATENCY
+    static void wake();                     // Wake up from waiting idle; to be called by interrupt service routines
+
+    // WiFi power save
+    void wiFiLoop(bool driving);            // Turn WiFi power save off while driving and on again WIFI_PS_AFTER later
+
+    // Statistics
+    bool printStats(Print &out);            // Print duty cycle, WiFi power save and estimated current and reset them; false if no time has passed
+};
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Definition of racing connections to WiThrottle servers
+ */
+
+#include "Race.h"
+#include "Log.h"
+#include <errno.h>
+#include <lwip/sockets.h>
+
+
+// State of a connection of the race
+#define RACE_WAITING        0               // Not started yet
+#define RACE_CONNECTING     1               // Connection is being established
+#define RACE_CONNECTED      2               // Connection established, waiting for WiThrottle server to greet
+#define RACE_FAILED         3               // Connection failed
+
+
+// Start connection to WiThrottle server without waiting
+int raceConnect(IPAddress ip, uint16_t port) {
+  int fd;                                   // Socket
+  struct sockaddr_in address;               // Address of WiThrottle server
+
+  fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = (uint32_t)ip;
+  address.sin_port = htons(port);
+
+  // I want to check if connection is being established
+  if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+// Set up race of connections to WiThrottle servers
+void raceStart(serverRace &race, const IPAddress ip[], const uint16_t port[], byte count) {
+  raceAbort(race);
+
+  race.count = min(count, (byte)HOST_CANDIDATES);
+  for (byte i = 0; i < race.count; i++) {
+    race.ip[i] = ip[i];
+    race.port[i] = port[i];
+    race.fd[i] = -1;
+    race.state[i] = RACE_WAITING;
+  }
+  race.started = 0;
+  race.running = true;
+  race.startTime = millis();
+  race.nextTime = race.startTime;
+}
+
+// Advance race without waiting
+int racePoll(serverRace &race, byte &winner) {
+  fd_set readable;                          // Sockets WiThrottle server greeted on
+  fd_set writable;                          // Sockets connection has been established or failed on
+  int fdMax;                                // Highest socket to be checked
+  struct timeval timeout = { 0, 0 };        // Sockets are checked without waiting
+  int error;                                // Result of establishing a connection
+  char greeting;                            // First byte sent by WiThrottle server
+  socklen_t errorSize = sizeof(error);      // Size of <error>
+  bool pending;                             // A connection is being established, waiting for greeting or not started yet
+  int result = RACE_RUNNING;                // Socket of the winner
+
+  // I want to check if race is running at all
+  if (!race.running) {
+    return RACE_LOST;
+  }
+
+  // I want to check if next connection has to be started
+  if (race.started < race.count && (int32_t)(millis() - race.nextTime) >= 0) {
+    LOG_INFO("Race: connect to WiThrottle server %s:%u.", race.ip[race.started].toString(), race.port[race.started]);
+    race.fd[race.started] = raceConnect(race.ip[race.started], race.port[race.started]);
+    race.state[race.started] = race.fd[race.started] < 0 ? RACE_FAILED : RACE_CONNECTING;
+    race.started++;
+    race.nextTime = millis() + JMRI_RACE_STAGGER;
+  }
+
+  FD_ZERO(&readable);
+  FD_ZERO(&writable);
+  fdMax = -1;
+  for (byte i = 0; i < race.started; i++) {
+    if (race.state[i] == RACE_CONNECTING) {
+      FD_SET(race.fd[i], &writable);
+      fdMax = max(fdMax, race.fd[i]);
+    }
+    else if (race.state[i] == RACE_CONNECTED) {
+      FD_SET(race.fd[i], &readable);
+      fdMax = max(fdMax, race.fd[i]);
+    }
+  }
+
+  // I want to check if a socket changed
+  if (fdMax >= 0 && select(fdMax + 1, &readable, &writable, NULL, &timeout) > 0) {
+    for (byte i = 0; i < race.started && result < 0; i++) {
+      // I want to check if connection has been established or failed
+      if (race.state[i] == RACE_CONNECTING && FD_ISSET(race.fd[i], &writable)) {
+        error = 0;
+        getsockopt(race.fd[i], SOL_SOCKET, SO_ERROR, &error, &errorSize);
+        if (error == 0) {
+          race.state[i] = RACE_CONNECTED;
+        }
+        else {
+          LOG_WARN("Race: WiThrottle server %s:%u refused connection.", race.ip[i].toString(), race.port[i]);
+          close(race.fd[i]);
+          race.state[i] = RACE_FAILED;
+          race.nextTime = millis();
+        }
+      }
+      // I want to check if WiThrottle server greeted first
+      else if (race.state[i] == RACE_CONNECTED && FD_ISSET(race.fd[i], &readable)) {
+        // I want to check if WiThrottle server sent data instead of closing the connection; data is left for the client
+        if (recv(race.fd[i], &greeting, 1, MSG_PEEK) > 0) {
+          result = race.fd[i];
+          winner = i;
+        }
+        else {
+          LOG_WARN("Race: WiThrottle server %s:%u closed connection.", race.ip[i].toString(), race.port[i]);
+          close(race.fd[i]);
+          race.state[i] = RACE_FAILED;
+          race.nextTime = millis();
+        }
+      }
+    }
+  }
+
+  // I want to check if there is a winner
+  if (result >= 0) {
+    race.state[winner] = RACE_WAITING;
+    raceAbort(race);
+    fcntl(result, F_SETFL, fcntl(result, F_GETFL, 0) & ~O_NONBLOCK);
+    LOG_INFO("Race: WiThrottle server %s:%u won after %lu ms.", race.ip[winner].toString(), race.port[winner], millis() - race.startTime);
+    return result;
+  }
+
+  // I want to check if any connection can still win
+  pending = race.started < race.count;
+  for (byte i = 0; i < race.started; i++) {
+    pending = pending || race.state[i] == RACE_CONNECTING || race.state[i] == RACE_CONNECTED;
+  }
+  if (!pending || millis() - race.startTime >= JMRI_RACE_TIMEOUT) {
+    raceAbort(race);
+    return RACE_LOST;
+  }
+
+  return RACE_RUNNING;
+}
+
+// Close all connections of a running race
+void raceAbort(serverRace &race) {
+  // I want to check if race is running at all
+  if (!race.running) {
+    return;
+  }
+
+  for (byte i = 0; i < race.started; i++) {
+    if (race.state[i] == RACE_CONNECTING || race.state[i] == RACE_CONNECTED) {
+      close(race.fd[i]);
+      race.state[i] = RACE_FAILED;
+    }
+  }
+  race.running = false;
+}
@@ -0,0 +1,46 @@
+/*
+ * Declaration of racing connections to WiThrottle servers
+ *
+ * Connections to several WiThrottle servers, e. g. a primary and a
+ * standby machine, are started one after the other every
+ * JMRI_RACE_STAGGER, without waiting for the previous one to succeed.
+ * If a connection fails, the next one is started at once. The first
+ * WiThrottle server greeting, i. e. sending data after the connection
+ * has been established, wins; all other connections are closed.
+ *
+ * The race never blocks: raceStart() only sets it up and every
+ * racePoll() checks the sockets without waiting, so the race is run
+ * by the connection state machine once per loop pass.
+ */
+
+#ifndef _RACE_H_
+#define _RACE_H_
+
+#include "CrossFunc.h"
+#include <Arduino.h>
+#include <WiFi.h>
+
+
+// Result of polling a race
+#define RACE_RUNNING       -1               // No WiThrottle server has greeted yet
+#define RACE_LOST          -2               // All connections failed or timed out
+
+// Race
+typedef struct {
+  IPAddress ip[HOST_CANDIDATES];            // IP addresses of WiThrottle servers raced
+  uint16_t port[HOST_CANDIDATES];           // Ports of WiThrottle servers raced
+  int fd[HOST_CANDIDATES];                  // Sockets of the race
+  byte state[HOST_CANDIDATES];              // State of the connections
+  byte count = 0;                           // Number of WiThrottle servers raced
+  byte started = 0;                         // Connections started
+  bool running = false;                     // Race has been started and not decided yet
+  uint32_t startTime;                       // Start time of the race
+  uint32_t nextTime;                        // Time next connection is started
+} serverRace;
+
+void raceStart(serverRace &race, const IPAddress ip[], const uint16_t port[], byte count);
+                                            // Set up race of connections to WiThrottle servers
+int racePoll(serverRace &race, byte &winner);
+                                            // Advance race without waiting; returns socket of the winner, RACE_RUNNING or RACE_LOST
+void raceAbort(serverRace &race);           // Close all connections of a running race
+#endif
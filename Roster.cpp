@@ -0,0 +1,214 @@
+/*
+ * Definition of the roster, i. e. the locos supplied by WiThrottle server
+ */
+
+#include "Roster.h"
+#include "Log.h"
+
+
+// Pool of roster being sorted
+const char* sortPool;
+
+// Compare roster entries by ID, case insensitive
+int compareEntries(const void* a, const void* b) {
+  return strcasecmp(sortPool + ((const rosterEntry*)a)->id, sortPool + ((const rosterEntry*)b)->id);
+}
+
+
+// Roster list reception
+
+// Start reception of roster list; discards previous roster
+void Roster::begin() {
+  entryCount = 0;
+  poolLength = 0;
+  receiving = true;
+  receiveCount = 0;
+  dropCount = 0;
+  field = 0;
+  fieldLength = 0;
+  history[0] = 0;
+  history[1] = 0;
+  pendingValid = false;
+}
+
+// Parse next character of roster list
+void Roster::add(char c) {
+  /*
+   * Delimiters are "]\[" between roster items and "}|{" between the
+   * fields of a roster item. The first two characters of a delimiter
+   * have already been counted to the field when the third one arrives,
+   * so they are taken off again.
+   */
+
+  // I want to check if roster list is being received
+  if (!receiving) {
+    return;
+  }
+
+  // I want to check if a delimiter is complete
+  if (c == '[' && history[0] == ']' && history[1] == '\\') {
+    fieldLength -= 2;
+    endField();
+    endItem();
+    c = 0;
+  }
+  else if (c == '{' && history[0] == '}' && history[1] == '|') {
+    fieldLength -= 2;
+    endField();
+    field++;
+    c = 0;
+  }
+  else {
+    // Characters beyond <fieldText> are only counted
+    if (fieldLength < sizeof(fieldText) - 1) {
+      fieldText[fieldLength] = c;
+    }
+    fieldLength++;
+  }
+
+  history[0] = history[1];
+  history[1] = c;
+}
+
+// Store field of roster item received
+void Roster::endField() {
+  unsigned int length = min(fieldLength, (unsigned int)sizeof(fieldText) - 1);
+                                            // Length of field stored in <fieldText>
+
+  fieldText[length] = '\0';
+  fieldLength = 0;
+
+  switch (field) {
+    case 0:
+      // ID; I want to check if it fits into the pool
+      if (poolLength + length + 1 <= sizeof(pool)) {
+        memcpy(pool + poolLength, fieldText, length + 1);
+        pendingId = poolLength;
+        pendingValid = true;
+        poolLength += length + 1;
+      }
+      break;
+
+    case 1:
+      // DCC address
+      if (receiveCount < ROSTER_MAX) {
+        entries[receiveCount].address = atoi(fieldText) & ~ROSTER_LONG;
+        if (entries[receiveCount].address > 127) {
+          entries[receiveCount].address |= ROSTER_LONG;
+        }
+      }
+      break;
+
+    case 2:
+      // Address type
+      if (receiveCount < ROSTER_MAX && length > 0) {
+        if (fieldText[0] == 'L') {
+          entries[receiveCount].address |= ROSTER_LONG;
+        }
+        else {
+          entries[receiveCount].address &= ~ROSTER_LONG;
+        }
+      }
+      break;
+  }
+}
+
+// Add roster item received as entry
+void Roster::endItem() {
+  // I want to check if roster item has got an ID and a DCC address; otherwise it's e. g. the number of entries
+  if (field >= 1 && pendingValid && receiveCount < ROSTER_MAX) {
+    entries[receiveCount].id = pendingId;
+    receiveCount++;
+  }
+  else {
+    // ID is taken off the pool again
+    if (pendingValid) {
+      poolLength = pendingId;
+    }
+
+    // I want to check if roster is full
+    if (field >= 1) {
+      dropCount++;
+    }
+  }
+
+  field = 0;
+  pendingValid = false;
+}
+
+// Finish reception of roster list and build index
+void Roster::end() {
+  /*
+   * The entries are sorted by ID, so entries with a common prefix are
+   * adjacent and can be found by binary search.
+   */
+
+  // I want to check if roster list is being received
+  if (!receiving) {
+    return;
+  }
+
+  endField();
+  endItem();
+  receiving = false;
+
+  sortPool = pool;
+  qsort(entries, receiveCount, sizeof(rosterEntry), compareEntries);
+  entryCount = receiveCount;
+
+  LOG_INFO("Roster with %u entries indexed, %u bytes of IDs, %u entries dropped.", entryCount, poolLength, dropCount);
+}
+
+
+// Roster access
+
+// Get number of entries
+unsigned int Roster::size() {
+  return entryCount;
+}
+
+// Get ID of entry by position in sorted order
+const char* Roster::getId(unsigned int index) {
+  return pool + entries[index].id;
+}
+
+// Get DCC address of entry by position in sorted order
+unsigned int Roster::getAddress(unsigned int index) {
+  return entries[index].address & ~ROSTER_LONG;
+}
+
+// Get address type of entry by position in sorted order; S = short, L = long
+char Roster::getAddressType(unsigned int index) {
+  return (entries[index].address & ROSTER_LONG) ? 'L' : 'S';
+}
+
+// Find entries with ID starting with <prefix>; returns number of entries
+unsigned int Roster::find(const char* prefix, unsigned int &first) {
+  size_t length = strlen(prefix);           // Length of prefix
+
+  first = bound(prefix, length, false);
+
+  return bound(prefix, length, true) - first;
+}
+
+// Binary search for first entry not below (upper: above) <prefix>
+unsigned int Roster::bound(const char* prefix, size_t length, bool upper) {
+  unsigned int low = 0;                     // Lower limit of search range
+  unsigned int high = entryCount;           // Upper limit of search range
+  unsigned int middle;                      // Entry compared with prefix
+  int comparison;                           // Result of comparison
+
+  while (low < high) {
+    middle = (low + high) / 2;
+    comparison = strncasecmp(getId(middle), prefix, length);
+
+    if (comparison < 0 || (upper && comparison == 0)) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
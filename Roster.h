@@ -0,0 +1,81 @@
+/*
+ * Declaration of the roster, i. e. the locos supplied by WiThrottle server
+ */
+
+#ifndef _ROSTER_H_
+#define _ROSTER_H_
+
+#include <Arduino.h>
+
+
+// Roster
+#define ROSTER_MAX        512               // Maximum number of roster entries
+#define ROSTER_POOL_SIZE 6144               // Size of the pool holding the IDs of all entries
+#define ROSTER_ID_SIZE     24               // Maximum length of an ID incl. terminating '\0'; longer IDs are truncated
+#define ROSTER_LONG    0x8000               // Flag of a long DCC address in a packed address
+
+
+// Structures
+
+// Roster entry
+/*
+ * IDs are kept one after another in a common pool, so an entry only
+ * takes 4 bytes. The address type is packed into the DCC address,
+ * which is 10239 at most.
+ */
+typedef struct {
+  uint16_t id;                              // Offset of ID in the pool
+  uint16_t address;                         // DCC address; ROSTER_LONG set for long DCC addresses
+} rosterEntry;
+
+
+class Roster {
+  private:
+    rosterEntry entries[ROSTER_MAX];        // Entries sorted by ID, case insensitive
+    char pool[ROSTER_POOL_SIZE];            // IDs of the entries, each terminated by '\0'
+    unsigned int entryCount = 0;            // Number of entries available for search
+    unsigned int poolLength = 0;            // Bytes of pool in use
+
+    // Roster list reception
+    bool receiving = false;                 // Roster list is being received
+    unsigned int receiveCount = 0;          // Number of entries received so far
+    unsigned int dropCount = 0;             // Number of entries not fitting into the roster
+    byte field = 0;                         // Field of roster item being received; 0 = ID, 1 = DCC address, 2 = address type
+    char fieldText[ROSTER_ID_SIZE];         // Text of field being received
+    unsigned int fieldLength = 0;           // Length of field being received; may exceed <fieldText>
+    char history[2] = { 0, 0 };             // Last two characters received, for detecting delimiters
+    uint16_t pendingId;                     // Offset of ID of roster item being received
+    bool pendingValid = false;              // ID of roster item being received has been stored in pool
+
+    void endField();                        // Store field of roster item received
+    void endItem();                         // Add roster item received as entry
+    unsigned int bound(const char* prefix, size_t length, bool upper);
+                                            // Binary search for first entry not below (upper: above) <prefix>
+
+  public:
+    // Roster list reception
+    /*
+     * The roster list "<count>]\[<ID>}|{<address>}|{<type>]\[..." is
+     * parsed character by character as it arrives, so it never has to be
+     * held in memory as a whole; memory is bounded by ROSTER_MAX and
+     * ROSTER_POOL_SIZE however large the roster is.
+     * The roster is rebuilt in place: begin() discards the previous
+     * entries, and the roster appears empty until end() has built the
+     * index. Keeping the previous roster usable meanwhile would take a
+     * second table, i. e. about 8 KB more RAM.
+     */
+    void begin();                           // Start reception of roster list; discards previous roster
+    void add(char c);                       // Parse next character of roster list
+    void end();                             // Finish reception of roster list and build index
+
+    // Roster access
+    unsigned int size();                    // Get number of entries
+    const char* getId(unsigned int index);  // Get ID of entry by position in sorted order
+    unsigned int getAddress(unsigned int index);
+                                            // Get DCC address of entry by position in sorted order
+    char getAddressType(unsigned int index);
+                                            // Get address type of entry by position in sorted order; S = short, L = long
+    unsigned int find(const char* prefix, unsigned int &first);
+                                            // Find entries with ID starting with <prefix>; returns number of entries
+};
+#endif
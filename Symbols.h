@@ -6,7 +6,7 @@
 #define _SYMBOLS_H_
 
 // 1
-unsigned char imgOne16x16[] = {
+const unsigned char imgOne16x16[] = {
   0b00000000, 0b00000000,
   0b00000011, 0b11000000,
   0b00001100, 0b00110000,
@@ -26,7 +26,7 @@ unsigned char imgOne16x16[] = {
 };
 
 // 1 inverted
-unsigned char imgOneInverted16x16[] = {
+const unsigned char imgOneInverted16x16[] = {
   0b00000000, 0b00000000,
   0b00000011, 0b11000000,
   0b00001111, 0b11110000,
@@ -46,7 +46,7 @@ unsigned char imgOneInverted16x16[] = {
 };
 
 // Exclamation point
-unsigned char imgExlamation16x16[] = {
+const unsigned char imgExlamation16x16[] = {
   0b00000000, 0b00000000,
   0b00000011, 0b11000000,
   0b00001100, 0b00110000,
@@ -66,7 +66,7 @@ unsigned char imgExlamation16x16[] = {
 };
 
 // JMRI symbol
-unsigned char imgJMRI16x16[] = {
+const unsigned char imgJMRI16x16[] = {
   0b00000000, 0b00000000,
   0b00000000, 0b00000000,
   0b00000000, 0b01111000,
@@ -86,7 +86,7 @@ unsigned char imgJMRI16x16[] = {
 };
 
 // Interrogation point
-unsigned char imgQuestion16x16[] = {
+const unsigned char imgQuestion16x16[] = {
   0b00000000, 0b00000000,
   0b00000011, 0b11000000,
   0b00001100, 0b00110000,
@@ -106,7 +106,7 @@ unsigned char imgQuestion16x16[] = {
 };
 
 // WiFi symbol
-unsigned char imgWiFi16x16[] = {
+const unsigned char imgWiFi16x16[] = {
   0b00000000, 0b00000000,
   0b00000000, 0b00000000,
   0b00000111, 0b11100000,
@@ -130,7 +130,7 @@ unsigned char imgWiFi16x16[] = {
  * Images other sizes
  */
 // FWD
-unsigned char imgFWD7x7[] = {
+const unsigned char imgFWD7x7[] = {
   0b0010000,
   0b0011000,
   0b0011100,
@@ -141,7 +141,7 @@ unsigned char imgFWD7x7[] = {
 };
 
 // REV
-unsigned char imgREV7x7[] = {
+const unsigned char imgREV7x7[] = {
   0b0000100,
   0b0001100,
   0b0011100,
@@ -152,7 +152,7 @@ unsigned char imgREV7x7[] = {
 };
 
 // Boot sequence (JMRI logo)
-unsigned char imgBootSequence56x32[] = {
+const unsigned char imgBootSequence56x32[] = {
   0b00000000, 0b00000000, 0b00000000, 0b00000000, 0b00000111, 0b11111110, 0b00000000,
   0b00000000, 0b00000000, 0b00000000, 0b00000000, 0b00000111, 0b11111110, 0b00000000,
   0b00000000, 0b00000000, 0b00000000, 0b00000000, 0b00000011, 0b11111100, 0b00000000,
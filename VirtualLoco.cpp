@@ -3,45 +3,32 @@
  */
 
 #include "VirtualLoco.h"
+#include "Boot.h"
+#include "LocoCache.h"
+#include "Log.h"
 #include <EEPROM.h>
 
-#ifdef HL_DISP
-  #include <Adafruit_SSD1306.h>
-  #include <Adafruit_GFX.h>
-
-  // I2C OLED display
-  extern Adafruit_SSD1306 display;
-  extern unsigned char imgOne16x16[];
-  extern unsigned char imgOneInverted16x16[];
-#endif
-
 
 // Constructor
 VirtualLoco::VirtualLoco(void) {
   address = 0;
+  addressType = 'S';
   id = "# 0";
+  buildPrefix();
 }
 
 VirtualLoco::VirtualLoco(unsigned int address) {
   select(address);
 }
 
-VirtualLoco::VirtualLoco(String id, String &rosterList) {
-  select(id, rosterList);
+VirtualLoco::VirtualLoco(String id, Roster &roster) {
+  select(id, roster);
 }
 
 
 // Destructor
 VirtualLoco::~VirtualLoco(void) {
-  #ifdef HL_DISP
-    // hide symbol for 1 loco
-    display.drawBitmap(0, 0, imgOne16x16, 16, 16, OLED_COLOR_BLACK);
-    display.display();
-  #endif
-
-  #ifdef DEBUG
-    Serial.println("Loco with DCC address " + String(address) + " has beed rejected.");
-  #endif
+  LOG_DEBUG("Loco with DCC address %u has been rejected.", address);
 }
 
 
@@ -50,6 +37,34 @@ VirtualLoco::~VirtualLoco(void) {
 // Set Prefix for WiThrottle server communication
 void VirtualLoco::setPrefix(String cmdPrefix) {
   this->cmdPrefix = cmdPrefix;
+  buildPrefix();
+}
+
+// Build cached prefixes of commands after DCC address has changed
+void VirtualLoco::buildPrefix() {
+  /*
+   * Address type and DCC address are formatted only once per selected
+   * loco; commands are built by appending to the cached prefixes.
+   */
+  CmdBuffer key;                            // Address type and DCC address
+  CmdBuffer prefix;                         // Prefix of action commands
+
+  key.add(addressType).add((int)address);
+  strlcpy(addressKey, key.c_str(), sizeof(addressKey));
+
+  prefix.add(cmdPrefix.c_str()).add('A').add(addressKey).add("<;>");
+  strlcpy(actionPrefix, prefix.c_str(), sizeof(actionPrefix));
+
+  // Emergency stop is encoded in advance, so the stop doesn't have to be formatted when it is urgent
+  strlcpy(stopCmd, actionPrefix, sizeof(stopCmd) - 3);
+  stopCmdLength = strlen(stopCmd);
+  stopCmd[stopCmdLength++] = 'X';
+  stopCmd[stopCmdLength++] = '\r';
+  stopCmd[stopCmdLength++] = '\n';
+
+  for(byte fn = 0; fn <= 28; fn++) {
+    function[fn].setPrefix(actionPrefix);
+  }
 }
 
 
@@ -57,15 +72,27 @@ void VirtualLoco::setPrefix(String cmdPrefix) {
 
 // Select loco by DCC address
 void VirtualLoco::select(unsigned int address, bool updateID) {
+  // I want to check if DCC address is a long one
+  select(address, address > 127 ? 'L' : 'S', updateID);
+}
+
+// Select loco by address type and DCC address
+void VirtualLoco::select(unsigned int address, char addressType, bool updateID) {
+  locoCacheEntry cached;                    // Loco as driven recently
+  bool isCached;                            // Loco has been driven recently
+  const char* label;                        // Actual label of <cached>
+
   // I want to check if loco has already been acquired
   if (!acquired) {
     this->address = address;
-    addressType = "S";                      // Default
-
-    // I want to check if DCC address is a long one
-    if (address > 127) {
-      addressType = "L";
-    }
+    this->addressType = addressType;
+    buildPrefix();
+    speedStepMode = STEP_MODE_128;          // Default until WiThrottle server sends speed step mode
+    notch = 0;                              // Default until WiThrottle server sends notch
+    serverDirection = IDLE;
+    serverNotch = NOTCH_UNKNOWN;
+    directionPending = false;
+    notchPending = false;
 
     // I want to check if ID has to be updated
     if (updateID) {
@@ -74,15 +101,17 @@ void VirtualLoco::select(unsigned int address, bool updateID) {
 
     initFunctions();
 
-    #ifdef HL_DISP
-      // show symbol for 1 loco
-      display.drawBitmap(0, 0, imgOne16x16, 16, 16, OLED_COLOR_WHITE);
-      display.display();
-    #endif
+    // I want to check if loco has been driven recently; then its labels are shown until WiThrottle server sends them on acquisition
+    isCached = locoCacheFind(addressType, address, cached);
+    if (isCached) {
+      label = cached.labels;
+      for (byte fn = 0; fn < min(cached.labelCount, (byte)29) && label < cached.labels + LOCO_CACHE_LABELS; fn++) {
+        function[fn].setLabel(label);
+        label += strlen(label) + 1;
+      }
+    }
 
-    #ifdef DEBUG
-      Serial.println("Select loco by DCC address " + String(address) + ".");
-    #endif
+    LOG_DEBUG("Select loco by DCC address %s.", addressKey);
   }
   else {
     /*
@@ -91,43 +120,31 @@ void VirtualLoco::select(unsigned int address, bool updateID) {
   }
 }
 
-// Select loco by ID
-void VirtualLoco::select(String id, String &rosterList) {
-  char* tmpRosterList = (char*)"";          // Roster list
-  String tmpRosterItem = (char*)"";         // Roster item
-  const char* rosterItemDelim = "]\\[";     // Delimiter betweed each roster item
-  const char* rosterItemInfoDelim = "}|{";  // Delimiter betweed each roster item
-  String tmpID = "";                        // ID of roster item
-  unsigned int tmpAddress = 0;              // DCC address of roster item
+// Select loco of roster by ID
+void VirtualLoco::select(String id, Roster &roster) {
+  unsigned int first;                       // First roster entry starting with ID
+  unsigned int count;                       // Number of roster entries starting with ID
 
   // I want to check if loco has already been acquired
   if (!acquired) {
-    // Split different entries of roster list
-    tmpRosterList = strtok(const_cast<char*>(rosterList.c_str()), rosterItemDelim);
-    while (tmpRosterList != NULL) {
-      tmpRosterItem = String(tmpRosterList);
-      tmpID = tmpRosterItem.substring(0, tmpRosterItem.indexOf(rosterItemInfoDelim));
-
-      tmpRosterItem = tmpRosterItem.substring(tmpRosterItem.indexOf(rosterItemInfoDelim) + 3, tmpRosterItem.length());
-      tmpAddress = tmpRosterItem.substring(0, tmpRosterItem.indexOf(rosterItemInfoDelim)).toInt();
-
-//      tmpRosterItem = tmpRosterItem.substring(tmpRosterItem.indexOf(rosterItemInfoDelim) + 3, tmpRosterItem.length());
-//      tmpAddressType = tmpRosterItem;
-
-      // I want to check if ID matches
-      if (id == tmpID) {
-        this->id = id;
-        select(tmpAddress, false);
+    count = roster.find(id.c_str(), first);
+
+    // I want to check which of the entries starting with ID matches exactly
+    for (unsigned int i = first; i < first + count; i++) {
+      if (id == roster.getId(i)) {
+        select(roster, i);
         break;
       }
-
-      tmpRosterList = strtok(NULL, rosterItemDelim);
     }
   }
-  else {
-    /*
-     * TODO
-     */
+}
+
+// Select loco of roster by position in sorted order
+void VirtualLoco::select(Roster &roster, unsigned int index) {
+  // I want to check if loco has already been acquired
+  if (!acquired) {
+    id = roster.getId(index);
+    select(roster.getAddress(index), roster.getAddressType(index), false);
   }
 }
 
@@ -137,7 +154,7 @@ unsigned int VirtualLoco::getAddress() {
 }
 
 // Get address type of the loco
-String VirtualLoco::getAddressType() {
+char VirtualLoco::getAddressType() {
   return addressType;
 }
 
@@ -160,16 +177,36 @@ String VirtualLoco::getDescription() {
 
 // Set direction of the loco
 void VirtualLoco::setDirection(int direction) {
+  // I want to check if loco is being acquired; direction is sent as soon as acquisition is confirmed
+  if (acquiring && direction != IDLE) {
+    this->direction = direction;
+    syncDirection = direction;
+  }
+
   // I want to check if setting the direction is possible
   if (acquired && direction != IDLE) {
     this->direction = direction;
+    sendDirection();
+  }
+}
 
-    #ifdef DEBUG
-      Serial.println("Set direction of loco " + getDescription() + " to " + directionTxt[direction] + ".");
-    #endif
+// Send direction unless WiThrottle server already has it
+void VirtualLoco::sendDirection() {
+  CmdBuffer cmd;                            // Command to be sent to WiThrottle server
 
-    sendCmd("M0A" + addressType + String(address) + "<;>R" + String(direction));
+  // I want to check if WiThrottle server already has the direction
+  if (direction == serverDirection) {
+    suppressCmd();
+    return;
   }
+
+  LOG_DEBUG("Set direction of loco %s to %s.", addressKey, directionTxt[direction]);
+
+  cmd.add(actionPrefix).add('R').add(direction);
+  sendCmd(cmd.c_str(), false);
+  serverDirection = direction;
+  directionPending = true;
+  directionTime = millis();
 }
 
 // Get direction of the loco
@@ -182,14 +219,19 @@ unsigned int VirtualLoco::getDirection() {
 
 // Set notch of the loco
 void VirtualLoco::setNotch(int notch) {
+  // I want to check if loco is being acquired; notch is sent as soon as acquisition is confirmed
+  if (acquiring) {
+    this->notch = notch;
+    syncNotch = true;
+  }
+
   if (acquired) {
     if (notch == ESTOP) {
-      #ifdef DEBUG
-        Serial.println("Emergency stop loco " + getDescription() + ".");
-      #endif
+      LOG_INFO("Emergency stop loco %s.", addressKey);
 
       this->notch = notch;
-      sendCmd("M0A" + addressType + String(address) + "<;>X");
+      // Emergency stop is written immediately, not at the end of the loop pass
+      sendNotch();
     }
     else if ((this->notch != ESTOP && notch != this->notch) || (this->notch == ESTOP && notch == 0)) {
       /*
@@ -205,13 +247,44 @@ void VirtualLoco::setNotch(int notch) {
        */
       this->notch = notch;
 
-      #ifdef DEBUG
-        Serial.println("Set notch of loco " + getDescription() + " to " + String(notch) + ".");
-      #endif
+      // I want to check if direction has been dropped by the emergency stop
+      if (serverDirection == IDLE && direction != IDLE) {
+        sendDirection();
+      }
+      sendNotch();
+    }
+  }
+}
+
+// Send notch; emergency stop is always sent
+void VirtualLoco::sendNotch() {
+  CmdBuffer cmd;                            // Command to be sent to WiThrottle server
 
-      sendCmd("M0A" + addressType + String(address) + "<;>V" + String(notch));
+  // I want to check if WiThrottle server already has the notch
+  if (notch != ESTOP && notch == serverNotch) {
+    suppressCmd();
+    return;
+  }
+
+  if (notch == ESTOP) {
+    // Emergency stop takes the priority lane ahead of all pending commands
+    sendStopCmd(stopCmd, stopCmdLength);
+
+    // Speed and direction still pending would follow the stop; direction is sent again once the loco is released
+    dropCmd(actionPrefix, 'V');
+    if (dropCmd(actionPrefix, 'R')) {
+      serverDirection = IDLE;
+      directionPending = false;
     }
   }
+  else {
+    LOG_DEBUG("Set notch of loco %s to %d.", addressKey, notch);
+    cmd.add(actionPrefix).add('V').add(notch);
+    sendCmd(cmd.c_str(), false);
+  }
+  serverNotch = notch;
+  notchPending = true;
+  notchTime = millis();
 }
 
 // Get notch of the loco
@@ -219,6 +292,23 @@ int VirtualLoco::getNotch() {
   return this->notch;
 }
 
+// Get number of speed steps of the loco without stop
+byte VirtualLoco::getNotchRange() {
+  switch(speedStepMode) {
+    case STEP_MODE_14:
+      return 13;
+
+    case STEP_MODE_27:
+    case STEP_MODE_28:
+    case STEP_MODE_28_MOT:
+      // 27 speed step mode is handled like 28 speed step mode
+      return 27;
+
+    default:
+      return 126;
+  }
+}
+
 
 // DCC functions
 
@@ -226,22 +316,63 @@ int VirtualLoco::getNotch() {
 void VirtualLoco::initFunctions() {
   for(byte fn = 0; fn <= 28; fn++) {
     function[fn].setFn(fn);
-    function[fn].setPrefix(cmdPrefix + "A" + getAddressType() + getAddress());
   }
 }
 
 
+// Loco cache
+
+// Put loco with its function labels in front of loco cache
+void VirtualLoco::storeCache() {
+  locoCacheEntry entry;                     // Loco as driven now
+  locoCacheEntry cached;                    // Loco as driven recently
+  unsigned int length = 0;                  // Bytes of <entry.labels> in use
+  String label;                             // Label of actual function
+
+  memset(&entry, 0, sizeof(entry));
+  entry.address = address;
+  entry.addressType = addressType;
+  strlcpy(entry.id, id.c_str(), sizeof(entry.id));
+
+  // I want to check if loco has been acquired by DCC address; then the roster ID cached before is kept
+  if (id.startsWith("# ") && locoCacheFind(addressType, address, cached)) {
+    strlcpy(entry.id, cached.id, sizeof(entry.id));
+  }
+
+  // Labels not fitting in are cut off; they are shown as sent by WiThrottle server until the loco is selected again
+  for (byte fn = 0; fn <= 28; fn++) {
+    label = function[fn].getLabel();
+    if (length + label.length() + 1 > sizeof(entry.labels)) {
+      break;
+    }
+    memcpy(entry.labels + length, label.c_str(), label.length() + 1);
+    length += label.length() + 1;
+    entry.labelCount++;
+  }
+
+  locoCacheStore(entry);
+}
+
+
 // Acquire and dispatch loco
 
 // Acquire loco from WiThrottle server and assign to WiThrottle!
 void VirtualLoco::acquire() {
+  /*
+   * Acquisition doesn't wait for WiThrottle server: the command is sent
+   * with the other commands of the loop pass and the confirmation is
+   * handled by listenToThrottle() whenever it arrives. Direction and
+   * notch set in the meantime are queued by setDirection() and
+   * setNotch() and sent right behind the confirmation, so the loco is
+   * drivable without another loop pass.
+   */
+
   bool useID = false;                       // Use ID of loco to acuire
+  CmdBuffer cmd;                            // Command to be sent to WiThrottle server
 
   // I want to check if acquisition is possible
   if (!acquired && address != 0) {
-    #ifdef DEBUG
-      Serial.println("Acquire loco " + getDescription() + ".");
-    #endif
+    LOG_INFO("Acquire loco %s %s.", addressKey, id);
 
     // I want to check if loco has to be acquired by ID
     if (id.length() > 2) {
@@ -250,39 +381,40 @@ void VirtualLoco::acquire() {
       }
     }
 
+    cmd.add(cmdPrefix.c_str()).add('+').add(addressKey).add("<;>");
     if (useID) {
-      sendCmd("M0+" + addressType + String(address) + "<;>E" + id);
+      cmd.add('E').add(id.c_str());
     }
     else {
-      sendCmd("M0+" + addressType + String(address) + "<;>" + addressType + String(address));
+      cmd.add(addressKey);
     }
-
-    #ifdef HL_DISP
-      // show symbol for 1 loco
-      display.drawBitmap(0, 0, imgOne16x16, 16, 16, OLED_COLOR_BLACK);
-      display.drawBitmap(0, 0, imgOneInverted16x16, 16, 16, OLED_COLOR_WHITE);
-      display.display();
-    #endif
+    sendCmd(cmd.c_str(), false);
+    acquiring = true;
+    acquireTime = millis();
+    syncDirection = IDLE;
+    syncNotch = false;
   }
 }
 
 // Dispatch loco to WiThrottle server!
 void VirtualLoco::dispatch() {
+  /*
+   * Dispatch doesn't wait for WiThrottle server either: the loco is
+   * released at once, so another loco can be selected and acquired in
+   * the same loop pass. The confirmation is ignored, as it belongs to
+   * the loco dispatched.
+   */
+
   // I want to check if dispatch is possible
-  if (acquired) {
-    #ifdef DEBUG
-      Serial.println("Dispatch loco " + getDescription() + ".");
-    #endif
+  if (acquired || acquiring) {
+    LOG_INFO("Dispatch loco %s %s.", addressKey, id);
 
-    sendCmd("M0-" + addressType + String(address) + "<;>r");
-    select(0);
+    CmdBuffer cmd;                          // Command to be sent to WiThrottle server
 
-    #ifdef HL_DISP
-      // hide symbol for 1 loco
-      display.drawBitmap(0, 0, imgOneInverted16x16, 16, 16, OLED_COLOR_BLACK);
-      display.drawBitmap(0, 0, imgOne16x16, 16, 16, OLED_COLOR_WHITE);
-      display.display();
-    #endif
+    cmd.add(cmdPrefix.c_str()).add('-').add(addressKey).add("<;>r");
+    sendCmd(cmd.c_str(), false);
+    release();
+    select(0);
   }
 }
 
@@ -291,15 +423,62 @@ bool VirtualLoco::getAcquired() {
   return acquired;
 }
 
+// Check if acquisition has been requested but not yet confirmed
+bool VirtualLoco::getAcquiring() {
+  return acquiring;
+}
+
+// Get time from last acquisition request until loco was drivable
+unsigned long VirtualLoco::getAcquireTime() {
+  return acquireTimeLast;
+}
+
+// Get maximum time from acquisition request until loco was drivable
+unsigned long VirtualLoco::getAcquireTimeMax() {
+  return acquireTimeMax;
+}
+
+// Send direction and notch set while acquiring
+void VirtualLoco::sync() {
+  // I want to check if direction has been set while acquiring
+  if (syncDirection != IDLE) {
+    sendDirection();
+    syncDirection = IDLE;
+  }
+
+  // I want to check if notch has been set while acquiring
+  if (syncNotch) {
+    sendNotch();
+    syncNotch = false;
+  }
+}
+
+// Forget acquisition after connection to WiThrottle server has been lost
+void VirtualLoco::release() {
+  /*
+   * DCC address is kept, so the loco can be acquired again as soon as
+   * the connection has been restored.
+   */
+  acquired = false;
+  acquiring = false;
+
+  // State WiThrottle server has is not known until it is reported again
+  serverDirection = IDLE;
+  serverNotch = NOTCH_UNKNOWN;
+  directionPending = false;
+  notchPending = false;
+}
+
 
 // WiThrottle server communication
 
 // Use information sent by WiThrottle server to WiThrottle to update the DCC function's information about state and label
 void VirtualLoco::listenToThrottle(String serverInfo) {
   char cmdKey;
+  int reported;                             // Direction or notch reported by WiThrottle server
 
   // I want to check if information belongs to this loco
-  if (serverInfo.indexOf(getAddressType() + String(getAddress()) + "<;>") >= 0) {
+  if (serverInfo.indexOf(String(addressKey) + "<;>") >= 0) {
     // Information belongs to this loco
     cmdKey = serverInfo.charAt(0);
     serverInfo = serverInfo.substring(serverInfo.indexOf("<;>") + 3, serverInfo.length());
@@ -307,18 +486,26 @@ void VirtualLoco::listenToThrottle(String serverInfo) {
     switch(cmdKey) {
       case '+':
         // Add a locomotive to the throttle
+        // I want to check if acquisition has been requested by WiThrottle
+        if (acquiring) {
+          acquireTimeLast = millis() - acquireTime;
+          acquireTimeMax = max(acquireTimeMax, acquireTimeLast);
+          LOG_INFO("Loco %s %s has been acquired after %lu ms.", addressKey, id, acquireTimeLast);
+        }
+        else {
+          LOG_INFO("Loco %s %s has been acquired.", addressKey, id);
+        }
         acquired = true;
-        #ifdef DEBUG
-          Serial.println("Loco " + getDescription() + " has been acquired.");
-        #endif
+        acquiring = false;
+        sync();
+        bootMark(BOOT_ACQUIRED);
         break;
 
       case '-':
         // Remove a locomotive from the throttle
         acquired = false;
-        #ifdef DEBUG
-          Serial.println("Loco " + getDescription() + " has been dispatched.");
-        #endif
+        acquiring = false;
+        LOG_INFO("Loco %s %s has been dispatched.", addressKey, id);
         break;
 
       case 'A':
@@ -336,40 +523,64 @@ void VirtualLoco::listenToThrottle(String serverInfo) {
 
           case 'R':
             // Direction information
-            direction = serverInfo.toInt();
-            #ifdef DEBUG
-              Serial.println("Direction of loco " + getDescription() + " is " + directionTxt[direction] + ".");
-            #endif
+            reported = serverInfo.toInt();
+
+            // I want to check if direction reported is valid
+            if (reported != REV && reported != FWD) {
+              LOG_WARN("Loco %s invalid direction report %d ignored.", addressKey, reported);
+              break;
+            }
+
+            // I want to check if report has been sent before WiThrottle server processed the direction sent
+            if (directionPending && reported != serverDirection && millis() - directionTime < CMD_CONFIRM_TIMEOUT) {
+              LOG_DEBUG("Loco %s outdated direction report %s ignored.", addressKey, directionTxt[reported]);
+              break;
+            }
+
+            // Direction is confirmed or has been changed by WiThrottle server, e. g. by another throttle
+            if (directionPending && reported == serverDirection) {
+              confirmCmd(millis() - directionTime);
+            }
+            direction = reported;
+            serverDirection = reported;
+            directionPending = false;
+            LOG_DEBUG("Direction of loco %s is %s.", addressKey, directionTxt[direction]);
             break;
 
           case 's':
             // Speed step information
             speedStepMode = serverInfo.toInt();
-            #ifdef DEBUG
-              Serial.println("Speed step mode of loco " + getDescription() + " is " + speedStepModeTxt[speedStepMode] + ".");
-            #endif
+            LOG_DEBUG("Speed step mode of loco %s is %u (%u notches).", addressKey, speedStepMode, getNotchRange() + 1);
             break;
 
           case 'V':
             // Notch information
-            notch = serverInfo.toInt();
-            if (serverInfo.toInt() == ESTOP) {
-              #ifdef DEBUG
-                Serial.println("Loco " + getDescription() + " has been stopped for emergency (Notch: " + String(notch) + ").");
-              #endif
+            reported = serverInfo.toInt();
+
+            // I want to check if report has been sent before WiThrottle server processed the notch sent
+            if (notchPending && reported != serverNotch && millis() - notchTime < CMD_CONFIRM_TIMEOUT) {
+              LOG_DEBUG("Loco %s outdated notch report %d ignored.", addressKey, reported);
+              break;
+            }
+
+            // Notch is confirmed or has been changed by WiThrottle server, e. g. by another throttle
+            if (notchPending && reported == serverNotch) {
+              confirmCmd(millis() - notchTime);
+            }
+            notch = reported;
+            serverNotch = reported;
+            notchPending = false;
+            if (notch == ESTOP) {
+              LOG_INFO("Loco %s has been stopped for emergency (Notch: %d).", addressKey, notch);
             }
             else {
-              #ifdef DEBUG
-                Serial.println("Notch of loco " + getDescription() + " is " + String(notch) + ".");
-              #endif
+              LOG_DEBUG("Notch of loco %s is %d.", addressKey, notch);
             }
             break;
 
           default:
             // Unknown command
-            #ifdef DEBUG
-              Serial.println("Class VirtualLoco: Unknown command " + getAddressType() + String(address) + "<;>" + serverInfo);
-            #endif
+            LOG_WARN("Class VirtualLoco: Unknown command %s<;>%s", addressKey, serverInfo);
             /*
              * TODO
              */
@@ -382,13 +593,14 @@ void VirtualLoco::listenToThrottle(String serverInfo) {
         for(byte fn = 0; fn <= 28; fn++) {
           function[fn].listenToLoco(serverInfo);
         }
+
+        // Labels sent on acquisition confirm the cached ones
+        storeCache();
         break;
 
       case 'S':
         // Request steal locomotive
-        #ifdef DEBUG
-          Serial.println("Request steal locomotive: " + serverInfo);
-        #endif
+        LOG_WARN("Request steal locomotive: %s", serverInfo);
         /*
          * TODO
          */
@@ -396,9 +608,7 @@ void VirtualLoco::listenToThrottle(String serverInfo) {
 
       default:
         // Unknown command
-        #ifdef DEBUG
-          Serial.println("Class VirtualLoco: Unknown command '" + serverInfo + "'.");
-        #endif
+        LOG_WARN("Class VirtualLoco: Unknown command '%s'.", serverInfo);
         break;
     }
   }
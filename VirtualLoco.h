@@ -7,6 +7,7 @@
 
 #include "CrossFunc.h"
 #include "DccFunction.h"
+#include "Roster.h"
 #include <Arduino.h>
 #include <WiFi.h>
 
@@ -19,53 +20,81 @@
 
 // Notch
 #define ESTOP          -126                 // Notch which is set in case of emergency stop
+#define NOTCH_UNKNOWN    -1                 // Notch WiThrottle server has is not known yet
+
+// Speed step mode as sent by WiThrottle server
+#define STEP_MODE_128       1               // 128 speed steps
+#define STEP_MODE_28        2               // 28 speed steps
+#define STEP_MODE_27        4               // 27 speed steps
+#define STEP_MODE_14        8               // 14 speed steps
+#define STEP_MODE_28_MOT   16               // 28 speed steps (Motorola)
 
 class VirtualLoco {
   private:
     // Address
     unsigned int address;                   // Address
-    String addressType;                     // Address type
+    char addressType;                       // Address type
+    char addressKey[8];                     // Address type and DCC address, e. g. "L10239"
     String id;                              // ID (e. g. in the JMRI roster list)
 
     // Direction
-    byte direction;                         // Direction
+    byte direction;                         // Direction as set by WiThrottle
+    byte serverDirection = IDLE;            // Direction WiThrottle server has, i. e. last direction sent or reported; IDLE if not known
+    bool directionPending = false;          // Direction has been sent but not yet confirmed by WiThrottle server
+    uint32_t directionTime = 0;             // Timestamp direction has been sent
+    void sendDirection();                   // Send direction unless WiThrottle server already has it
     String directionTxt[3] = { "REV", "FWD", "IDLE" };
                                             // Direction as a text --> used for debugging
 
     // Notch
-    int notch;                              // Notch
+    int notch;                              // Notch as set by WiThrottle
                                             /*
-                                             * Valid ranges:
-                                             * 0 to 13  (NMRA: optional)
-                                             * 0 to 27  (NMRA: mandatory)
-                                             * 0 to 126 (NMRA: optional)
+                                             * Valid range:
+                                             * 0 to 126, scaled by WiThrottle server
+                                             * to the speed step mode of the loco
                                              * 
                                              * JMRI specialty:
                                              * -126 = emergency stop
                                              */
-    byte speedStepMode;                     // Speed step mode
-    String speedStepModeTxt[10] = { "<0>", "<1>", "<2>", "<3>", "<4>", "<5>", "<6>", "<7>", "<8>", "<9>" };
-                                            // Speed step mode as a text --> used for debugging
+    int serverNotch = NOTCH_UNKNOWN;        // Notch WiThrottle server has, i. e. last notch sent or reported
+    bool notchPending = false;              // Notch has been sent but not yet confirmed by WiThrottle server
+    uint32_t notchTime = 0;                 // Timestamp notch has been sent
+    void sendNotch();                       // Send notch; emergency stop is always sent
+    byte speedStepMode = STEP_MODE_128;     // Speed step mode
                                             /*
-                                             * TODO
-                                             * What's the meaning of the value sent by WiThrottle server?
-                                             * What's the valid range of values?
+                                             * Values:
+                                             * STEP_MODE_128, STEP_MODE_28, STEP_MODE_27,
+                                             * STEP_MODE_14, STEP_MODE_28_MOT
                                              */
 
     // Functions
     void initFunctions();                   // Initialize functions
 
+    // Loco cache
+    void storeCache();                      // Put loco with its function labels in front of loco cache
+
     // Acquire and dispatch
     bool acquired = false;                  // Loco is acquired by WiThrottle
+    bool acquiring = false;                 // Acquisition has been requested but not yet confirmed by WiThrottle server
+    uint32_t acquireTime = 0;               // Timestamp of acquisition request
+    unsigned long acquireTimeLast = 0;      // Time from last acquisition request until loco was drivable; unit: ms
+    unsigned long acquireTimeMax = 0;       // Maximum time from acquisition request until loco was drivable; unit: ms
+    int syncDirection = IDLE;               // Direction set while acquiring; IDLE if none
+    bool syncNotch = false;                 // Notch has been set while acquiring
+    void sync();                            // Send direction and notch set while acquiring
 
     // WiThrottle server communication
-    String cmdPrefix;                       // Prefix to be used in the communication to WiThrottle serverserver
+    String cmdPrefix = "M0";                // Prefix to be used in the communication to WiThrottle serverserver
+    char actionPrefix[CMD_PREFIX_SIZE];     // Prefix of action commands, e. g. "M0AL10239<;>"
+    char stopCmd[CMD_STOP_SIZE];            // Pre-encoded emergency stop incl. CR LF, e. g. "M0AL10239<;>X\r\n"
+    unsigned int stopCmdLength = 0;         // Length of <stopCmd>
+    void buildPrefix();                     // Build cached prefixes of commands after DCC address has changed
 
   public:
     // Constructor
     VirtualLoco(void);
     VirtualLoco(unsigned int address);
-    VirtualLoco(String id, String &rosterList);
+    VirtualLoco(String id, Roster &roster);
 
     // Deconstructor
     ~VirtualLoco(void);
@@ -75,11 +104,14 @@ class VirtualLoco {
 
     // DCC address
     void select(unsigned int address, bool updateID = true);
-                                            // Select loco by DCC address
-    void select(String id, String &rosterList);
-                                            // Select loco of roster list by ID
+                                            // Select loco by DCC address; address type follows from DCC address
+    void select(unsigned int address, char addressType, bool updateID);
+                                            // Select loco by address type and DCC address
+    void select(String id, Roster &roster); // Select loco of roster by ID
+    void select(Roster &roster, unsigned int index);
+                                            // Select loco of roster by position in sorted order
     unsigned int getAddress();              // Get DCC address of the loco
-    String getAddressType();                // Get address type of the loco
+    char getAddressType();                  // Get address type of the loco
                                             /*
                                              * Values:
                                              * S = short
@@ -94,6 +126,13 @@ class VirtualLoco {
     // Notch control
     void setNotch(int notch);               // Set notch of the loco
     int getNotch();                         // Get notch of the loco
+    byte getNotchRange();                   // Get number of speed steps of the loco without stop
+                                            /*
+                                             * Values:
+                                             * 13  (NMRA: optional)
+                                             * 27  (NMRA: mandatory)
+                                             * 126 (NMRA: optional)
+                                             */
 
     // Functions
     DccFunction function[29];               // Max. number of functions according to NMRA
@@ -102,6 +141,10 @@ class VirtualLoco {
     void acquire();                         // Acquire loco from WiThrottle server and assign to WiThrottle
     void dispatch();                        // Dispatch loco to WiThrottle server
     bool getAcquired();                     // Get acquisition state of the loco
+    bool getAcquiring();                    // Check if acquisition has been requested but not yet confirmed
+    unsigned long getAcquireTime();         // Get time from last acquisition request until loco was drivable; unit: ms
+    unsigned long getAcquireTimeMax();      // Get maximum time from acquisition request until loco was drivable; unit: ms
+    void release();                         // Forget acquisition after connection to WiThrottle server has been lost
 
     // WiThrottle server communication
     void listenToThrottle(String serverInfo);
@@ -3,9 +3,13 @@
  */
 
 #include "WiThrottle.h"
+#include "Boot.h"
+#include "Capture.h"
+#include "Log.h"
 
 #include <ctype.h>
 #include <EEPROM.h>
+#include <limits.h>
 #include <TimeLib.h>  // https://github.com/PaulStoffregen/Time
 #include <WiFi.h>
 
@@ -14,58 +18,20 @@
 extern WiFiClient client;                   // This throttle's WiFi client
 
 // WiThrottle server communication
-extern unsigned long lastHeartbeat;         // Timestamp of last heartbeat sent to WiThrottle server
+extern uint32_t lastHeartbeat;              // Timestamp of last heartbeat sent to WiThrottle server
 
 
-#ifdef HL_DISP
-	#include <Wire.h>
-	#include <Adafruit_SSD1306.h>
-  #include <Adafruit_GFX.h>
-
-	// I2C OLED display
-  extern Adafruit_SSD1306 display;
-  extern unsigned char imgBootSequence56x32[];
-  extern unsigned char imgExlamation16x16[];
-  extern unsigned char imgJMRI16x16[];
-  extern unsigned char imgWiFi16x16[];
-#endif
-
 // Constructor
 WiThrottle::WiThrottle(char* name) {
   this->name = name;
 }
 
-// Display initialization
-void WiThrottle::initDisplay() {
-  String bootMessage;                       // Boot sequence message
 
-  #ifdef HL_DISP
-    // Start OLED display
-    /*
-     * SSD1306_SWITCHCAPVCC = generate display voltage from 3.3V internally
-     */
+// Handset
 
-    // I want to check if WiThrottle was able to start display
-    if (!display.begin(SSD1306_SWITCHCAPVCC, OLED_I2C)) {
-      // Error
-      errorHandling("Failed to\ninitialize\nI2C OLED\ndisplay");
-    }
-    else {
-      // Display is active
-      display.setRotation(3);
-      display.setTextSize(1);
-      display.setTextColor(OLED_COLOR_WHITE);
-      display.clearDisplay();
-      display.display();
-    }
-  
-    // Write boot sequence message to display
-    bootMessage = "WiThrottle\n\nAn FSMD\nproject\nV " + String(SW_VERSION) + "\n\n(c) " + String(SW_RELEASE_YEAR) + "\n\n" + String(SW_LICENSE);
-    display.setCursor(0, 48);
-    display.println(bootMessage);
-    display.drawBitmap(4, 4, imgBootSequence56x32, 56, 32, OLED_COLOR_WHITE);
-    display.display();
-  #endif
+// Set handler showing messages on the handset
+void WiThrottle::setMessageHandler(messageHandler handler) {
+  showMessage = handler;
 }
 
 // EEPROM initialization
@@ -80,79 +46,88 @@ void WiThrottle::initEeprom() {
 
 // WiFi connection
 
-// Connect to WiFi
-void WiThrottle::connectToWiFi(wiFiConfig &wiFiSettings) {
-  unsigned int i = 0;                       // Counter variable
+TaskHandle_t wiFiWaitingTask = NULL;        // Task waiting for the WiFi connection
 
-  this->wiFiSettings = wiFiSettings;
-  #ifdef DEBUG
-    Serial.println("Connecting to WiFi '" + String(wiFiSettings.ssid) + "':");
-  #endif
+// Wake up task waiting for the WiFi connection as soon as an IP address has been assigned
+void wiFiGotIP(arduino_event_id_t event) {
+  // I want to check if a task is waiting
+  if (wiFiWaitingTask != NULL) {
+    xTaskNotifyGive(wiFiWaitingTask);
+  }
+}
 
-  // WiThrottle tries <attempts> times to establish a WiFi connection
-  while (WiFi.status() != WL_CONNECTED && i < wiFiSettings.attempts) {
-    i++;
-    #ifdef DEBUG
-      Serial.println("Try # " + String(i));
-    #endif
-    WiFi.begin(wiFiSettings.ssid, wiFiSettings.pwd);
-    WiFi.setHostname(name);
-    WiFi.macAddress(macAddress);
+// Start connecting to WiFi without waiting
+void WiThrottle::startWiFi(wiFiConfig &wiFiSettings) {
+  this->wiFiSettings = wiFiSettings;
+  wiFiWaitingTask = xTaskGetCurrentTaskHandle();
 
-    // Establishing a WiFi connection takes time
-    delay(3500);
+  // I want to check if this is the first attempt
+  if (wiFiAttempts == 0) {
+    LOG_INFO("Connecting to WiFi '%s'.", wiFiSettings.ssid);
+    WiFi.onEvent(wiFiGotIP, ARDUINO_EVENT_WIFI_STA_GOT_IP);
   }
 
-  // I want to check if WiThrottle was able to establish a WiFi connection in defined number of attempts
-  if (i >= wiFiSettings.attempts) {
-    // Error
-    errorHandling("Failed to\nconnect to\nWiFi!");
+  wiFiAttempts++;
+  LOG_INFO("Try # %u", wiFiAttempts);
+  WiFi.setHostname(name);
+  WiFi.begin(wiFiSettings.ssid, wiFiSettings.pwd);
+  WiFi.macAddress(macAddress);
+  wiFiStartTime = millis();
+}
+
+// Connect to WiFi
+void WiThrottle::connectToWiFi(wiFiConfig &wiFiSettings) {
+  /*
+   * Waiting ends as soon as WiFi reports an IP address; a new attempt
+   * is only started after WIFI_CONNECT_TIMEOUT. If startWiFi() has been
+   * called before, the attempt already running is waited for.
+   */
+
+  unsigned long elapsed;                    // Time current attempt has been running; unit: ms
+  unsigned long remaining;                  // Time left until current attempt times out; unit: ms
+
+  // I want to check if connecting to WiFi has already been started
+  if (wiFiAttempts == 0) {
+    startWiFi(wiFiSettings);
   }
-  else {
-    // WiThrottle successfully established a WiFi connection
-    #ifdef DEBUG
-      Serial.print("Connected to WiFi!\nIP address: ");
-      Serial.println(WiFi.localIP());
-      Serial.print("MAC address: ");
-      for (int i = 0; i <= 5; i++) {
-        if (i < 5) {
-          Serial.print(macAddress[i], HEX);
-          Serial.print(":");
-        }
-        else {
-          Serial.println(macAddress[i], HEX);
-        }
+
+  // WiThrottle tries <attempts> times to establish a WiFi connection
+  while (WiFi.status() != WL_CONNECTED) {
+    // I want to check if attempt timed out
+    if (millis() - wiFiStartTime >= WIFI_CONNECT_TIMEOUT) {
+      // I want to check if WiThrottle was able to establish a WiFi connection in defined number of attempts
+      if (wiFiAttempts >= wiFiSettings.attempts) {
+        // Error
+        errorHandling("Failed to\nconnect to\nWiFi!");
       }
-    #endif
+      startWiFi(wiFiSettings);
+    }
 
-    #ifdef HL_DISP
-      // Wait to keep boot message readable
-      delay(2500);
+    // Wait for IP address until attempt times out
+    /*
+     * The remaining time is taken once and clamped, as millis() may have
+     * passed the timeout since it was checked above.
+     */
+    elapsed = millis() - wiFiStartTime;
+    remaining = elapsed < WIFI_CONNECT_TIMEOUT ? WIFI_CONNECT_TIMEOUT - elapsed : 0;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(remaining) + 1);
+  }
 
-      // Clear display and show WiFi symbol
-      display.clearDisplay();
-      display.drawBitmap(OLED_WIFI_X, OLED_AREA_1_Y, imgWiFi16x16, 16, 16, OLED_COLOR_WHITE);
-      display.display();
-    #else
-      // Wait to keep LED state readable
-      delay(500);
-		#endif
+  // WiThrottle successfully established a WiFi connection
+  bootMark(BOOT_WIFI);
 
-    digitalWrite(LED_STOP, HIGH);
-    digitalWrite(LED_FWD, HIGH);
-    digitalWrite(LED_REV, HIGH);
-  }
+  LOG_INFO("Connected to WiFi, IP address is %s.", WiFi.localIP().toString());
+  LOG_INFO("MAC address is %02X:%02X:%02X:%02X:%02X:%02X.", macAddress[0], macAddress[1], macAddress[2], macAddress[3], macAddress[4], macAddress[5]);
+
+  digitalWrite(LED_STOP, HIGH);
+  digitalWrite(LED_FWD, HIGH);
+  digitalWrite(LED_REV, HIGH);
 }
 
 // Disconnect from WiFi
 void WiThrottle::disconnectFromWiFi() {
   WiFi.disconnect();
 
-  #ifdef HL_DISP
-    // Hide WiFi symbol
-    display.drawBitmap(OLED_WIFI_X, OLED_AREA_1_Y, imgWiFi16x16, 16, 16, OLED_COLOR_BLACK);
-    display.display();
-  #endif
   digitalWrite(LED_STOP, HIGH);
   digitalWrite(LED_FWD, HIGH);
   digitalWrite(LED_REV, HIGH);
@@ -160,103 +135,171 @@ void WiThrottle::disconnectFromWiFi() {
   // Wait to keep display or led statereadable
   delay(500);
 
-  #ifdef DEBUG
-    Serial.println("Disconnected from WiFi!");
-  #endif
+  LOG_INFO("Disconnected from WiFi.");
 }
 
-// Check if WiFi connection is still alive
-void WiThrottle::checkConnectionToWiFi() {
-  // I want to check if WiFi connection broke
-  if (WiFi.status() != WL_CONNECTED) {
-    errorHandling("WiFi\nconnection\nbroke!");
-  }
+// Get WiFi connection state
+bool WiThrottle::getConnectedToWiFi() {
+  return WiFi.status() == WL_CONNECTED;
 }
 
 
 // WiThrottle server connection
 
-// Connect to WiThrottle server
+// Start connecting to WiThrottle server
 void WiThrottle::connectToJMRI(hostConfig &hostSettings) {
-  unsigned int attempt = 0;                 // Counter variable
-  String jmriCmd = "";                      // Text containing commands that is sent from throttle to WiThrottle server
+  /*
+   * WiThrottle servers are raced in the following order:
+   *
+   * 1. Cached server, i. e. the one WiThrottle was connected to last
+   * 2. Servers configured in <hostSettings>, e. g. primary and standby
+   * 3. Server discovered by mDNS (_withrottle._tcp)
+   *
+   * Discovery runs in the background while the cached and configured
+   * servers are raced, so startup stays fast if one of them answers and
+   * a moved server is found without reflashing.
+   *
+   * Nothing is waited for here: the connection is established by
+   * connectionLoop() like a lost one is restored, so the handset is
+   * operable meanwhile. WiThrottle gives up after <attempts> failed
+   * attempts.
+   */
 
   this->hostSettings = hostSettings;
 
-  #ifdef DEBUG
-    Serial.println("Connecting to WiThrottle server " + String(hostSettings.ip));
-  #endif
+  LOG_INFO("Connecting to WiThrottle server.");
+
+  discovery.start(name);
+  lostTime = millis();
+  failures = 0;
+  setConnectionState(CONN_CONNECTING);
+}
+
+// Collect WiThrottle servers to race in order of preference
+byte WiThrottle::getServerCandidates(IPAddress ip[], uint16_t port[]) {
+  /*
+   * The WiThrottle server connected to last comes first, so a
+   * connection that only broke for a moment is restored with the same
+   * server; the others follow in the order they are configured. The
+   * discovered WiThrottle server is added if discovery has finished.
+   */
+
+  IPAddress candidateIP;                    // IP address of actual WiThrottle server
+  uint16_t candidatePort;                   // Port of actual WiThrottle server
+  byte count = 0;                           // Number of WiThrottle servers collected
+  bool isDuplicate;                         // WiThrottle server is already a candidate
+
+  for (byte i = 0; i < HOST_CANDIDATES; i++) {
+    // I want to check which WiThrottle server is next
+    if (i == 0) {
+      candidatePort = serverPort;
+      candidateIP = serverIP;
+      if (serverPort == 0 && !getCachedServer(candidateIP, candidatePort)) {
+        continue;
+      }
+    }
+    else if (i <= HOST_ENDPOINTS) {
+      candidatePort = hostSettings.endpoints[i - 1].port;
+      if (!candidateIP.fromString(hostSettings.endpoints[i - 1].ip) || candidateIP == IPAddress(0, 0, 0, 0)) {
+        continue;
+      }
+    }
+    else if (!discovery.isDone() || !discovery.getServer(candidateIP, candidatePort)) {
+      continue;
+    }
 
-  // WiThrottle tries <attempt> times to establish a WiThrottle server connection
-  while (client.connected() != true && attempt < hostSettings.attempts) {
-    attempt++;
-    #ifdef DEBUG
-      Serial.println("Try # " + String(attempt));
-    #endif
-
-    // I want to check if connection has been established
-    if (client.connect(hostSettings.ip, hostSettings.port)) {
-      #ifdef DEBUG
-        Serial.println("Connected to WiThrottle server!");
-      #endif
-
-      // Read initial message from WiThrottle server
-      listenToServer();
-
-      // Send hardware information to WiThrottle server, use Mac address
-      #ifdef DEBUG
-        Serial.println("Send hardware information to server.");
-      #endif
-      jmriCmd = "HU" + String(macAddress[0], HEX) + String(macAddress[1], HEX) + String(macAddress[2], HEX) + String(macAddress[3], HEX) + String(macAddress[4], HEX) + String(macAddress[5], HEX);
-      jmriCmd.toUpperCase();
-      sendCmd(jmriCmd);
-
-      // Publish name of throttle to WiThrottle server
-      #ifdef DEBUG
-        Serial.println("Publish name of throttle.");
-      #endif
-      jmriCmd = "N";
-      jmriCmd.concat(name);
-      sendCmd(jmriCmd);
-
-      #ifdef HL_DISP
-        // Clear other areas on display
-        display.fillRect(OLED_AREA_2_X, OLED_AREA_2_Y, OLED_AREA_2_W, OLED_AREA_2_H, OLED_COLOR_BLACK);
-        display.fillRect(OLED_AREA_3_X, OLED_AREA_3_Y, OLED_AREA_3_W, OLED_AREA_3_H, OLED_COLOR_BLACK);
-        display.display();
-
-        // Show JMRI symbol
-        display.drawBitmap(OLED_JMRI_X, OLED_AREA_1_Y, imgJMRI16x16, 16, 16, OLED_COLOR_WHITE);
-        display.display();
-			#endif
-			digitalWrite(LED_STOP, LOW);
-      digitalWrite(LED_FWD, HIGH);
-      digitalWrite(LED_REV, HIGH);
+    // I want to check if WiThrottle server has already been collected
+    isDuplicate = false;
+    for (byte j = 0; j < count; j++) {
+      isDuplicate = isDuplicate || (ip[j] == candidateIP && port[j] == candidatePort);
+    }
+    if (!isDuplicate) {
+      ip[count] = candidateIP;
+      port[count] = candidatePort;
+      count++;
     }
   }
 
-  // I want to check if WiThrottle was able to establish a connection to WiThrottle server in defined number of attempts
-  if (attempt >= hostSettings.attempts) {
-    // Error
-    errorHandling("Failed to\nconnect to\nWiThrottle\nserver!");
+  return count;
+}
+
+// Take over connection to WiThrottle server that won the race and introduce WiThrottle
+void WiThrottle::introduceToServer(int fd, IPAddress ip, uint16_t port) {
+  String jmriCmd = "";                      // Text containing commands that is sent from throttle to WiThrottle server
+
+  client = WiFiClient(fd);
+
+  LOG_INFO("Connected to WiThrottle server %s:%u.", ip.toString(), port);
+
+  serverIP = ip;
+  serverPort = port;
+  serverGreeted = false;
+
+  // Forget incomplete line of previous connection
+  cmdLineLength = 0;
+  if (rosterReceiving) {
+    roster.end();
+    rosterReceiving = false;
+  }
+
+  // Commands of a loop pass are written at once, so Nagle's algorithm only adds delay
+  client.setNoDelay(true);
+
+  // Read initial message from WiThrottle server
+  listenToServer();
+
+  // Send hardware information to WiThrottle server, use Mac address
+  LOG_DEBUG("Send hardware information to server.");
+  jmriCmd = "HU" + String(macAddress[0], HEX) + String(macAddress[1], HEX) + String(macAddress[2], HEX) + String(macAddress[3], HEX) + String(macAddress[4], HEX) + String(macAddress[5], HEX);
+  jmriCmd.toUpperCase();
+  sendCmd(jmriCmd, false);
+
+  // Publish name of throttle to WiThrottle server
+  LOG_DEBUG("Publish name of throttle.");
+  jmriCmd = "N";
+  jmriCmd.concat(name);
+  sendCmd(jmriCmd, false);
+
+  digitalWrite(LED_STOP, LOW);
+  digitalWrite(LED_FWD, HIGH);
+  digitalWrite(LED_REV, HIGH);
+}
+
+// Read WiThrottle server WiThrottle was connected to last from EEPROM
+bool WiThrottle::getCachedServer(IPAddress &ip, uint16_t &port) {
+  ip = IPAddress(EEPROM.read(EEPROM_HOST_IP), EEPROM.read(EEPROM_HOST_IP + 1), EEPROM.read(EEPROM_HOST_IP + 2), EEPROM.read(EEPROM_HOST_IP + 3));
+  port = (EEPROM.read(EEPROM_HOST_PORT) << 8) + EEPROM.read(EEPROM_HOST_PORT + 1);
+
+  // Erased EEPROM reads 255.255.255.255:65535
+  return ip != IPAddress(0, 0, 0, 0) && ip != IPAddress(255, 255, 255, 255) && port != 0 && port != 65535;
+}
+
+// Write WiThrottle server WiThrottle is connected to to EEPROM
+void WiThrottle::setCachedServer(IPAddress ip, uint16_t port) {
+  IPAddress ipLast;                         // Cached IP address
+  uint16_t portLast;                        // Cached port
+
+  // I want to check if WiThrottle server has changed
+  if (!getCachedServer(ipLast, portLast) || ip != ipLast || port != portLast) {
+    LOG_INFO("Write WiThrottle server %s:%u to EEPROM.", ip.toString(), port);
+
+    for (int i = 0; i < 4; i++) {
+      EEPROM.write(EEPROM_HOST_IP + i, ip[i]);
+    }
+    EEPROM.write(EEPROM_HOST_PORT, byte(port >> 8));
+    EEPROM.write(EEPROM_HOST_PORT + 1, byte(port & 0x00FF));
+    EEPROM.commit();
   }
 }
 
 // Disconnect from WiThrottle server
 void WiThrottle::disconnectFromJMRI() {
   // Disconnect from WiThrottle server
-  #ifdef DEBUG
-    Serial.println("Disconnect from WiThrottle server!");
-  #endif
+  LOG_INFO("Disconnect from WiThrottle server.");
 
   sendCmd("Q");
   client.stop();
 
-  #ifdef HL_DISP
-    // Hide JMRI symbol
-    display.drawBitmap(OLED_JMRI_X, OLED_AREA_1_Y, imgJMRI16x16, 16, 16, OLED_COLOR_BLACK);
-    display.display();
-  #endif
   digitalWrite(LED_STOP, LOW);
   digitalWrite(LED_FWD, HIGH);
   digitalWrite(LED_REV, HIGH);
@@ -265,172 +308,353 @@ void WiThrottle::disconnectFromJMRI() {
   delay(500);
 }
 
-// Check if WiThrottle server connection is still alive
-void WiThrottle::checkConnectionToJMRI() {
-  // I want to check the WiThrottle server connection state
-  if (!client.connected()) {
-    // Error
-    errorHandling("Connection\nto \nWiThrottle\nserver\nbroke!");
-  }
+// Get WiThrottle server connection state
+bool WiThrottle::getConnectedToJMRI() {
+  return client.connected();
 }
 
-// Listen to WiThrottle server
-void WiThrottle::listenToServer() {
-  char* cmdLine;                            // Line with commands
-  String serverInfo;                        // Complete set of commands sent by WiThrottle
-  String cmdItem;                           // Command item
-  const char* delim = "\r\n\r\n";           // Delimiter betweed lines with commands
-
-  serverInfo = readCmd();
-
-  if (serverInfo != "") {
-    // Split different commands
-    cmdLine = strtok(const_cast<char*>(serverInfo.c_str()), delim);
-    while (cmdLine != NULL) {
-      cmdItem = String(cmdLine);
-
-      // I want to check the type of information
-      if (cmdItem.startsWith("M0")) {
-        // MultiThrottle information
-        cmdItem = cmdItem.substring(2, cmdItem.length());
-        loco[0].listenToThrottle(cmdItem);
-      }
-      else if (cmdItem.startsWith("*")) {
-        // Heartbeat information
-        cmdItem = cmdItem.substring(1, cmdItem.length());
-        hostSettings.heartbeat = cmdItem.toInt();
-
-        #ifdef DEBUG
-          Serial.println("Heartbeat is expected after " + String(hostSettings.heartbeat) + " seconds.");
-        #endif
-      }
-      else if (cmdItem.startsWith("PFT")) {
-        // Fastclock information
-        cmdItem.replace("PFT", "");
+// Connection state
 
-        // Unix Timestamp of fast clock supplied by WiThrottle server
-        fastClockSettings.timeStamp = (cmdItem.substring(0, cmdItem.indexOf("<;>")).toInt());
+// Check connection and restore it if it is lost
+void WiThrottle::connectionLoop() {
+  /*
+   * A lost connection is restored without blocking the handset:
+   *
+   * CONN_READY       --> CONN_DEGRADED:    WiFi or WiThrottle server connection lost
+   * CONN_DEGRADED    --> CONN_ASSOCIATING: backoff expired, WiFi not connected
+   * CONN_DEGRADED    --> CONN_CONNECTING:  backoff expired, WiFi connected
+   * CONN_ASSOCIATING --> CONN_CONNECTING:  WiFi connected
+   * CONN_CONNECTING  --> CONN_HANDSHAKING: WiThrottle server won the race
+   * CONN_CONNECTING  --> CONN_DISCOVERING: race lost, discovery still running
+   * CONN_DISCOVERING --> CONN_CONNECTING:  WiThrottle server discovered
+   * CONN_HANDSHAKING --> CONN_READY:       WiThrottle server greeted, locos are acquired again
+   *
+   * Every failure leads back to CONN_DEGRADED with a longer backoff.
+   * WiThrottle is only turned off if the connection can't be restored
+   * within CONN_GIVE_UP, or if it has never been ready and failed
+   * <attempts> times. No state waits: the race and the discovery are
+   * checked once per loop pass.
+   */
 
-        // Sync with millis
-        fastClockSettings.timeStampMillis = millis();
+  IPAddress ip[HOST_CANDIDATES];            // IP addresses of WiThrottle servers to race
+  uint16_t port[HOST_CANDIDATES];           // Ports of WiThrottle servers to race
+  byte count;                               // Number of WiThrottle servers to race
+  int fd;                                   // Socket of WiThrottle server that won the race
+  byte winner;                              // WiThrottle server that won the race
+
+  switch (connectionState) {
+    case CONN_READY:
+      // I want to check if WiFi or WiThrottle server connection broke
+      if (WiFi.status() != WL_CONNECTED || !client.connected()) {
+        LOG_WARN("Connection to WiThrottle server broke.");
+
+        lostTime = millis();
+        failures = 0;
+        client.stop();
+        loco[0].release();
+        scheduleRetry();
+      }
+      break;
 
-        // Fast time ratio
-        if (cmdItem.indexOf("<;>") >= 0) {
-          // Sometimes ratio is not sent by WiThrottle server
-          fastClockSettings.ratio = cmdItem.substring(cmdItem.indexOf("<;>") + 3, cmdItem.length()).toDouble();
+    case CONN_DEGRADED:
+      // I want to check if next attempt to reconnect is due
+      if ((int32_t)(millis() - retryTime) >= 0) {
+        if (WiFi.status() == WL_CONNECTED) {
+          setConnectionState(CONN_CONNECTING);
+        }
+        else {
+          WiFi.reconnect();
+          setConnectionState(CONN_ASSOCIATING);
         }
+      }
+      break;
 
-        #ifdef DEBUG
-          Serial.printf("Fast clock timestamp is %02d:%02d:%02d, fast time runs with a ratio of %2.1f.\n", hour(fastClockSettings.timeStamp), minute(fastClockSettings.timeStamp), second(fastClockSettings.timeStamp), fastClockSettings.ratio);
-        #endif
+    case CONN_ASSOCIATING:
+      // I want to check if WiFi connection has been restored
+      if (WiFi.status() == WL_CONNECTED) {
+        setConnectionState(CONN_CONNECTING);
+      }
+      else if (millis() - retryTime > CONN_BACKOFF_MAX) {
+        failures++;
+        scheduleRetry();
       }
-      else if (cmdItem.startsWith("PPA")) {
-        // Track power information
-        cmdItem.replace("PPA", "");
-        trackPower = cmdItem.toInt();
-
-        #ifdef DEBUG
-          Serial.print("Track power of DCC system ");
-          if (trackPower == 1) {
-            Serial.println("is on.");
-          }
-          else if (trackPower == 0) {
-            Serial.println("is off.");
-          }
-          else {
-            Serial.println("has an unknown state.");
-          }
-        #endif
+      break;
+
+    case CONN_CONNECTING:
+      // I want to check if race has to be started; the WiThrottle server connected to last is raced first
+      if (!race.running) {
+        count = getServerCandidates(ip, port);
+        LOG_INFO("Racing %u WiThrottle server(s).", count);
+        raceStart(race, ip, port, count);
       }
-      else if (cmdItem.startsWith("PR")) {
-        // Route list
-        cmdItem = cmdItem.substring(cmdItem.indexOf("]\[") + 1, cmdItem.length());
-        lists.route = cmdItem;
-
-        #ifdef DEBUG
-          Serial.print("Route list received: ");
-          if (lists.route == "") {
-            Serial.println("no entries.");
-          }
-          else {
-            Serial.println(lists.route);
-          }
-        #endif
+
+      // I want to check if any WiThrottle server won the race
+      fd = racePoll(race, winner);
+      if (fd >= 0) {
+        introduceToServer(fd, race.ip[winner], race.port[winner]);
+        bootMark(BOOT_JMRI);
+        handshakeTime = millis();
+        setConnectionState(CONN_HANDSHAKING);
       }
-      else if (cmdItem.startsWith("PT")) {
-        // Turnout list
-        cmdItem = cmdItem.substring(cmdItem.indexOf("]\[") + 1, cmdItem.length());
-        lists.turnout = cmdItem;
-
-        #ifdef DEBUG
-          Serial.print("Turnout list received: ");
-          if (lists.turnout == "") {
-            Serial.println("no entries.");
-          }
-          else {
-            Serial.println(lists.turnout);
-          }
-        #endif
+      else if (fd == RACE_LOST) {
+        // I want to check if discovery may still find a WiThrottle server
+        if (!discovery.isDone()) {
+          discoveryTime = millis();
+          setConnectionState(CONN_DISCOVERING);
+        }
+        else {
+          failures++;
+          scheduleRetry();
+        }
       }
-      else if (cmdItem.startsWith("PW")) {
-        // JMRI web port
-        cmdItem.replace("PW", "");
+      break;
 
-        #ifdef DEBUG
-          Serial.println("Used web port is " + cmdItem + ".");
-        #endif
+    case CONN_DISCOVERING:
+      // I want to check if discovery found a WiThrottle server; it is raced then
+      if (discovery.getServer(ip[0], port[0])) {
+        setConnectionState(CONN_CONNECTING);
       }
-      else if (cmdItem.startsWith("RC")) {
-        // Consist list
-        cmdItem.replace("RCC0", "");
-        cmdItem = cmdItem.substring(cmdItem.indexOf("]\[") + 1, cmdItem.length());
-        lists.consist = cmdItem;
-
-        #ifdef DEBUG
-          Serial.print("Consist list received: ");
-          if (lists.consist == "") {
-            Serial.println("no entries.");
-          }
-          else {
-            Serial.println(lists.consist);
-          }
-        #endif
+      else if (discovery.isDone() || millis() - discoveryTime >= JMRI_DISCOVERY_TIMEOUT) {
+        failures++;
+        scheduleRetry();
       }
-      else if (cmdItem.startsWith("RL")) {
-        // Roster list
-        cmdItem.replace("RL0", "");
-        cmdItem = cmdItem.substring(cmdItem.indexOf("]\[") + 1, cmdItem.length());
-        lists.roster = cmdItem;
-
-        #ifdef DEBUG
-          Serial.print("Roster list received: ");
-          if (lists.roster == "") {
-            Serial.println("no entries.");
-          }
-          else {
-            Serial.println(lists.roster);
-          }
-        #endif
+      break;
+
+    case CONN_HANDSHAKING:
+      // I want to check if WiThrottle server greeted
+      if (serverGreeted) {
+        setCachedServer(serverIP, serverPort);
+        turnHeartbeatMonitoringOn();
+
+        // I want to acquire the loco WiThrottle had before the connection broke or selected while booting
+        if (loco[0].getAddress() != 0) {
+          loco[0].acquire();
+        }
+
+        // I want to check if a lost connection has been restored
+        if (wasReady) {
+          reconnects++;
+          reconnectTimeLast = millis() - lostTime;
+          reconnectTimeMax = max(reconnectTimeMax, reconnectTimeLast);
+          #if LOG_LEVEL >= LOG_LEVEL_INFO
+            printConnectionStats(Serial);
+          #endif
+        }
+        wasReady = true;
+        setConnectionState(CONN_READY);
       }
-      else if (cmdItem.startsWith("VN")) {
-        // Protocol version
-        cmdItem.replace("VN", "");
-        hostSettings.protocolVersion = cmdItem;
-
-        #ifdef DEBUG
-          Serial.println("Protocol version is " + cmdItem + ".");
-        #endif
+      else if (!client.connected() || millis() - handshakeTime > CONN_HANDSHAKE_TIMEOUT) {
+        client.stop();
+        failures++;
+        scheduleRetry();
+      }
+      break;
+  }
+
+  // I want to check if WiThrottle was able to establish a connection to WiThrottle server in defined number of attempts
+  if (!wasReady && failures >= hostSettings.attempts) {
+    // Error
+    errorHandling("Failed to\nconnect to\nWiThrottle\nserver!");
+  }
+
+  // I want to check if WiThrottle has to give up
+  if (connectionState != CONN_READY && millis() - lostTime > CONN_GIVE_UP) {
+    // Error
+    errorHandling("Connection\nto \nWiThrottle\nserver\nbroke!");
+  }
+}
+
+// Get connection state
+byte WiThrottle::getConnectionState() {
+  return connectionState;
+}
+
+// Print statistics of reconnections
+void WiThrottle::printConnectionStats(Print &out) {
+  out.printf("Reconnected %u times, last reconnection took %lu ms, longest %lu ms.\n", reconnects, reconnectTimeLast, reconnectTimeMax);
+}
+
+// Change connection state
+void WiThrottle::setConnectionState(byte state) {
+  #if LOG_LEVEL >= LOG_LEVEL_INFO
+    const char* stateTxt[] = { "associating", "connecting", "handshaking", "ready", "degraded", "discovering" };
+                                            // Connection state as a text --> used for debugging
+    LOG_INFO("Connection state: %s (after %lu ms).", stateTxt[state], millis() - lostTime);
+  #endif
+
+  connectionState = state;
+
+  // Emergency stop LED indicates that the loco can't be controlled
+  if (state == CONN_DEGRADED) {
+    digitalWrite(LED_STOP, HIGH);
+  }
+}
+
+// Schedule next attempt to reconnect with jittered exponential backoff
+void WiThrottle::scheduleRetry() {
+  /*
+   * Backoff doubles with every failed attempt from CONN_BACKOFF_MIN up
+   * to CONN_BACKOFF_MAX and is jittered by +/- 50 %, so throttles that
+   * lost their connection at the same time don't reconnect in lockstep.
+   */
+
+  unsigned long backoff;                    // Delay before next attempt; unit: ms
+
+  backoff = min((unsigned long)CONN_BACKOFF_MAX, (unsigned long)CONN_BACKOFF_MIN << min(failures, 5u));
+  backoff = backoff / 2 + random(backoff);
+  retryTime = millis() + backoff;
+
+  // I want to check if WiThrottle server may have moved
+  if (failures == CONN_REDISCOVER) {
+    discovery.start(name);
+  }
+
+  setConnectionState(CONN_DEGRADED);
+}
+
+
+// Listen to WiThrottle server
+void WiThrottle::listenToServer() {
+  /*
+   * Data is processed as it arrives: lines are collected in <cmdLine>
+   * and processed as soon as they are complete. The roster list is
+   * passed on to the roster character by character instead, so even a
+   * large roster is never held in memory as a whole.
+   */
+
+  uint8_t chunk[CMD_SIZE];                  // Data read from WiThrottle server at once
+  int length;                               // Number of bytes read
+  char c;                                   // Character read
+
+  while ((length = client.read(chunk, sizeof(chunk))) > 0) {
+    captureData(CAPTURE_RECEIVED, chunk, length);
+
+    for (int i = 0; i < length; i++) {
+      c = chunk[i];
+
+      // I want to check if line is complete
+      if (c == '\r' || c == '\n') {
+        if (rosterReceiving) {
+          roster.end();
+          rosterReceiving = false;
+          bootMark(BOOT_ROSTER);
+        }
+        else if (cmdLineLength > 0) {
+          cmdLine[min(cmdLineLength, (unsigned int)sizeof(cmdLine) - 1)] = '\0';
+          processCmd(String(cmdLine));
+        }
+        cmdLineLength = 0;
+      }
+      else if (rosterReceiving) {
+        roster.add(c);
       }
       else {
-        // Unknown command
-        #ifdef DEBUG
-          Serial.println("Class WiThrottle: Unknown command '" + serverInfo + "'.");
-        #endif
+        // Characters beyond <cmdLine> are dropped
+        if (cmdLineLength < sizeof(cmdLine) - 1) {
+          cmdLine[cmdLineLength] = c;
+        }
+        cmdLineLength++;
+
+        // I want to check if roster list starts
+        if (cmdLineLength == 2 && cmdLine[0] == 'R' && cmdLine[1] == 'L') {
+          roster.begin();
+          rosterReceiving = true;
+        }
       }
+    }
+  }
+}
+
+// Process a line sent by WiThrottle server
+void WiThrottle::processCmd(String cmdItem) {
+  bool wasAcquired;                         // Loco has been acquired before information
+
+  LOG_DEBUG("<--: %s", cmdItem);
+
+  // I want to check the type of information
+  if (cmdItem.startsWith("M0")) {
+    // MultiThrottle information
+    cmdItem = cmdItem.substring(2, cmdItem.length());
+    wasAcquired = loco[0].getAcquired();
+    loco[0].listenToThrottle(cmdItem);
 
-      cmdLine = strtok(NULL, delim);
+    // DCC address is only kept for next power-on once WiThrottle server has confirmed the acquisition
+    if (!wasAcquired && loco[0].getAcquired()) {
+      setLastAddress(loco[0].getAddress(), loco[0].getAddressType());
     }
   }
+  else if (cmdItem.startsWith("*")) {
+    // Heartbeat information
+    cmdItem = cmdItem.substring(1, cmdItem.length());
+    hostSettings.heartbeat = cmdItem.toInt();
+
+    LOG_INFO("Heartbeat is expected after %u seconds.", hostSettings.heartbeat);
+  }
+  else if (cmdItem.startsWith("PFT")) {
+    // Fastclock information
+    cmdItem.replace("PFT", "");
+
+    // Unix Timestamp of fast clock supplied by WiThrottle server
+    fastClockSettings.timeStamp = (cmdItem.substring(0, cmdItem.indexOf("<;>")).toInt());
+
+    // Sync with millis
+    fastClockSettings.timeStampMillis = millis();
+
+    // Fast time ratio
+    if (cmdItem.indexOf("<;>") >= 0) {
+      // Sometimes ratio is not sent by WiThrottle server
+      fastClockSettings.ratio = cmdItem.substring(cmdItem.indexOf("<;>") + 3, cmdItem.length()).toDouble();
+    }
+
+    LOG_DEBUG("Fast clock timestamp is %02d:%02d:%02d, fast time runs with a ratio of %2.1f.", hour(fastClockSettings.timeStamp), minute(fastClockSettings.timeStamp), second(fastClockSettings.timeStamp), fastClockSettings.ratio);
+  }
+  else if (cmdItem.startsWith("PPA")) {
+    // Track power information
+    cmdItem.replace("PPA", "");
+    trackPower = cmdItem.toInt();
+
+    LOG_INFO("Track power of DCC system %s.", trackPower == POWER_ON ? "is on" : (trackPower == POWER_OFF ? "is off" : "has an unknown state"));
+  }
+  else if (cmdItem.startsWith("PR")) {
+    // Route list
+    cmdItem = cmdItem.substring(cmdItem.indexOf("]\[") + 1, cmdItem.length());
+    lists.route = cmdItem;
+
+    LOG_DEBUG("Route list received: %s", lists.route == "" ? "no entries." : lists.route.c_str());
+  }
+  else if (cmdItem.startsWith("PT")) {
+    // Turnout list
+    cmdItem = cmdItem.substring(cmdItem.indexOf("]\[") + 1, cmdItem.length());
+    lists.turnout = cmdItem;
+
+    LOG_DEBUG("Turnout list received: %s", lists.turnout == "" ? "no entries." : lists.turnout.c_str());
+  }
+  else if (cmdItem.startsWith("PW")) {
+    // JMRI web port
+    cmdItem.replace("PW", "");
+
+    LOG_DEBUG("Used web port is %s.", cmdItem);
+  }
+  else if (cmdItem.startsWith("RC")) {
+    // Consist list
+    cmdItem.replace("RCC0", "");
+    cmdItem = cmdItem.substring(cmdItem.indexOf("]\[") + 1, cmdItem.length());
+    lists.consist = cmdItem;
+
+    LOG_DEBUG("Consist list received: %s", lists.consist == "" ? "no entries." : lists.consist.c_str());
+  }
+  else if (cmdItem.startsWith("VN")) {
+    // Protocol version
+    cmdItem.replace("VN", "");
+    hostSettings.protocolVersion = cmdItem;
+    serverGreeted = true;
+
+    LOG_INFO("Protocol version is %s.", cmdItem);
+  }
+  else {
+    // Unknown command
+    LOG_WARN("Class WiThrottle: Unknown command '%s'.", cmdItem);
+  }
 }
 
 
@@ -438,37 +662,25 @@ void WiThrottle::listenToServer() {
 
 // Put WiThrottle into sleep mode
 void WiThrottle::shutdown() {
-  String shutdownMessage;                   // Shutdown sequence message
-
   loco[0].dispatch();
   retractLoco();
   turnHeartbeatMonitoringOff();
   disconnectFromJMRI();
   disconnectFromWiFi();
 
-  #ifdef HL_DISP
-    display.clearDisplay();
-    display.display();
-
-    // Write shutdown sequence message to display
-    shutdownMessage = "WiThrottle\nis going\nto sleep!";
-    display.setCursor(0, 48);
-    display.println(shutdownMessage);
-    display.drawBitmap(4, 4, imgBootSequence56x32, 56, 32, OLED_COLOR_WHITE);
-    display.display();
-
-    // Wait to keep shutdown message readable
-    delay(2500);
-
-    display.clearDisplay();
-    display.display();
-  #endif
+  // I want to check if shutdown sequence message can be shown
+  if (showMessage != NULL) {
+    showMessage("WiThrottle\nis going\nto sleep!", MSG_SHUTDOWN);
+  }
 
   #ifdef DEBUG
     Serial.println("WiThrottle is going to sleep!\n--\nEnd\n<---");
     delay(500);
   #endif
 
+  // Log records still in ring buffer are written before going to sleep
+  logFlush();
+
   Serial.end();
   esp_deep_sleep_start();
 }
@@ -506,25 +718,44 @@ bool WiThrottle::checkActiveLoco() {
 unsigned int WiThrottle::getLastAddress() {
   byte byte_1 = EEPROM.read(1);         // First byte of DCC address
   byte byte_2 = EEPROM.read(2);         // Second byte of DCC address
+  unsigned int address = int(byte_1 << 8) + int(byte_2);
+  // DCC address
 
-  return int(byte_1 << 8) + int(byte_2);
+  // I want to check if EEPROM has been written at all; then the flag of a long DCC address is removed
+  if (address != 65535) {
+    address &= ~EEPROM_ADDRESS_LONG;
+  }
+  return address;
+}
+
+// Read address type of last active DCC address from EEPROM
+char WiThrottle::getLastAddressType() {
+  byte byte_1 = EEPROM.read(1);         // First byte of DCC address
+  byte byte_2 = EEPROM.read(2);         // Second byte of DCC address
+  unsigned int address = int(byte_1 << 8) + int(byte_2);
+  // DCC address
+
+  return (address & EEPROM_ADDRESS_LONG) || address > 127 ? 'L' : 'S';
 }
 
 // Write last active DCC address to EEPROM
-void WiThrottle::setLastAddress(unsigned int address) {
+void WiThrottle::setLastAddress(unsigned int address, char addressType) {
   byte byte_1 = EEPROM.read(1);         // First byte of DCC address
   byte byte_2 = EEPROM.read(2);         // Second byte of DCC address
   unsigned int addressLast = int(byte_1 << 8) + int(byte_2);
   // DCC address
 
+  // I want to check if address type can't be told from DCC address
+  if (addressType == 'L' && address <= 127) {
+    address |= EEPROM_ADDRESS_LONG;
+  }
+
   if (address != addressLast) {
     // Address to save is different from last stored address
     byte_1 = byte(address >> 8);
     byte_2 = byte(address & 0x00FF);
 
-    #ifdef DEBUG
-      Serial.println("Write last DCC address " + String(address) + " to EEPROM.");
-    #endif
+    LOG_INFO("Write last DCC address %c%u to EEPROM.", addressType, address & ~EEPROM_ADDRESS_LONG);
 
     EEPROM.write(1, byte_1);
     EEPROM.write(2, byte_2);
@@ -532,109 +763,19 @@ void WiThrottle::setLastAddress(unsigned int address) {
   }
 }
 
-// Get a DCC address by menu
-unsigned int WiThrottle::getAddressByMenu() {
-  /*
-   * TODO
-   */
-//  unsigned int x = 0;
-//  unsigned int y;
-//
-//  y = OLED_AREA_3_Y;
-//  display.setTextColor(OLED_COLOR_WHITE);
-//  display.setCursor(x, y);
-//  display.print("Address?");
-//
-//  y = y + 10;
-//  display.setTextColor(OLED_COLOR_BLACK, OLED_COLOR_WHITE);
-//  display.setCursor(x, y);
-//  display.print("0");
-//  display.setTextColor(OLED_COLOR_WHITE, OLED_COLOR_BLACK);
-//  display.print("0");
-//  display.print("0");
-//  display.print("0");
-//  display.display();
-  return 0;
-}
-
-// Get a DCC address by serial monitor
-unsigned int WiThrottle::getAddressBySerial() {
-  unsigned int address (0);                 // DCC address of loco
-  String addressInput;                      // Input read from serial monitor
-  bool isValidAddress = true;               // True if input is a valid DCC address
-  unsigned long startTime;                  // Start time emergency stop button has been pressed
-
-  // Turn heartbeat monitoring off while waiting for input
-  turnHeartbeatMonitoringOff();  
-  Serial.println("Please enter DCC address.");
-
-  // Wait until input received
-  while (Serial.available() == 0) {
-    startTime = millis();
-    while (digitalRead(BTN_STOP) == LOW) {
-      // I want to check the time the emergency stop button is beeing pressed
-      if ((millis() - startTime) >= 5000) {
-        // WiThrottle will be turned off
-        shutdown();
-      }
-    }
-  }
-
-  // Received input by serial monitor    
-  while (Serial.available() > 0) {
-    addressInput = Serial.readString();
-
-    // Remove line feed
-    addressInput = addressInput.substring(0, addressInput.length() - 1);
-
-    // Compare length of input with allowed length
-    isValidAddress = (addressInput.length() >= 1 && addressInput.length() <= 5);
-
-    // Proceed if length of input is okay
-    if (isValidAddress) {
-      // I want to check if each digtit of the input is numeric
-      for(int i = 0; i < addressInput.length(); i++) {
-        isValidAddress = (isDigit(addressInput.charAt(i)) && isValidAddress);
-      }
-
-      // Proceed if input is numeric
-      if (isValidAddress) {
-        // I want to check if input is in extended DCC address range (1 to 10239)
-        address = addressInput.toInt();
-        isValidAddress = (address > 0 && address <= 10239);
-      }
-    }
-  }
-
-  // Error handling in case input is not a valid DCC address
-  if (!isValidAddress) {
-    address = 0;
-    Serial.println(addressInput + " is not a valid DCC address.\nValid DCC addresses are from 1 to 10239.");
-  }
-
-  // Turn heartbeat monitoring on
-  turnHeartbeatMonitoringOn();
-  
-  return address;
-}
-
 
 // Layout control
 
 // Switch track power of DCC system on
 void WiThrottle::switchDCCPowerOn() {
-  #ifdef DEBUG
-    Serial.println("Switch track power of DCC system on.");
-  #endif
+  LOG_INFO("Switch track power of DCC system on.");
 
   sendCmd("PPA1");
 }
 
 // Switch track power of DCC system off
 void WiThrottle::switchDCCPowerOff() {
-  #ifdef DEBUG
-    Serial.println("Switch Track power of DCC system off.");
-  #endif
+  LOG_INFO("Switch track power of DCC system off.");
 
   sendCmd("PPA0");
 }
@@ -642,28 +783,9 @@ void WiThrottle::switchDCCPowerOff() {
 
 // Fast clock
 
-// Updates fast clock
-void WiThrottle::fastClockUpdate() {
-  #ifdef HL_DISP
-    unsigned long timeStampAct;               // Actual timestamp for fast clock
-    unsigned int x = (OLED_HEIGHT - (5 * 6)) / 2 + 2;
-    // x-position of fast clock on display
-
-    timeStampAct = fastClockSettings.timeStamp + (long)((millis() - fastClockSettings.timeStampMillis) * fastClockSettings.ratio / 1000);
-    if (hour(timeStampAct) != hour(timeStampFC) || minute(timeStampAct) != minute(timeStampFC)) {
-      display.setTextColor(OLED_COLOR_BLACK);
-      display.setCursor(x, OLED_AREA_2_Y);
-      display.printf("%02d:%02d", hour(timeStampFC), minute(timeStampFC));
-      display.display();
-
-      timeStampFC = timeStampAct;
-
-      display.setTextColor(OLED_COLOR_WHITE);
-      display.setCursor(x, OLED_AREA_2_Y);
-      display.printf("%02d:%02d", hour(timeStampFC), minute(timeStampFC));
-      display.display();
-    }
-  #endif
+// Get actual fast clock time as Unix Timestamp
+unsigned long WiThrottle::getFastClock() {
+  return fastClockSettings.timeStamp + (long)((millis() - fastClockSettings.timeStampMillis) * fastClockSettings.ratio / 1000);
 }
 
 
@@ -677,27 +799,37 @@ void WiThrottle::sendHeartbeat() {
   
   // I want to check if timeout is near
   if (secondsSinceLastHeartbeat > (hostSettings.heartbeat - 2)) {
-    #ifdef DEBUG
-      Serial.printf("Send Heartbeat after %2.1f seconds of inactivity.\n", secondsSinceLastHeartbeat);
-    #endif
-    sendCmd("*");
+    LOG_DEBUG("Send Heartbeat after %2.1f seconds of inactivity.", secondsSinceLastHeartbeat);
+    sendCmd("*", false);
+  }
+}
+
+// Get time until next heartbeat is due; unit: ms
+unsigned long WiThrottle::getHeartbeatTimeout() {
+  unsigned long elapsed = millis() - lastHeartbeat;
+                                            // Time since last heartbeat has been sent; unit: ms
+  unsigned long interval;                   // Time between heartbeats; unit: ms
+
+  // I want to check if WiThrottle server expects a heartbeat at all
+  if (hostSettings.heartbeat <= 2) {
+    return ULONG_MAX;
   }
+
+  interval = (hostSettings.heartbeat - 2) * 1000UL;
+
+  return elapsed < interval ? interval - elapsed : 0;
 }
 
 // Turn heartbeat monitoring on
 void WiThrottle::turnHeartbeatMonitoringOn() {
-  #ifdef DEBUG
-    Serial.println("Turn heartbeat monitoring on.");
-  #endif
+  LOG_DEBUG("Turn heartbeat monitoring on.");
 
   sendCmd("*+", false);
 }
 
 // Turn heartbeat monitoring off
 void WiThrottle::turnHeartbeatMonitoringOff() {
-  #ifdef DEBUG
-    Serial.println("Turn heartbeat monitoring off.");
-  #endif
+  LOG_DEBUG("Turn heartbeat monitoring off.");
 
   sendCmd("*-", false);
 }
@@ -713,32 +845,24 @@ void WiThrottle::errorHandling(String errorMsg) {
    * Throttle has to be reset after an error occurs
    */
 
-  unsigned long startTime = millis();       // Time when errorHandling begins
+  uint32_t startTime = millis();            // Time when errorHandling begins
   bool ledState = LOW;                      // Status of emergency stop LED
 
-  #ifdef DEBUG
-    Serial.println("\r\n(!)\r\n\r\n" + errorMsg + "\r\n");
-  #endif
+  // Log records still in ring buffer are written before the traffic dump
+  LOG_ERROR("(!) %s", errorMsg);
+  logFlush();
 
-  #ifdef HL_DISP
-    unsigned int imgColor = OLED_COLOR_BLACK; // Color of symbol
-    
-    // Write error message on display
-    display.clearDisplay();
-    display.setCursor(0, 30);
-    display.println(errorMsg);
-    display.display();
-  #endif
+  // Traffic leading to the error is written for analysis
+  captureDump(Serial);
 
-  // Flash LED and show error symbol on display
+  // I want to check if error message can be shown
+  if (showMessage != NULL) {
+    showMessage(errorMsg, MSG_ERROR);
+  }
+
+  // Flash LED
   do {
     // Don't proceed, loop for 5 seconds and then turn off WiThrottle
-    #ifdef HL_DISP
-      // Inverse color of symbol
-      imgColor = !imgColor;
-      display.drawBitmap(0, 0, imgExlamation16x16, 16, 16, imgColor);
-      display.display();
-    #endif
 
     // Inverse LED state
     ledState = !ledState;
@@ -748,10 +872,5 @@ void WiThrottle::errorHandling(String errorMsg) {
     delay(LED_DELAY);
   } while ((millis() - startTime) <= 5000);
 
-  #ifdef HL_DISP
-    display.clearDisplay();
-    display.display();
-  #endif
-
   shutdown();
 }
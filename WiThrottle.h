@@ -6,6 +6,9 @@
 #define _WI_THROTTLE_H_
 
 #include "CrossFunc.h"
+#include "Discovery.h"
+#include "Race.h"
+#include "Roster.h"
 #include "VirtualLoco.h"
 #include <Arduino.h>
 #include <WiFi.h>
@@ -22,12 +25,23 @@
 // Locos
 #define LOCO_MAX            2               // Maximum number of locos to be handled by WiThrottle
 
+// Connection state
+#define CONN_ASSOCIATING    0               // Associating with WiFi
+#define CONN_CONNECTING     1               // Connecting to WiThrottle server
+#define CONN_HANDSHAKING    2               // Waiting for WiThrottle server to greet
+#define CONN_READY          3               // Ready for operation
+#define CONN_DEGRADED       4               // Connection lost, waiting for next attempt to reconnect
+#define CONN_DISCOVERING    5               // Race lost, waiting for discovery of WiThrottle server by mDNS
+
+// Messages to be shown by the handset
+#define MSG_ERROR           1               // Error message
+#define MSG_SHUTDOWN        2               // Shutdown sequence message
+
 
 // Structures
 
 // Lists supplied to WiThrottle by WiThrottle server
 typedef struct {
-  String roster = "";                     // Roster list
   String turnout = "";                    // Turnout list --> not used by now
   String route = "";                      // Route list --> not used by now
   String consist = "";                    // Consist list --> not used by now
@@ -37,9 +51,12 @@ typedef struct {
 typedef struct {
   unsigned long timeStamp = 0;              // Start time of fast clock as Unix Timestamp supplied by WiThrottle server
   double ratio;                             // Fast time ratio
-  unsigned long timeStampMillis = 0;        // Millis since <timeStamp> has been updated
+  uint32_t timeStampMillis = 0;             // Millis since <timeStamp> has been updated
 } fastClockConfig;
 
+// Handler showing a message on the handset, e. g. on a display
+typedef void (*messageHandler)(const String &message, byte messageType);
+
 
 class WiThrottle {
   private:
@@ -49,40 +66,85 @@ class WiThrottle {
     // WiFi communication
     wiFiConfig wiFiSettings;                // WiFi settings
     byte macAddress[6];                     // MAC address
+    unsigned int wiFiAttempts = 0;          // Attempts to connect to WiFi started
+    uint32_t wiFiStartTime;                 // Timestamp last attempt to connect to WiFi has been started
+
+    // Connection state
+    byte connectionState = CONN_ASSOCIATING;
+                                            // Connection state
+    uint32_t lostTime = 0;                  // Timestamp connection has been lost
+    uint32_t retryTime;                     // Timestamp of next attempt to reconnect
+    uint32_t handshakeTime;                 // Timestamp connection to WiThrottle server has been established
+    uint32_t discoveryTime;                 // Timestamp waiting for discovery has been started
+    unsigned int failures = 0;              // Failed attempts to reconnect
+    bool serverGreeted = false;             // WiThrottle server has sent its protocol version
+    bool wasReady = false;                  // WiThrottle has been ready for operation, i. e. a connection is restored
+    unsigned int reconnects = 0;            // Number of reconnections
+    unsigned long reconnectTimeLast = 0;    // Duration of last reconnection; unit: ms
+    unsigned long reconnectTimeMax = 0;     // Duration of longest reconnection; unit: ms
+    void setConnectionState(byte state);    // Change connection state
+    void scheduleRetry();                   // Schedule next attempt to reconnect with jittered exponential backoff
 
     // WiThrottle server communication
     hostConfig hostSettings;                // WiThrottle server settings
+    IPAddress serverIP;                     // IP address of WiThrottle server connected to
+    uint16_t serverPort = 0;                // Port of WiThrottle server connected to
     const String cmdPrefix = "M0";          // Prefix to be sent for Multithrottle commands
+    ServerDiscovery discovery;              // Discovery of WiThrottle server by mDNS
+    serverRace race;                        // Race of connections to WiThrottle servers
+    void introduceToServer(int fd, IPAddress ip, uint16_t port);
+                                            // Take over connection to WiThrottle server that won the race and introduce WiThrottle
+    byte getServerCandidates(IPAddress ip[], uint16_t port[]);
+                                            // Collect WiThrottle servers to race in order of preference
+    bool getCachedServer(IPAddress &ip, uint16_t &port);
+                                            // Read WiThrottle server WiThrottle was connected to last from EEPROM
+    void setCachedServer(IPAddress ip, uint16_t port);
+                                            // Write WiThrottle server WiThrottle is connected to to EEPROM
+
+    // Reception
+    char cmdLine[CMD_LINE_SIZE];            // Line being received from WiThrottle server
+    unsigned int cmdLineLength = 0;         // Length of line being received; may exceed <cmdLine>
+    bool rosterReceiving = false;           // Roster list is being received
+    void processCmd(String cmdItem);        // Process a line sent by WiThrottle server
 
     // Layout control
     byte trackPower = POWER_UNKNOWN;        // Track power of DCC system
     fastClockConfig fastClockSettings;      // Fast clock settings
 
-    // Fast clock
-    unsigned long timeStampFC;              // Last timestamp for fast clock
+    // Handset
+    messageHandler showMessage = NULL;      // Handler showing messages on the handset
 
   public:
     // Constructor
     WiThrottle(char* name);
 
-    // Display initialization
-    void initDisplay();
+    // Handset
+    void setMessageHandler(messageHandler handler);
+                                            // Set handler showing messages on the handset
 
     // EEPROM initialization
     void initEeprom();
 
     // WiFi connection
+    void startWiFi(wiFiConfig &wiFiSettings);
+                                            // Start connecting to WiFi without waiting, e. g. while hardware is initialized
     void connectToWiFi(wiFiConfig &wiFiSettings);
                                             // Connect to WiFi
     void disconnectFromWiFi();              // Disconnect from WiFi
-    void checkConnectionToWiFi();           // Check if WiFi connection is still alive
+    bool getConnectedToWiFi();              // Get WiFi connection state
 
     // WiThrottle server connection
-    void connectToJMRI(hostConfig &host);   // Connect to WiThrottle server
+    void connectToJMRI(hostConfig &host);   // Start connecting to WiThrottle server; connection is established by connectionLoop()
     void disconnectFromJMRI();              // Disconnect from WiThrottle server
-    void checkConnectionToJMRI();           // Check if WiThrottle server connection is still alive
+    bool getConnectedToJMRI();              // Get WiThrottle server connection state
     void listenToServer();                  // Listen to WiThrottle server
     jmriLists lists;                        // Lists supplied to WiThrottle by WiThrottle server
+    Roster roster;                          // Roster list received from WiThrottle server
+
+    // Connection state
+    void connectionLoop();                  // Check connection and restore it if it is lost
+    byte getConnectionState();              // Get connection state
+    void printConnectionStats(Print &out);  // Print statistics of reconnections
 
     // WiThrottle control
     void shutdown();                        // Put WiThrottle into sleep mode
@@ -93,20 +155,20 @@ class WiThrottle {
     bool checkActiveLoco();                 // Check if a loco is selected
     VirtualLoco loco[LOCO_MAX];             // Locos to be controlled by WiThrottle; maximum is 3 locos
     unsigned int getLastAddress();          // Read last active DCC address from EEPROM
-    void setLastAddress(unsigned int address);
-                                            // Write last active DCC address to EEPROM
-    unsigned int getAddressByMenu();        // Get a DCC address by menu
-    unsigned int getAddressBySerial();      // Get a DCC address by serial monitor
+    char getLastAddressType();              // Read address type of last active DCC address from EEPROM
+    void setLastAddress(unsigned int address, char addressType = 'S');
+                                            // Write last active DCC address to EEPROM; address type only matters below 128
 
     // Layout control
     void switchDCCPowerOn();                // Switch track power of DCC system on
     void switchDCCPowerOff();               // Switch track power of DCC system off
 
     // Fast clock
-    void fastClockUpdate();                 // Updates fast clock
+    unsigned long getFastClock();           // Get actual fast clock time as Unix Timestamp
 
     // Heartbeat
     void sendHeartbeat();                   // Send heartbeat to WiThrottle server
+    unsigned long getHeartbeatTimeout();    // Get time until next heartbeat is due; unit: ms
     void turnHeartbeatMonitoringOn();       // Turn heartbeat monitoring on
     void turnHeartbeatMonitoringOff();      // Turn heartbeat monitoring off
     
@@ -0,0 +1,240 @@
+/*
+ * Benchmarks of the protocol, command and input kernels on the host
+ *
+ * Every kernel is run BENCH_ITERATIONS times on the emulated core and
+ * the results are written to bench_output.txt in the working directory
+ * as CSV lines:
+ *
+ *   bench,<kernel>,<iterations>,<ns/op>,<allocations/op>
+ *
+ * Time is taken by the host's clock and allocations are counted by
+ * replacing the global operator new, which String uses on the host. So
+ * the figures describe the host, not the handset: they are meant for
+ * comparing a kernel before and after a change.
+ */
+
+#include "Sketch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+
+// Benchmarks
+#define BENCH_ITERATIONS 10000              // Runs of each kernel
+#define BENCH_ROSTER_SIZE  200              // Entries of the roster searched
+#define BENCH_OUTPUT "bench_output.txt"     // File results are written to
+
+typedef std::chrono::steady_clock benchClock;
+
+
+// Allocation counting
+static unsigned long benchAllocations = 0;  // Allocations while counting
+static bool benchCounting = false;          // Allocations are counted
+
+void* operator new(size_t size) {
+  void* pointer = malloc(size > 0 ? size : 1);
+
+  if (pointer == NULL) {
+    throw std::bad_alloc();
+  }
+  if (benchCounting) {
+    benchAllocations++;
+  }
+  return pointer;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer, size_t size) noexcept {
+  free(pointer);
+}
+
+
+// Pausing
+/*
+ * Preparations a kernel needs for every run, e. g. data sent by the
+ * server, are excluded from time and allocations by benchPause() and
+ * benchResume().
+ */
+static benchClock::duration benchPaused;    // Time paused during runs
+static benchClock::time_point benchPauseTime;
+                                            // Time pause started
+
+static void benchPause() {
+  benchCounting = false;
+  benchPauseTime = benchClock::now();
+}
+
+static void benchResume() {
+  benchPaused += benchClock::now() - benchPauseTime;
+  benchCounting = true;
+}
+
+
+// Fixtures
+static FakeServer server;                   // WiThrottle server
+static VirtualLoco benchLoco;               // Loco dispatching information of WiThrottle server
+static DccFunction benchFunction;           // DCC function parsing labels and sending commands
+static Roster benchRoster;                  // Roster searched by prefix
+static String benchLocoInfo = "AS3<;>V42";  // Information of WiThrottle server for loco 3
+static String benchLabels = "]\\[Light]\\[Bell]\\[Horn]\\[Air]\\[Coupler]\\[Smoke]\\[Shunt]\\[Mute]\\[Brake]";
+                                            // Function labels sent by WiThrottle server
+static const char benchBurst[] = "M0AS3<;>V42\r\nM0AS3<;>R1\r\nPPA1\r\nPFT1700000000<;>4.0\r\n";
+                                            // Lines received from WiThrottle server at once
+static const char* benchPrefixes[] = { "L", "Loco 1", "Loco 05", "Loco 199", "X" };
+                                            // Prefixes searched in roster
+static volatile unsigned int benchSink;     // Keeps results of kernels from being optimized away
+
+
+// Kernels
+
+// Tokenize lines received from WiThrottle server and dispatch them
+static void benchReceive(unsigned int i) {
+  benchPause();
+  server.connection.send(benchBurst);
+  benchResume();
+
+  throttle.listenToServer();
+}
+
+// Dispatch information of WiThrottle server to loco
+static void benchDispatch(unsigned int i) {
+  benchLoco.listenToThrottle(benchLocoInfo);
+}
+
+// Parse function labels
+static void benchParseLabels(unsigned int i) {
+  benchFunction.listenToLoco(benchLabels);
+}
+
+// Search roster by prefix
+static void benchRosterFind(unsigned int i) {
+  unsigned int first;                       // First entry found
+
+  benchSink = benchRoster.find(benchPrefixes[i % (sizeof(benchPrefixes) / sizeof(benchPrefixes[0]))], first);
+}
+
+// Build notch command as setNotch() does
+static void benchNotchCmd(unsigned int i) {
+  CmdBuffer cmd;                            // Command to be sent to WiThrottle server
+
+  cmd.add("M0AS3<;>").add('V').add((int)(i % 127));
+  benchSink = cmd.size();
+}
+
+// Toggle DCC function, i. e. build command and queue it
+static void benchToggle(unsigned int i) {
+  benchFunction.toggle();
+}
+
+// Convert a block of the potentiometer and map it to a notch
+static void benchReadNotch(unsigned int i) {
+  static const byte notchRanges[] = { 13, 27, 126 };
+                                            // Speed step modes
+  unsigned int notch = 0;                   // Notch read
+
+  // Next block is due
+  benchPause();
+  delay(POT_SAMPLE_INTERVAL);
+  benchResume();
+
+  handset.speed.readNotch(notch, notchRanges[i % 3]);
+  benchSink = notch;
+}
+
+
+// Run kernel and write result
+static void benchKernel(FILE* out, const char* name, void (*kernel)(unsigned int), unsigned int iterations) {
+  benchClock::time_point startTime;         // Start of all runs
+  double elapsed;                           // Time taken by all runs; unit: ns
+
+  // First run fills caches
+  kernel(0);
+
+  benchPaused = benchClock::duration::zero();
+  benchAllocations = 0;
+  benchCounting = true;
+  startTime = benchClock::now();
+  for (unsigned int i = 0; i < iterations; i++) {
+    kernel(i);
+  }
+  elapsed = std::chrono::duration<double, std::nano>(benchClock::now() - startTime - benchPaused).count();
+  benchCounting = false;
+
+  fprintf(out, "bench,%s,%u,%.1f,%.2f\n", name, iterations, elapsed / iterations, double(benchAllocations) / iterations);
+}
+
+static bool isDrivable() {
+  return throttle.getConnectionState() == CONN_READY && throttle.loco[0].getAcquired();
+}
+
+int main() {
+  char item[32];                            // Roster item
+  FILE* out;                                // Results
+
+  // Kernels that work without WiThrottle server
+  benchLoco.select(3);
+  benchFunction.setFn(8);
+  benchFunction.setPrefix("M0AS3<;>");
+
+  benchRoster.begin();
+  for (unsigned int i = 0; i < BENCH_ROSTER_SIZE; i++) {
+    snprintf(item, sizeof(item), "]\\[Loco %03u}|{%u}|{%c", i, i + 100, i + 100 > 127 ? 'L' : 'S');
+    for (char* c = item; *c != '\0'; c++) {
+      benchRoster.add(*c);
+    }
+  }
+  benchRoster.end();
+
+  out = fopen(BENCH_OUTPUT, "w");
+  if (out == NULL) {
+    perror(BENCH_OUTPUT);
+    return 1;
+  }
+
+  fprintf(out, "# bench,kernel,iterations,ns/op,allocations/op\n");
+  benchKernel(out, "VirtualLoco.listenToThrottle", benchDispatch, BENCH_ITERATIONS);
+  benchKernel(out, "DccFunction.listenToLoco.labels", benchParseLabels, BENCH_ITERATIONS);
+  benchKernel(out, "Roster.find", benchRosterFind, BENCH_ITERATIONS);
+  benchKernel(out, "setNotch.command", benchNotchCmd, BENCH_ITERATIONS);
+  benchKernel(out, "DccFunction.toggle", benchToggle, BENCH_ITERATIONS);
+
+  // Kernels that need WiThrottle connected and the handset initialized
+  server.roster.push_back({ "BR 218", 3, 'S' });
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  if (!loopUntil(isDrivable, 5000)) {
+    fprintf(stderr, "WiThrottle didn't connect to WiThrottle server.\n");
+    fclose(out);
+    return 1;
+  }
+  loopFor(100);
+
+  benchKernel(out, "WiThrottle.listenToServer", benchReceive, BENCH_ITERATIONS);
+  benchKernel(out, "PotSpeedInput.readNotch", benchReadNotch, BENCH_ITERATIONS);
+  fprintf(out, "# bench done\n");
+  fclose(out);
+
+  printf("Results written to %s.\n", BENCH_OUTPUT);
+
+  return 0;
+}
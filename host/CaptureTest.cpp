@@ -0,0 +1,127 @@
+/*
+ * Host test of the protocol capture and its replay
+ */
+
+#include "Sketch.h"
+
+
+static FakeServer server;                   // WiThrottle server answering like JMRI
+static FakeServer replayed;                 // WiThrottle server replaying the capture of <server>
+static std::vector<fakeCaptureRecord> records;
+                                            // Records of capture dumped while connected to <server>
+
+static bool isDrivable() {
+  return throttle.getConnectionState() == CONN_READY && throttle.loco[0].getAcquired();
+}
+
+static bool isDisconnected() {
+  return throttle.getConnectionState() != CONN_READY;
+}
+
+// Write capture as text trace and read it back
+static bool dumpAndLoad(std::vector<fakeCaptureRecord> &records) {
+  size_t start = hostSerialOutput().size(); // Serial output before dump
+
+  captureDump(Serial);
+  return loadCapture(hostSerialOutput().substr(start), records);
+}
+
+// Data of all records in <direction> joined
+static std::string join(const std::vector<fakeCaptureRecord> &records, char direction) {
+  std::string result;
+
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records[i].direction == direction) {
+      result += records[i].data;
+    }
+  }
+  return result;
+}
+
+TEST(boot) {
+  server.roster.push_back({ "BR 218", 3, 'S' });
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  CHECK(loopUntil(isDrivable, 5000));
+  server.send("M0AS3<;>F10");
+  loopFor(100);
+}
+
+TEST(roundTrip) {
+  std::string sent;                         // Lines WiThrottle sent according to capture
+  size_t start = 0;                         // Start of actual line sent
+  size_t end;                               // End of actual line sent
+
+  CHECK(dumpAndLoad(records));
+  CHECK(!records.empty());
+
+  // Everything sent has been captured as it has been received by the server
+  sent = join(records, CAPTURE_SENT);
+  for (size_t i = 0; i < server.lines.size() && CHECK(start < sent.size()); i++) {
+    end = sent.find("\r\n", start);
+    CHECK_EQUAL(server.lines[i], sent.substr(start, end - start));
+    start = end + 2;
+  }
+  CHECK(start == sent.size());
+
+  // Everything received has been captured, beginning with the greeting
+  CHECK(join(records, CAPTURE_RECEIVED).compare(0, 6, "VN2.0\n") == 0);
+  CHECK(join(records, CAPTURE_RECEIVED).find("M0AS3<;>F10\n") != std::string::npos);
+}
+
+TEST(replay) {
+  std::vector<fakeCaptureRecord> again;     // Records of capture dumped while replaying
+
+  // Server moved to replaying the capture drops the connection
+  replayed.replay = records;
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &replayed, 20);
+  server.connection.close();
+  CHECK(loopUntil(isDisconnected, 1000));
+  captureClear();
+
+  // Loco is acquired again by the answers in the capture only
+  CHECK(loopUntil(isDrivable, 5000));
+  CHECK(replayed.connections == 1);
+  CHECK(replayed.find("M0+S3<;>") >= 0);
+  loopFor(records.back().time - records.front().time + 100);
+
+  // Throttle received the same data as in the capture
+  CHECK(dumpAndLoad(again));
+  CHECK_EQUAL(join(records, CAPTURE_RECEIVED), join(again, CAPTURE_RECEIVED));
+  CHECK(throttle.loco[0].function[0].getState() == ON);
+}
+
+TEST(escaping) {
+  static const char data[] = "M0\"\\\r\n\x00\x01\x7f\xff";
+                                            // Bytes to be escaped
+  std::string longData(CAPTURE_DATA_MAX + 10, 'V');
+                                            // Data cut off when recorded
+  size_t start = hostSerialOutput().size(); // Serial output before dump
+
+  captureClear();
+  captureData(CAPTURE_RECEIVED, data, sizeof(data) - 1);
+  captureData(CAPTURE_SENT, longData.c_str(), longData.size());
+  CHECK(dumpAndLoad(records));
+  CHECK(hostSerialOutput().find(" < \"M0\\\"\\\\\\r\\n\\x00\\x01\\x7f\\xff\"", start) != std::string::npos);
+
+  CHECK(records.size() == 2);
+  CHECK(records[0].direction == CAPTURE_RECEIVED);
+  CHECK(records[0].data == std::string(data, sizeof(data) - 1));
+  CHECK(!records[0].isCut);
+  CHECK(records[1].direction == CAPTURE_SENT);
+  CHECK(records[1].data == longData.substr(0, CAPTURE_DATA_MAX));
+  CHECK(records[1].isCut);
+
+  // Malformed traces aren't loaded
+  CHECK(loadCapture("# WiThrottle capture v1\n100 < \"M0\\q\"\n", records) == false);
+  CHECK(loadCapture("100 ? \"M0\"\n", records) == false);
+  CHECK(loadCapture("100 > \"M0\n", records) == false);
+}
+
+int main() {
+  return hostTestMain();
+}
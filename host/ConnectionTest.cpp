@@ -0,0 +1,82 @@
+/*
+ * Host test of connecting to WiThrottle servers
+ *
+ * Connecting races the known WiThrottle servers and waits for the
+ * discovery by mDNS without blocking a loop pass, both while booting
+ * and while restoring a lost connection.
+ */
+
+#include "Sketch.h"
+#include <ESPmDNS.h>
+
+
+static FakeServer primary;                  // WiThrottle server found first
+static FakeServer standby;                  // WiThrottle server the first one moves to
+
+// Longest loop pass allowed, i. e. waiting idle between loop passes; unit: us
+#define PASS_MAX ((IDLE_LATENCY + 5) * (uint64_t)1000)
+
+static bool isReady() {
+  return throttle.getConnectionState() == CONN_READY;
+}
+
+static bool isLost() {
+  return throttle.getConnectionState() != CONN_READY;
+}
+
+static bool isDiscovering() {
+  return throttle.getConnectionState() == CONN_DISCOVERING;
+}
+
+TEST(bootByDiscovery) {
+  hostWiFiSetup(true, 800);
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &primary, 300);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090, 1500);
+
+  // No WiThrottle server is cached or configured, so the race is lost at once and discovery is waited for
+  setup();
+  CHECK(loopUntil(isDiscovering, 100));
+  CHECK(loopUntil(isReady, 3000));
+  CHECK(primary.connections == 1);
+  CHECK(longestPass <= PASS_MAX);
+
+  // Throttle announces itself by a host name of its own, not by the name of the service it queries
+  CHECK(MDNS.hostname == "esp32-withrottle-0a0b0c");
+}
+
+TEST(serverMoved) {
+  uint64_t lostTime;                        // Virtual time WiThrottle server has gone; unit: us
+
+  loopFor(1000);
+  longestPass = 0;
+
+  // WiThrottle server moves: the cached one refuses connections only after a while, the new one is announced
+  hostListen(IPAddress(192, 168, 1, 10), 12090, NULL, 2000);
+  hostListen(IPAddress(192, 168, 1, 11), 12090, &standby, 50);
+  hostAnnounce(IPAddress(192, 168, 1, 11), 12090, 1000);
+  primary.connection.close();
+  lostTime = hostTime();
+
+  CHECK(loopUntil(isLost, 100));
+  CHECK(loopUntil(isReady, 60000));
+  CHECK(standby.connections == 1);
+  CHECK(longestPass <= PASS_MAX);
+  printf("Restored after %lu ms.\n", (unsigned long)((hostTime() - lostTime) / 1000));
+}
+
+TEST(noServer) {
+  hostWithdraw();
+  hostListen(IPAddress(192, 168, 1, 11), 12090, NULL, 10);
+  standby.connection.close();
+  longestPass = 0;
+
+  // Without a WiThrottle server WiThrottle keeps trying, but the handset stays operable
+  CHECK(loopUntil(isLost, 100));
+  loopFor(30000);
+  CHECK(throttle.getConnectionState() != CONN_READY);
+  CHECK(longestPass <= PASS_MAX);
+}
+
+int main() {
+  return hostTestMain();
+}
@@ -0,0 +1,100 @@
+/*
+ * Host test of the serial console
+ */
+
+#include "Sketch.h"
+
+
+static FakeServer server;                   // WiThrottle server
+
+static bool isDrivable() {
+  return throttle.getConnectionState() == CONN_READY && throttle.loco[0].getAcquired();
+}
+
+TEST(boot) {
+  server.roster.push_back({ "BR 218", 3, 'S' });
+  server.roster.push_back({ "V 200", 1234, 'L' });
+  server.roster.push_back({ "BR 80", 80, 'L' });
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  CHECK(loopUntil(isDrivable, 5000));
+  CHECK(throttle.loco[0].getAddress() == 3);
+}
+
+TEST(acquireByAddress) {
+  size_t lines = server.lines.size();       // Lines received before switching
+  long dispatched;                          // Line dispatching active loco
+  long acquired;                            // Line acquiring loco typed
+
+  // Loco typed replaces the active one the same way as selecting it from the menu
+  hostSerialInput("1234\n");
+  loopPass();
+  dispatched = server.find("M0-S3<;>r", lines);
+  acquired = server.find("M0+L1234<;>", lines);
+  CHECK(dispatched >= 0);
+  CHECK(acquired > dispatched);
+  CHECK(throttle.loco[0].getAcquiring());
+
+  // DCC address is kept for next power-on only once WiThrottle server has confirmed it
+  CHECK(throttle.getLastAddress() == 3);
+  CHECK(loopUntil(isDrivable, 1000));
+  CHECK(throttle.loco[0].getAddress() == 1234);
+  CHECK(throttle.getLastAddress() == 1234);
+}
+
+TEST(acquireById) {
+  size_t lines = server.lines.size();       // Lines received before switching
+
+  hostSerialInput("loco BR 218\n");
+  loopPass();
+  CHECK(server.find("M0-L1234<;>r", lines) >= 0);
+  CHECK(throttle.getLastAddress() == 1234);
+  CHECK(loopUntil(isDrivable, 1000));
+  CHECK(throttle.loco[0].getAddress() == 3);
+  CHECK(throttle.getLastAddress() == 3);
+}
+
+TEST(longAddress) {
+  size_t lines = server.lines.size();       // Lines received before switching
+
+  // Roster entry is selected with its address type, also for a long DCC address below 128
+  hostSerialInput("loco BR 80\n");
+  loopPass();
+  CHECK(server.find("M0+L80<;>EBR 80", lines) >= 0);
+  CHECK(loopUntil(isDrivable, 1000));
+  CHECK(throttle.loco[0].getAddressType() == 'L');
+  CHECK(throttle.getLastAddress() == 80);
+}
+
+TEST(unknownId) {
+  size_t lines = server.lines.size();       // Lines received before typing
+
+  // Loco not in roster is neither acquired nor kept
+  hostSerialInput("loco Unknown\n");
+  loopFor(100);
+  CHECK(server.find("M0-", lines) < 0);
+  CHECK(throttle.loco[0].getAddress() == 80);
+  CHECK(throttle.getLastAddress() == 80);
+}
+
+TEST(stats) {
+  size_t output = hostSerialOutput().size();
+                                            // Serial output before command
+
+  // Statistics are printed without logging, as in the default build
+  hostSerialInput("stats\n");
+  loopPass();
+  CHECK(LOG_LEVEL == LOG_LEVEL_NONE);
+  CHECK(hostSerialOutput().find("Sent ", output) != std::string::npos);
+  CHECK(hostSerialOutput().find("Reconnected 0 times", output) != std::string::npos);
+  CHECK(hostSerialOutput().find("Duty cycle", output) != std::string::npos);
+  CHECK(hostSerialOutput().find("Acquisition took", output) != std::string::npos);
+}
+
+int main() {
+  return hostTestMain();
+}
@@ -0,0 +1,240 @@
+/*
+ * Definition of a fake WiThrottle server for host tests
+ */
+
+#include "FakeServer.h"
+#include <stdlib.h>
+
+
+// Read data between quotes of a record at <position>, undoing the C escapes; false if malformed
+static bool unescape(const std::string &text, size_t &position, std::string &data) {
+  char c;                                   // Actual character
+  char* end;                                // End of hex digits
+
+  for (; position < text.size(); position++) {
+    c = text[position];
+    if (c == '"') {
+      position++;
+      return true;
+    }
+    if (c != '\\') {
+      data += c;
+      continue;
+    }
+
+    // I want to check which byte has been escaped
+    if (++position >= text.size()) {
+      return false;
+    }
+    c = text[position];
+    if (c == 'r') {
+      data += '\r';
+    }
+    else if (c == 'n') {
+      data += '\n';
+    }
+    else if (c == '\\' || c == '"') {
+      data += c;
+    }
+    else if (c == 'x' && position + 2 < text.size()) {
+      data += (char)strtoul(text.substr(position + 1, 2).c_str(), &end, 16);
+      if (*end != '\0') {
+        return false;
+      }
+      position += 2;
+    }
+    else {
+      return false;
+    }
+  }
+  return false;
+}
+
+// Read text trace written by captureDump()
+bool loadCapture(const std::string &dump, std::vector<fakeCaptureRecord> &records) {
+  size_t start = 0;                         // Start of actual line
+  size_t end;                               // End of actual line
+  size_t position;                          // Position in actual line
+  std::string text;                         // Actual line without line end
+  fakeCaptureRecord record;                 // Record read from actual line
+  char* number;                             // End of timestamp
+
+  records.clear();
+  while (start < dump.size()) {
+    end = dump.find('\n', start);
+    if (end == std::string::npos) {
+      end = dump.size();
+    }
+    text = dump.substr(start, end - start);
+    start = end + 1;
+    if (!text.empty() && text[text.size() - 1] == '\r') {
+      text.erase(text.size() - 1);
+    }
+
+    // I want to check if line is a comment
+    if (text.empty() || text[0] == '#') {
+      continue;
+    }
+
+    record.time = strtoul(text.c_str(), &number, 10);
+    position = number - text.c_str();
+    if (position == 0 || (text.compare(position, 4, " > \"") != 0 && text.compare(position, 4, " < \"") != 0)) {
+      return false;
+    }
+    record.direction = text[position + 1];
+    record.data.clear();
+    position += 4;
+    if (!unescape(text, position, record.data)) {
+      return false;
+    }
+    record.isCut = text.compare(position, std::string::npos, " # cut") == 0;
+    if (!record.isCut && position != text.size()) {
+      return false;
+    }
+    records.push_back(record);
+  }
+  return true;
+}
+
+
+// Connection has been established
+void FakeServer::accepted(HostConnection connection) {
+  std::string list;                         // Roster list
+  unsigned long start = 0;                  // Time of first data received in capture replayed; unit: ms
+
+  this->connection = connection;
+  connections++;
+  line.clear();
+
+  // Data received in capture arrives at the times recorded, relative to the first of it
+  replaying = false;
+  for (size_t i = 0; i < replay.size(); i++) {
+    if (replay[i].direction == CAPTURE_RECEIVED) {
+      if (!replaying) {
+        start = replay[i].time;
+        replaying = true;
+      }
+      connection.send(replay[i].data, latency + replay[i].time - start);
+    }
+  }
+  if (replaying) {
+    return;
+  }
+
+  list = "RL" + std::to_string(roster.size());
+  for (size_t i = 0; i < roster.size(); i++) {
+    list += "]\\[" + roster[i].id + "}|{" + std::to_string(roster[i].address) + "}|{" + roster[i].addressType;
+  }
+
+  send("VN2.0");
+  send(list);
+  send("PPA1");
+  send("*10");
+}
+
+// WiThrottle wrote data
+void FakeServer::received(HostConnection connection, const char* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] == '\r' || data[i] == '\n') {
+      if (!line.empty()) {
+        lines.push_back(line);
+        times.push_back(hostTime());
+        if (!replaying) {
+          process(line);
+        }
+      }
+      line.clear();
+    }
+    else {
+      line += data[i];
+    }
+  }
+}
+
+// WiThrottle closed connection
+void FakeServer::closed(HostConnection connection) {
+  if (connection.fd == this->connection.fd) {
+    this->connection.fd = -1;
+  }
+}
+
+// Send a line to WiThrottle
+void FakeServer::send(const std::string &cmd) {
+  connection.send(cmd + "\n", latency);
+}
+
+// Answer a line sent by WiThrottle
+void FakeServer::process(const std::string &cmd) {
+  size_t separator = cmd.find("<;>");       // End of loco key
+  std::string key;                          // Loco key, e. g. S3
+  std::string action;                       // Text behind loco key
+  bool known = false;                       // Roster knows ID acquired
+
+  if (cmd == "Q") {
+    connection.close(latency);
+    return;
+  }
+  if (cmd.compare(0, 2, "M0") != 0 || separator == std::string::npos || cmd.size() < 4) {
+    return;
+  }
+  key = cmd.substr(3, separator - 3);
+  action = cmd.substr(separator + 3);
+
+  switch (cmd[2]) {
+    case '+':
+      // Acquisition by roster ID only succeeds if the roster knows it, as in JMRI
+      if (action.compare(0, 1, "E") == 0) {
+        for (size_t i = 0; i < roster.size(); i++) {
+          known = known || roster[i].id == action.substr(1);
+        }
+        if (!known) {
+          send("HMUnknown loco " + action.substr(1));
+          return;
+        }
+      }
+      send("M0+" + key + "<;>");
+      send("M0L" + key + "<;>]\\[Headlight]\\[Bell]\\[Horn");
+      send("M0A" + key + "<;>F00");
+      send("M0A" + key + "<;>V0");
+      send("M0A" + key + "<;>R1");
+      send("M0A" + key + "<;>s1");
+      break;
+
+    case '-':
+      send("M0-" + key + "<;>");
+      break;
+
+    case 'A':
+      // Direction, notch and functions are confirmed as they are set
+      if (action.compare(0, 1, "R") == 0 || action.compare(0, 1, "V") == 0) {
+        send("M0A" + key + "<;>" + action);
+      }
+      else if (action == "X") {
+        send("M0A" + key + "<;>V-1");
+      }
+      else if (action.compare(0, 1, "F") == 0 && action.size() > 2) {
+        send("M0A" + key + "<;>F" + action.substr(1));
+      }
+      break;
+  }
+}
+
+// Number of lines received starting with <prefix>
+size_t FakeServer::count(const std::string &prefix) {
+  size_t result = 0;
+
+  for (size_t i = 0; i < lines.size(); i++) {
+    result += lines[i].compare(0, prefix.size(), prefix) == 0;
+  }
+  return result;
+}
+
+// Index of first line received starting with <prefix> at or after <from>
+long FakeServer::find(const std::string &prefix, size_t from) {
+  for (size_t i = from; i < lines.size(); i++) {
+    if (lines[i].compare(0, prefix.size(), prefix) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
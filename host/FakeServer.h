@@ -0,0 +1,69 @@
+/*
+ * Declaration of a fake WiThrottle server for host tests
+ *
+ * The server greets like JMRI, sends its roster, answers acquisitions
+ * with labels and state of the loco and echoes direction, notch and
+ * functions. Every line WiThrottle sends is recorded, so tests can
+ * check the protocol.
+ *
+ * loadCapture() reads a text trace written by captureDump() (see
+ * Capture.h). Given its records to replay, the server sends the data
+ * received in the capture at the times recorded instead of answering,
+ * so traffic captured on the handset can be reproduced on the host.
+ */
+
+#ifndef _HOST_FAKE_SERVER_H_
+#define _HOST_FAKE_SERVER_H_
+
+#include "Capture.h"
+#include "Host.h"
+#include <string>
+#include <vector>
+
+
+// Entry of roster
+typedef struct {
+  std::string id;                           // ID of loco
+  unsigned int address;                     // DCC address
+  char addressType;                         // Type of DCC address: S (short) or L (long)
+} fakeRosterEntry;
+
+// Record of a protocol capture
+typedef struct {
+  unsigned long time;                       // Timestamp; unit: ms
+  char direction;                           // CAPTURE_SENT or CAPTURE_RECEIVED
+  std::string data;                         // Bytes written or read
+  bool isCut;                               // Data has been cut off at CAPTURE_DATA_MAX
+} fakeCaptureRecord;
+
+bool loadCapture(const std::string &dump, std::vector<fakeCaptureRecord> &records);
+                                            // Read text trace written by captureDump(); false if malformed
+
+class FakeServer : public HostPeer {
+  private:
+    std::string line;                       // Line being received from WiThrottle
+    bool replaying = false;                 // Connection replays a capture instead of answering
+    void process(const std::string &cmd);   // Answer a line sent by WiThrottle
+
+  public:
+    std::vector<fakeRosterEntry> roster;    // Roster sent on greeting
+    std::vector<fakeCaptureRecord> replay;  // Capture replayed on next connection; empty answers like JMRI
+    std::vector<std::string> lines;         // Lines received from WiThrottle
+    std::vector<uint64_t> times;            // Virtual time each line has been received; unit: us
+    HostConnection connection = { -1 };     // Connection to WiThrottle; fd -1 if none
+    unsigned long latency = 5;              // Time until an answer arrives; unit: ms
+    unsigned int connections = 0;           // Connections accepted
+
+    // WiThrottle server
+    void accepted(HostConnection connection);
+    void received(HostConnection connection, const char* data, size_t length);
+    void closed(HostConnection connection);
+    void send(const std::string &cmd);      // Send a line to WiThrottle
+
+    // Recorded lines
+    size_t count(const std::string &prefix);
+                                            // Number of lines received starting with <prefix>
+    long find(const std::string &prefix, size_t from = 0);
+                                            // Index of first line received starting with <prefix> at or after <from>; -1 if none
+};
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Instantiation of the handset in all hardware layouts
+ *
+ * This translation unit includes every hardware policy and is linked
+ * with the sketch, which includes the policies of its own layout again.
+ * So each variant also proves that the policy headers only contain
+ * inline definitions, i. e. may be included by several sources.
+ */
+
+#include "Handset.h"
+#include "EncoderSpeedInput.h"
+#include "GpioButtons.h"
+#include "NoDisplay.h"
+#include "OledDisplay.h"
+#include "Pcf8574Buttons.h"
+#include "PotSpeedInput.h"
+
+
+template class Handset<NoDisplay, PotSpeedInput, GpioButtons>;
+template class Handset<NoDisplay, PotSpeedInput, Pcf8574Buttons>;
+template class Handset<NoDisplay, EncoderSpeedInput, GpioButtons>;
+template class Handset<NoDisplay, EncoderSpeedInput, Pcf8574Buttons>;
+template class Handset<OledDisplay, PotSpeedInput, GpioButtons>;
+template class Handset<OledDisplay, PotSpeedInput, Pcf8574Buttons>;
+template class Handset<OledDisplay, EncoderSpeedInput, GpioButtons>;
+template class Handset<OledDisplay, EncoderSpeedInput, Pcf8574Buttons>;
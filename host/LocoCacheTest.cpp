@@ -0,0 +1,162 @@
+/*
+ * Host test of the cache of locos driven recently
+ *
+ * The cache is tested against the emulated EEPROM, first on its own and
+ * then as the handset uses it when selecting and acquiring a loco.
+ */
+
+#include "Sketch.h"
+#include "LocoCache.h"
+
+
+static FakeServer server;                   // WiThrottle server
+
+static bool isDrivable() {
+  return throttle.getConnectionState() == CONN_READY && throttle.loco[0].getAcquired();
+}
+
+// Store loco with <labelCount> labels in <labels>, each terminated by '\0'
+static void store(char addressType, unsigned int address, const char* id, const char* labels, byte labelCount) {
+  locoCacheEntry entry;                     // Loco to be cached
+  const char* label = labels;               // Actual label
+
+  memset(&entry, 0, sizeof(entry));
+  entry.address = address;
+  entry.addressType = addressType;
+  strlcpy(entry.id, id, sizeof(entry.id));
+  for (byte i = 0; i < labelCount; i++) {
+    label += strlen(label) + 1;
+  }
+  memcpy(entry.labels, labels, label - labels);
+  entry.labelCount = labelCount;
+
+  locoCacheStore(entry);
+}
+
+// ID of cached loco; "" if not cached
+static std::string cachedId(char addressType, unsigned int address) {
+  locoCacheEntry entry;                     // Cached loco
+
+  return locoCacheFind(addressType, address, entry) ? entry.id : "";
+}
+
+TEST(storeAndFind) {
+  locoCacheEntry entry;                     // Cached loco
+
+  // Erased flash holds no loco
+  CHECK(!locoCacheFind('S', 3, entry));
+
+  store('S', 3, "BR 218", "Light\0Bell", 2);
+  CHECK(locoCacheFind('S', 3, entry));
+  CHECK(strcmp(entry.id, "BR 218") == 0);
+  CHECK(entry.labelCount == 2);
+  CHECK(strcmp(entry.labels + 6, "Bell") == 0);
+}
+
+TEST(shortAndLong) {
+  // Short address 3 and long address 3 are different locos
+  CHECK(cachedId('L', 3) == "");
+  store('L', 3, "V 200", "Horn", 1);
+  CHECK(cachedId('S', 3) == "BR 218");
+  CHECK(cachedId('L', 3) == "V 200");
+}
+
+TEST(unchangedStore) {
+  unsigned long commits = EEPROM.commits;   // Flash writes before
+
+  // Loco in front and unchanged isn't written again
+  store('L', 3, "V 200", "Horn", 1);
+  CHECK(EEPROM.commits == commits);
+
+  // Loco moved to the front is
+  store('S', 3, "BR 218", "Light\0Bell", 2);
+  CHECK(EEPROM.commits == commits + 1);
+}
+
+TEST(eviction) {
+  // Least recently used loco is dropped
+  store('S', 10, "# 10", "", 0);
+  store('S', 11, "# 11", "", 0);
+  store('S', 12, "# 12", "", 0);
+  CHECK(cachedId('S', 3) == "BR 218");
+  CHECK(cachedId('S', 10) == "# 10");
+  CHECK(cachedId('L', 3) == "");
+}
+
+TEST(renamedId) {
+  // Loco cached as "BR 218" has been renamed in the roster since
+  server.roster.push_back({ "BR 218 DB", 3, 'S' });
+  server.roster.push_back({ "BR 80", 80, 'L' });
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  CHECK(throttle.loco[0].function[0].getLabel() == "Light");
+
+  // Loco selected by DCC address is acquired by DCC address, not by the cached ID
+  CHECK(loopUntil(isDrivable, 5000));
+  CHECK(server.find("M0+S3<;>S3") >= 0);
+  CHECK(server.find("M0+S3<;>E") < 0);
+
+  // Labels sent by WiThrottle server replace the cached ones, the cached ID is kept
+  loopFor(100);
+  CHECK(throttle.loco[0].function[0].getLabel() == "Headlight");
+  CHECK(cachedId('S', 3) == "BR 218");
+}
+
+TEST(selectShowsCachedLabels) {
+  // Labels are shown as soon as the loco is selected, before WiThrottle server confirms
+  throttle.loco[0].dispatch();
+  CHECK(throttle.loco[0].function[0].getLabel() != "Headlight");
+  throttle.loco[0].select(3);
+  CHECK(throttle.loco[0].function[0].getLabel() == "Headlight");
+  CHECK(throttle.loco[0].function[2].getLabel() == "Horn");
+}
+
+TEST(longAddressBelow128) {
+  // Loco of roster with long DCC address 80 is cached as long address 80
+  throttle.loco[0].select(String("BR 80"), throttle.roster);
+  throttle.loco[0].acquire();
+  CHECK(loopUntil(isDrivable, 1000));
+  loopFor(100);
+  CHECK(cachedId('L', 80) == "BR 80");
+  CHECK(cachedId('S', 80) == "");
+
+  // Address type is kept for next power-on as well
+  CHECK(throttle.getLastAddress() == 80);
+  CHECK(throttle.getLastAddressType() == 'L');
+}
+
+TEST(acquireRecent) {
+  size_t lines = server.lines.size();       // Lines received before switching
+  size_t output = hostSerialOutput().size();
+                                            // Serial output before listing
+
+  // Locos are listed numbered, most recently used first
+  hostSerialInput("recent\n");
+  loopPass();
+  CHECK(hostSerialOutput().find("1:    80 L BR 80", output) != std::string::npos);
+  CHECK(hostSerialOutput().find("2:     3 S BR 218", output) != std::string::npos);
+
+  // Number of the list acquires the loco by its address type and DCC address
+  hostSerialInput("recent 2\n");
+  loopPass();
+  CHECK(server.find("M0-L80<;>r", lines) >= 0);
+  CHECK(server.find("M0+S3<;>S3", lines) >= 0);
+  CHECK(loopUntil(isDrivable, 1000));
+  CHECK(throttle.loco[0].getAddress() == 3);
+  CHECK(throttle.getLastAddressType() == 'S');
+
+  // Numbers not in the list are refused
+  output = hostSerialOutput().size();
+  hostSerialInput("recent 9\n");
+  loopPass();
+  CHECK(hostSerialOutput().find("not a number", output) != std::string::npos);
+  CHECK(throttle.loco[0].getAddress() == 3);
+}
+
+int main() {
+  return hostTestMain();
+}
@@ -0,0 +1,90 @@
+/*
+ * Host test of the menu
+ *
+ * Built with display and rotary encoder, the layout the menu is
+ * available in.
+ */
+
+#include "Sketch.h"
+
+
+static FakeServer server;                   // WiThrottle server
+
+static bool isDrivable() {
+  return throttle.getConnectionState() == CONN_READY && throttle.loco[0].getAcquired();
+}
+
+// Move cursor of menu to row with <text>
+static bool moveTo(const char* text) {
+  char row[MENU_TEXT_SIZE];                 // Text of actual row
+
+  for (unsigned int i = 0; i < handset.menu.size(); i++) {
+    handset.menu.getRow(i, row, sizeof(row));
+    if (strcmp(row, text) == 0) {
+      handset.menu.move(i - handset.menu.getCursor());
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST(boot) {
+  server.roster.push_back({ "BR 218", 3, 'S' });
+  server.roster.push_back({ "V 200", 1234, 'L' });
+  server.roster.push_back({ "BR 80", 80, 'L' });
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  CHECK(loopUntil(isDrivable, 5000));
+  CHECK(throttle.loco[0].getAddress() == 3);
+}
+
+TEST(switchLoco) {
+  size_t lines = server.lines.size();       // Lines received before switching
+  long dispatched;                          // Line dispatching active loco
+  long acquired;                            // Line acquiring loco selected
+  uint64_t startTime;                       // Virtual time loco has been selected; unit: us
+
+  // Loco selected from roster replaces the active one
+  handset.menu.open(MENU_LOCO);
+  CHECK(moveTo("V 200"));
+  startTime = hostTime();
+  handset.menu.select();
+  loopPass();
+
+  // Both are sent in the same loop pass without waiting for WiThrottle server
+  dispatched = server.find("M0-S3<;>r", lines);
+  acquired = server.find("M0+L1234<;>EV 200", lines);
+  CHECK(dispatched >= 0);
+  CHECK(acquired > dispatched);
+  CHECK(hostTime() - startTime < JMRI_DELAY * (uint64_t)1000);
+  CHECK(throttle.loco[0].getAcquiring());
+
+  // DCC address is kept for next power-on only once WiThrottle server has confirmed it
+  CHECK(throttle.getLastAddress() == 3);
+  CHECK(loopUntil(isDrivable, 1000));
+  CHECK(throttle.loco[0].getAddress() == 1234);
+  CHECK(throttle.getLastAddress() == 1234);
+}
+
+TEST(longAddress) {
+  size_t lines = server.lines.size();       // Lines received before switching
+
+  // Loco with a long DCC address below 128 is acquired with the address type of the roster
+  handset.menu.open(MENU_LOCO);
+  CHECK(moveTo("BR 80"));
+  handset.menu.select();
+  loopPass();
+  CHECK(server.find("M0+L80<;>EBR 80", lines) >= 0);
+  CHECK(throttle.loco[0].getAddressType() == 'L');
+
+  CHECK(loopUntil(isDrivable, 1000));
+  CHECK(throttle.loco[0].getAddress() == 80);
+}
+
+int main() {
+  return hostTestMain();
+}
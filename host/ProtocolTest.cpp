@@ -0,0 +1,73 @@
+/*
+ * Host test of the reports WiThrottle server sends about a loco
+ */
+
+#include "Sketch.h"
+
+
+static FakeServer server;                   // WiThrottle server
+
+static bool isDrivable() {
+  return throttle.getConnectionState() == CONN_READY && throttle.loco[0].getAcquired();
+}
+
+TEST(boot) {
+  server.roster.push_back({ "BR 218", 3, 'S' });
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  CHECK(loopUntil(isDrivable, 5000));
+  loopFor(100);
+  CHECK(throttle.loco[0].function[0].getState() == OFF);
+}
+
+TEST(validReports) {
+  server.send("M0AS3<;>R0");
+  server.send("M0AS3<;>F10");
+  loopFor(100);
+
+  CHECK(throttle.loco[0].getDirection() == REV);
+  CHECK(throttle.loco[0].function[0].getState() == ON);
+}
+
+TEST(invalidReports) {
+  size_t lines = server.lines.size();       // Lines received before reports
+
+  // Values out of range are ignored instead of being used as index
+  server.send("M0AS3<;>R7");
+  server.send("M0AS3<;>F90");
+  loopFor(100);
+
+  // Direction switch still matches, so direction isn't sent again
+  CHECK(server.find("M0AS3<;>R", lines) < 0);
+  CHECK(throttle.loco[0].getDirection() == REV);
+  CHECK(throttle.loco[0].function[0].getState() == ON);
+}
+
+TEST(stopDropsPendingSpeed) {
+  size_t lines = server.lines.size();       // Lines received before emergency stop
+  long stop;                                // Line stopping the loco
+
+  // Speed is queued after the last flush, as sync() or setNotch() do while listening to WiThrottle server
+  throttle.loco[0].setNotch(40);
+
+  // Emergency stop button is pressed before the batch is written
+  hostSetPin(BTN_STOP, LOW);
+  hostSetPinAt(BTN_STOP, HIGH, hostTime() + 100000);
+  loopPass();
+  loopFor(100);
+
+  // Speed queued before doesn't follow the stop
+  stop = server.find("M0AS3<;>X", lines);
+  CHECK(stop >= 0);
+  CHECK(server.find("M0AS3<;>V40", lines) < 0);
+  CHECK(server.find("M0AS3<;>V", lines) < 0 || server.find("M0AS3<;>V", lines) > stop);
+  CHECK(throttle.loco[0].getNotch() <= 0);
+}
+
+int main() {
+  return hostTestMain();
+}
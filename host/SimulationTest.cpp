@@ -0,0 +1,175 @@
+/*
+ * Host simulation of an operating session
+ *
+ * The sketch runs on the virtual clock (see Clock.h): delay() and the
+ * idle waits between loop passes advance it at once, so hours of a
+ * session pass in seconds, and millis() and micros() wrap around about
+ * 65 s after start. The session is scripted by virtual time only, so
+ * two runs have to send the same commands at the same time, bit for
+ * bit.
+ */
+
+#include "Sketch.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+// Simulation
+#define SIM_SESSION_TIME  (2 * 3600000UL)   // Duration of operating session; unit: ms
+#define SIM_POT_PERIOD       60000          // Potentiometer is turned up and back down in; unit: ms
+#define SIM_POT_FAST          2000          // Potentiometer is turned up and back down in, so notch changes every block; unit: ms
+#define SIM_FCT_PERIOD      300000          // Function button # 1 is pressed every; unit: ms
+#define SIM_PASS_TIME         1000          // CPU time a loop pass takes while driving; unit: us
+#define SIM_WRAP     65536000ULL            // Virtual time millis() wraps around at; unit: us
+
+
+static FakeServer server;                   // WiThrottle server
+
+static bool isDrivable() {
+  return throttle.getConnectionState() == CONN_READY && throttle.loco[0].getAcquired();
+}
+
+// Boot WiThrottle and acquire loco 3
+static bool powerOn() {
+  server.roster.push_back({ "BR 218", 3, 'S' });
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  return loopUntil(isDrivable, 5000);
+}
+
+// Drive loco for <duration>: potentiometer is turned up and down in <period>, function button # 1 is pressed now and then; unit: ms
+static void drive(unsigned long duration, unsigned long period = SIM_POT_PERIOD) {
+  uint64_t startTime = hostTime();          // Start of driving; unit: us
+  uint64_t endTime = startTime + duration * (uint64_t)1000;
+                                            // End of driving; unit: us
+  unsigned long phase;                      // Time passed in potentiometer period; unit: ms
+
+  for (uint64_t time = startTime + SIM_FCT_PERIOD * (uint64_t)1000; time < endTime; time += SIM_FCT_PERIOD * (uint64_t)1000) {
+    hostSetPinAt(BTN_FCT_01, LOW, time);
+    hostSetPinAt(BTN_FCT_01, HIGH, time + 200000);
+  }
+
+  /*
+   * While the loco is driven, the handset doesn't wait idle between
+   * loop passes; the virtual clock would hardly advance, so each pass
+   * is taken to need SIM_PASS_TIME.
+   */
+  while (hostTime() < endTime) {
+    phase = (hostTime() - startTime) / 1000 % period;
+    hostSetAnalog(POT_SIG, (phase < period / 2 ? phase : period - phase) * 4095 / (period / 2));
+    loopPass();
+    virtualAdvance(SIM_PASS_TIME);
+  }
+}
+
+// Lines WiThrottle sent with their virtual time
+static std::string trace() {
+  std::string text;                         // Trace
+
+  for (size_t i = 0; i < server.lines.size(); i++) {
+    text += std::to_string(server.times[i]) + " " + server.lines[i] + "\n";
+  }
+  return text;
+}
+
+// Run session in a process of its own and get its trace
+static std::string traceOfSession(unsigned long duration) {
+  int fds[2];                               // Pipe from session to test
+  pid_t pid;                                // Process of session
+  std::string text;                         // Trace received
+  char buffer[4096];                        // Data read from pipe
+  ssize_t length;                           // Number of bytes read
+  int status;                               // Exit status of session
+
+  if (pipe(fds) != 0 || (pid = fork()) < 0) {
+    return "";
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+    if (powerOn()) {
+      drive(duration);
+      text = trace();
+      for (size_t written = 0; written < text.size(); written += length) {
+        if ((length = write(fds[1], text.data() + written, text.size() - written)) <= 0) {
+          break;
+        }
+      }
+    }
+    close(fds[1]);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  while ((length = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    text.append(buffer, length);
+  }
+  close(fds[0]);
+  waitpid(pid, &status, 0);
+
+  return text;
+}
+
+TEST(reproducible) {
+  // Sessions run in processes of their own, so both start from power-on
+  std::string first = traceOfSession(SIM_POT_PERIOD * 2);
+  std::string second = traceOfSession(SIM_POT_PERIOD * 2);
+
+  CHECK(!first.empty());
+  CHECK(first == second);
+}
+
+TEST(boot) {
+  CHECK(powerOn());
+  CHECK(hostTime() < SIM_WRAP);
+}
+
+TEST(notchAcrossWrap) {
+  uint64_t lastTime = 0;                    // Virtual time notch has been sent last; unit: us
+  uint64_t minInterval = UINT64_MAX;        // Shortest time between notches sent; unit: us
+  size_t lines = server.lines.size();       // Lines received before driving
+
+  // Potentiometer keeps moving while millis() wraps around
+  drive(SIM_POT_PERIOD + 10000, SIM_POT_FAST);
+  CHECK(hostTime() > SIM_WRAP + 5000000);
+
+  // Notches sent while millis() wraps around
+  for (size_t i = lines; i < server.lines.size(); i++) {
+    if (server.lines[i].compare(0, 9, "M0AS3<;>V") == 0 && server.times[i] + 5000000 > SIM_WRAP && server.times[i] < SIM_WRAP + 5000000) {
+      if (lastTime != 0) {
+        minInterval = min(minInterval, server.times[i] - lastTime);
+      }
+      lastTime = server.times[i];
+    }
+  }
+
+  // Notch is sent every notchTimeout at most, also around the wraparound; commands are written at the end of a loop pass
+  CHECK(lastTime != 0);
+  CHECK(minInterval >= PotSpeedInput::notchTimeout * (uint64_t)1000 - SIM_PASS_TIME);
+}
+
+TEST(session) {
+  uint64_t startTime = hostTime();          // Start of session; unit: us
+  size_t lines = server.lines.size();       // Lines received before session
+  size_t notches = server.count("M0AS3<;>V");
+                                            // Notches sent before session
+  size_t functions = server.count("M0AS3<;>F");
+                                            // Function button # 1 pressed before session
+
+  drive(SIM_SESSION_TIME);
+  printf("%.1f h of session in virtual time, %zu lines sent.\n", (hostTime() - startTime) / 3600e6, server.lines.size() - lines);
+
+  // WiThrottle stays connected and keeps driving the loco
+  CHECK(isDrivable());
+  CHECK(server.connections == 1);
+  CHECK(server.count("M0AS3<;>V") - notches > SIM_SESSION_TIME / SIM_POT_PERIOD);
+  CHECK(server.count("M0AS3<;>F") - functions == SIM_SESSION_TIME / SIM_FCT_PERIOD - 1);
+}
+
+int main() {
+  return hostTestMain();
+}
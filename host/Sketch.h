@@ -0,0 +1,50 @@
+/*
+ * Sketch for host tests
+ *
+ * Includes ESP32_WiThrottle.ino in the hardware layout selected by the
+ * build, with helpers running its loop passes in virtual time. To be
+ * included by one source of a test only.
+ */
+
+#ifndef _HOST_SKETCH_H_
+#define _HOST_SKETCH_H_
+
+#include "../ESP32_WiThrottle.ino"
+#include "FakeServer.h"
+#include "Test.h"
+
+
+// Longest loop pass run by the helpers; unit: us
+static uint64_t longestPass = 0;
+
+// Run one loop pass
+static inline void loopPass() {
+  uint64_t startTime = hostTime();
+
+  loop();
+  longestPass = max(longestPass, hostTime() - startTime);
+}
+
+// Run loop passes for <duration> of virtual time; unit: ms
+static inline void loopFor(unsigned long duration) {
+  uint64_t endTime = hostTime() + duration * (uint64_t)1000;
+
+  while (hostTime() < endTime) {
+    loopPass();
+  }
+}
+
+// Run loop passes until <condition> holds, for <timeout> of virtual time at most; unit: ms
+template <typename Condition>
+static inline bool loopUntil(Condition condition, unsigned long timeout) {
+  uint64_t endTime = hostTime() + timeout * (uint64_t)1000;
+
+  while (!condition()) {
+    if (hostTime() >= endTime) {
+      return false;
+    }
+    loopPass();
+  }
+  return true;
+}
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Host test of the potentiometer speed input
+ *
+ * The potentiometer is sampled in blocks by ADC continuous mode; between
+ * the blocks the ADC is stopped, so light sleep isn't blocked.
+ */
+
+#include "Sketch.h"
+
+
+static FakeServer server;                   // WiThrottle server
+
+static bool isDrivable() {
+  return throttle.getConnectionState() == CONN_READY && throttle.loco[0].getAcquired();
+}
+
+TEST(boot) {
+  server.roster.push_back({ "BR 218", 3, 'S' });
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  CHECK(loopUntil(isDrivable, 5000));
+}
+
+TEST(notch) {
+  size_t notches = server.count("M0AS3<;>V");
+
+  // Potentiometer at half travel
+  hostSetAnalog(POT_SIG, 2048);
+  loopFor(1000);
+  CHECK(server.count("M0AS3<;>V") > notches);
+  CHECK(throttle.loco[0].getNotch() > 50 && throttle.loco[0].getNotch() < 76);
+
+  // Potentiometer back at 0
+  hostSetAnalog(POT_SIG, 0);
+  loopFor(1000);
+  CHECK(throttle.loco[0].getNotch() == 0);
+}
+
+TEST(blockNotWaitedFor) {
+  // Potentiometer is turned, so loop passes don't wait idle
+  hostSetAnalog(POT_SIG, 3000);
+  longestPass = 0;
+  loopFor(500);
+  CHECK(throttle.loco[0].getNotch() > 76);
+
+  // No loop pass waits for a block being converted
+  CHECK(longestPass < POT_BLOCK_TIME * (uint64_t)1000);
+}
+
+TEST(emergencyStop) {
+  size_t lines;                             // Lines received since emergency stop
+  unsigned int changes = 0;                 // Changes of direction LED
+  uint8_t ledPin = throttle.loco[0].getDirection() == FWD ? LED_FWD : LED_REV;
+                                            // Direction LED
+  int led = hostGetPin(ledPin);             // State of direction LED
+
+  // Emergency stop while potentiometer is off 0
+  hostSetPin(BTN_STOP, LOW);
+  hostSetPinAt(BTN_STOP, HIGH, hostTime() + 100000);
+  loopPass();
+  lines = server.lines.size();
+  CHECK(throttle.loco[0].getNotch() == ESTOP);
+
+  // Loop passes go on while direction LED blinks; the loco stays stopped
+  longestPass = 0;
+  for (unsigned int i = 0; i < 1000; i++) {
+    loopFor(1);
+    changes += hostGetPin(ledPin) != led;
+    led = hostGetPin(ledPin);
+  }
+  CHECK(changes >= 8);
+  CHECK(longestPass <= (IDLE_LATENCY + 5) * (uint64_t)1000);
+  CHECK(server.find("M0AS3<;>V", lines) < 0);
+  CHECK(throttle.loco[0].getNotch() == ESTOP);
+
+  // Potentiometer set to 0 releases the emergency stop
+  hostSetAnalog(POT_SIG, 0);
+  loopFor(1000);
+  CHECK(throttle.loco[0].getNotch() == 0);
+  CHECK(server.find("M0AS3<;>V0", lines) >= 0);
+}
+
+TEST(adcDuty) {
+  uint64_t startTime = hostTime();          // Start of measurement; unit: us
+  uint64_t runTime = hostAdcRunTime();      // ADC run time before measurement; unit: us
+  unsigned long starts = hostAdcStarts();   // ADC starts before measurement
+  double duty;                              // Share of time ADC has been running
+
+  loopFor(10000);
+  duty = double(hostAdcRunTime() - runTime) / (hostTime() - startTime);
+  printf("ADC running %.1f %% of the time, %lu blocks in 10 s.\n", duty * 100, hostAdcStarts() - starts);
+
+  // One block of POT_BLOCK_TIME every POT_SAMPLE_INTERVAL at most
+  CHECK(duty > 0);
+  CHECK(duty <= double(POT_BLOCK_TIME + 1) / POT_SAMPLE_INTERVAL);
+  CHECK(hostAdcStarts() - starts <= 10000 / POT_SAMPLE_INTERVAL + 1);
+}
+
+int main() {
+  return hostTestMain();
+}
@@ -0,0 +1,58 @@
+/*
+ * Definition of the host test runner
+ */
+
+#include "Test.h"
+#include "Host.h"
+#include <vector>
+
+
+typedef struct {
+  const char* name;                         // Name of test
+  void (*test)();                           // Test function
+} testEntry;
+
+static std::vector<testEntry> &tests() {
+  static std::vector<testEntry> registered; // Tests in order of definition
+  return registered;
+}
+
+static unsigned int failures = 0;           // Failed checks
+
+TestRegistration::TestRegistration(const char* name, void (*test)()) {
+  tests().push_back({ name, test });
+}
+
+bool testCheck(bool condition, const char* text, const char* file, int line) {
+  if (!condition) {
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+    failures++;
+  }
+  return condition;
+}
+
+bool testCheckEqual(const std::string &expected, const std::string &actual, const char* text, const char* file, int line) {
+  if (expected != actual) {
+    fprintf(stderr, "%s:%d: check failed: %s is '%s', expected '%s'\n", file, line, text, actual.c_str(), expected.c_str());
+    failures++;
+  }
+  return expected == actual;
+}
+
+int hostTestMain() {
+  unsigned int failuresBefore;              // Failed checks before actual test
+
+  for (size_t i = 0; i < tests().size(); i++) {
+    failuresBefore = failures;
+    try {
+      tests()[i].test();
+    }
+    catch (hostDeepSleep &) {
+      fprintf(stderr, "%s: WiThrottle went to sleep\n", tests()[i].name);
+      failures++;
+    }
+    printf("%s %s\n", failures == failuresBefore ? "PASS" : "FAIL", tests()[i].name);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
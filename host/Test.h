@@ -0,0 +1,37 @@
+/*
+ * Declaration of the host test runner
+ *
+ * Tests are registered by TEST() and run in the order they are defined
+ * by hostTestMain(). They share the emulated core, i. e. virtual clock,
+ * EEPROM and WiThrottle servers, so a test continues where the one
+ * before it left off.
+ */
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+#include <Arduino.h>
+#include <string>
+
+
+// Registration of a test
+class TestRegistration {
+  public:
+    TestRegistration(const char* name, void (*test)());
+};
+
+#define TEST(name) \
+  static void name(); \
+  static TestRegistration name##Registration(#name, name); \
+  static void name()
+
+// Checks; a failed check is reported and lets the test runner fail
+#define CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(expected, actual) testCheckEqual(std::string(expected), std::string(actual), #actual, __FILE__, __LINE__)
+
+bool testCheck(bool condition, const char* text, const char* file, int line);
+bool testCheckEqual(const std::string &expected, const std::string &actual, const char* text, const char* file, int line);
+
+// Run all tests; returns exit code
+int hostTestMain();
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Host test of the sketch in one hardware layout
+ *
+ * The layout is selected by the defines of CrossFunc.h, passed by the
+ * build. The handset boots, finds the WiThrottle server by mDNS,
+ * acquires the loco driven last and keeps the connection alive.
+ */
+
+#include "Sketch.h"
+
+
+static FakeServer server;                   // WiThrottle server
+
+TEST(boot) {
+  server.roster.push_back({ "BR 218", 3, 'S' });
+  hostWiFiSetup(true, 800);
+  hostListen(IPAddress(192, 168, 1, 10), 12090, &server, 20);
+  hostAnnounce(IPAddress(192, 168, 1, 10), 12090);
+
+  // Loco driven last is stored in EEPROM
+  EEPROM.data[1] = 0;
+  EEPROM.data[2] = 3;
+
+  setup();
+  loopFor(1000);
+
+  CHECK(throttle.getConnectionState() == CONN_READY);
+  CHECK(server.count("N") == 1);
+  CHECK(server.find("M0+S3<;>") >= 0);
+  CHECK(throttle.loco[0].getAcquired());
+  CHECK(throttle.roster.size() == 1);
+}
+
+TEST(heartbeat) {
+  size_t heartbeats = server.count("*");
+
+  // WiThrottle server expects a heartbeat every 10 s
+  loopFor(60000);
+  CHECK(server.count("*") - heartbeats >= 6);
+  CHECK(throttle.getConnectionState() == CONN_READY);
+}
+
+TEST(reconnect) {
+  server.connection.close();
+  loopFor(15000);
+
+  CHECK(server.connections == 2);
+  CHECK(throttle.getConnectionState() == CONN_READY);
+  CHECK(throttle.loco[0].getAcquired());
+}
+
+int main() {
+  return hostTestMain();
+}
@@ -0,0 +1,67 @@
+/*
+ * Declaration of the parts of Adafruit GFX used by the sketch, for host
+ * builds
+ *
+ * Pixels are set without rotation and text only moves the cursor, which
+ * is enough to check that frames change and are transferred.
+ */
+
+#ifndef _HOST_ADAFRUIT_GFX_H_
+#define _HOST_ADAFRUIT_GFX_H_
+
+#include <Arduino.h>
+
+
+class Adafruit_GFX : public Print {
+  protected:
+    int16_t width;                          // Width in pixels
+    int16_t height;                         // Height in pixels
+    int16_t cursorX = 0;                    // Text cursor
+    int16_t cursorY = 0;                    // Text cursor
+    uint16_t textColor = 1;                 // Text color
+
+  public:
+    Adafruit_GFX(int16_t width, int16_t height) : width(width), height(height) {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    void setRotation(uint8_t rotation) {}
+    void setTextSize(uint8_t size) {}
+    void setTextColor(uint16_t color) { textColor = color; }
+    void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+      for (int16_t i = x; i < x + w; i++) {
+        for (int16_t j = y; j < y + h; j++) {
+          drawPixel(i, j, color);
+        }
+      }
+    }
+
+    void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color) {
+      int16_t byteWidth = (w + 7) / 8;      // Bytes per row
+
+      for (int16_t j = 0; j < h; j++) {
+        for (int16_t i = 0; i < w; i++) {
+          if (bitmap[j * byteWidth + i / 8] & (0x80 >> (i & 7))) {
+            drawPixel(x + i, y + j, color);
+          }
+        }
+      }
+    }
+
+    size_t write(uint8_t c) {
+      // Each character of the default font is 6 x 8 pixels
+      if (c == '\n') {
+        cursorX = 0;
+        cursorY += 8;
+      }
+      else if (c != '\r') {
+        drawPixel(cursorX, cursorY, textColor);
+        cursorX += 6;
+      }
+      return 1;
+    }
+    using Print::write;
+};
+#endif
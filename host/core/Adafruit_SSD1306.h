@@ -0,0 +1,42 @@
+/*
+ * Declaration of the parts of Adafruit SSD1306 used by the sketch, for
+ * host builds
+ */
+
+#ifndef _HOST_ADAFRUIT_SSD1306_H_
+#define _HOST_ADAFRUIT_SSD1306_H_
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+#include <vector>
+
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_COLUMNADDR   0x21
+#define SSD1306_PAGEADDR     0x22
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+  private:
+    std::vector<uint8_t> buffer;            // Frame, one bit per pixel, 8 rows per byte
+
+  public:
+    Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire* wire, int8_t reset) : Adafruit_GFX(width, height), buffer(width * height / 8, 0) {}
+
+    bool begin(uint8_t vccState, uint8_t address) { return true; }
+    uint8_t* getBuffer() { return buffer.data(); }
+    void clearDisplay() { std::fill(buffer.begin(), buffer.end(), 0); }
+    void display() {}
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) {
+      if (x < 0 || y < 0 || x >= width || y >= height) {
+        return;
+      }
+      if (color) {
+        buffer[x + (y / 8) * width] |= 1 << (y & 7);
+      }
+      else {
+        buffer[x + (y / 8) * width] &= ~(1 << (y & 7));
+      }
+    }
+};
+#endif
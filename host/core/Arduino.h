@@ -0,0 +1,278 @@
+/*
+ * Declaration of the emulated Arduino core for host builds
+ *
+ * Only what the sketch uses of arduino-esp32 is emulated, and always
+ * deterministically: time is the virtual clock of Clock.h, tasks are
+ * coroutines switched at blocking calls, and pins, ADC, I2C devices,
+ * WiFi and WiThrottle servers are driven by the test through Host.h.
+ */
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <algorithm>
+#include <cmath>
+#include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using std::abs;
+using std::max;
+using std::min;
+
+
+// Types
+typedef uint8_t byte;
+typedef bool boolean;
+typedef int esp_err_t;
+
+// Constants
+#define HIGH                1
+#define LOW                 0
+#define INPUT            0x01
+#define OUTPUT           0x03
+#define INPUT_PULLUP     0x05
+#define RISING           0x01
+#define FALLING          0x02
+#define CHANGE           0x03
+#define DEC                10
+#define HEX                16
+#define ESP_OK              0
+#define ESP_FAIL           -1
+#define ESP_ERR_TIMEOUT 0x107
+
+// Attributes
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+// Bits
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Text
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+  size_t strlcpy(char* dst, const char* src, size_t size);
+#endif
+inline bool isDigit(int c) { return isdigit(c) != 0; }
+inline bool isAlphaNumeric(int c) { return isalnum(c) != 0; }
+inline bool isAlpha(int c) { return isalpha(c) != 0; }
+
+// Time; millis(), micros() and delay() are replaced by the virtual clock, 32 bit wide as on the handset
+uint32_t millis();
+uint32_t micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Math
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+// Pins
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint16_t analogRead(uint8_t pin);
+int8_t digitalPinToAnalogChannel(uint8_t pin);
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+
+// Sleep
+typedef int gpio_num_t;
+#define GPIO_NUM_15        15
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level);
+void esp_deep_sleep_start();                // Throws hostDeepSleep
+
+
+// FreeRTOS
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef int portMUX_TYPE;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define pdFAIL              0
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux) (void)(mux)
+#define portYIELD_FROM_ISR(woken) (void)(woken)
+
+BaseType_t xTaskCreate(void (*task)(void*), const char* name, uint32_t stackSize, void* parameter, unsigned int priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stackSize, void* parameter, unsigned int priority, TaskHandle_t* handle, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+
+
+// String
+class String {
+  private:
+    std::string text;                       // Characters
+
+  public:
+    // Constructors
+    String() {}
+    String(const char* text) : text(text != NULL ? text : "") {}
+    String(const std::string &text) : text(text) {}
+    explicit String(char c) : text(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(double value, unsigned int decimals = 2);
+    explicit String(float value, unsigned int decimals = 2) : String((double)value, decimals) {}
+
+    // Access
+    const char* c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.size(); }
+    char charAt(unsigned int index) const { return index < text.size() ? text[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    // Search
+    bool startsWith(const String &prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+    bool endsWith(const String &suffix) const;
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String &pattern, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+
+    // Modification
+    bool concat(const String &other) { text += other.text; return true; }
+    bool concat(const char* other) { text += other; return true; }
+    bool concat(char c) { text += c; return true; }
+    bool reserve(unsigned int size) { text.reserve(size); return true; }
+    void replace(const String &pattern, const String &replacement);
+    void toUpperCase();
+    void toLowerCase();
+    void trim();
+    String &operator+=(const String &other) { text += other.text; return *this; }
+    String &operator+=(const char* other) { text += other; return *this; }
+    String &operator+=(char c) { text += c; return *this; }
+
+    // Conversion
+    long toInt() const { return atol(text.c_str()); }
+    float toFloat() const { return atof(text.c_str()); }
+    double toDouble() const { return atof(text.c_str()); }
+    void toCharArray(char* buffer, unsigned int size) const;
+
+    // Comparison
+    bool equals(const String &other) const { return text == other.text; }
+    bool operator==(const String &other) const { return text == other.text; }
+    bool operator==(const char* other) const { return text == other; }
+    bool operator!=(const String &other) const { return text != other.text; }
+    bool operator!=(const char* other) const { return text != other; }
+    bool operator<(const String &other) const { return text < other.text; }
+};
+
+String operator+(const String &a, const String &b);
+String operator+(const String &a, const char* b);
+String operator+(const char* a, const String &b);
+String operator+(const String &a, char b);
+String operator+(char a, const String &b);
+String operator+(const String &a, int b);
+String operator+(const String &a, unsigned int b);
+String operator+(const String &a, long b);
+String operator+(const String &a, unsigned long b);
+
+
+// Print
+class Print;
+
+class Printable {
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &out) const = 0;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t length);
+    size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t write(const char* data, size_t length) { return write((const uint8_t*)data, length); }
+    virtual void flush() {}
+
+    size_t print(const String &text) { return write(text.c_str()); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print(String(value, base)); }
+    size_t print(int value, int base = DEC) { return print(String(value, base)); }
+    size_t print(unsigned int value, int base = DEC) { return print(String(value, base)); }
+    size_t print(long value, int base = DEC) { return print(String(value, base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+    size_t print(const Printable &value) { return value.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value) { return print(value) + println(); }
+    template <typename T>
+    size_t println(const T &value, int format) { return print(value, format) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long timeout) {}
+};
+
+// Serial monitor; output and input are handled by Host.h
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud) {}
+    void end() {}
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* data, size_t length);
+    using Print::write;
+    void flush() {}
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+
+// ESP
+class EspClass {
+  public:
+    uint32_t getCycleCount();               // CPU cycles at 240 MHz, derived from the virtual clock
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getFreeHeap() { return 200000; }
+};
+
+extern EspClass ESP;
+#endif
@@ -0,0 +1,1347 @@
+/*
+ * Definition of the emulated Arduino core for host builds
+ */
+
+#include "Host.h"
+#include <ESPmDNS.h>
+#include <Wire.h>
+#include <driver/adc.h>
+#include <lwip/sockets.h>
+#include <deque>
+#include <map>
+#include <vector>
+#include <ucontext.h>
+
+// The core reads the virtual clock directly
+#include "Clock.h"
+#undef millis
+#undef micros
+#undef delay
+#undef socket
+#undef connect
+#undef select
+#undef getsockopt
+#undef recv
+#undef send
+#undef close
+#undef fcntl
+
+#ifndef VIRTUAL_TIME
+  #error "Host builds need the virtual clock, define VIRTUAL_TIME"
+#endif
+
+
+extern uint64_t virtualTime;                // Virtual time; unit: us
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+TwoWire Wire;
+EEPROMClass EEPROM;
+MDNSResponder MDNS;
+
+
+// Text
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+size_t strlcpy(char* dst, const char* src, size_t size) {
+  size_t length = strlen(src);
+
+  if (size > 0) {
+    size_t count = min(length, size - 1);
+    memcpy(dst, src, count);
+    dst[count] = '\0';
+  }
+  return length;
+}
+#endif
+
+// Format number in base
+static std::string formatNumber(unsigned long long value, bool negative, unsigned char base) {
+  char digits[72];
+  int position = sizeof(digits) - 1;
+
+  digits[position] = '\0';
+  do {
+    digits[--position] = "0123456789abcdefghijklmnopqrstuvwxyz"[value % base];
+    value /= base;
+  } while (value > 0);
+  if (negative) {
+    digits[--position] = '-';
+  }
+  return digits + position;
+}
+
+String::String(unsigned char value, unsigned char base) : text(formatNumber(value, false, base)) {}
+String::String(int value, unsigned char base) : text(base == 10 ? formatNumber(value < 0 ? -(long long)value : value, value < 0, 10) : formatNumber((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base) : text(formatNumber(value, false, base)) {}
+String::String(long value, unsigned char base) : text(base == 10 ? formatNumber(value < 0 ? -(long long)value : value, value < 0, 10) : formatNumber((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base) : text(formatNumber(value, false, base)) {}
+
+String::String(double value, unsigned int decimals) {
+  char buffer[64];
+
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  text = buffer;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return text.size() >= suffix.text.size() && text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t position = text.find(c, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::indexOf(const String &pattern, unsigned int from) const {
+  size_t position = text.find(pattern.text, from);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t position = text.rfind(c);
+  return position == std::string::npos ? -1 : (int)position;
+}
+
+String String::substring(unsigned int from) const {
+  return substring(from, text.size());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    std::swap(from, to);
+  }
+  if (from >= text.size()) {
+    return String();
+  }
+  return String(text.substr(from, min((size_t)to, text.size()) - from));
+}
+
+void String::replace(const String &pattern, const String &replacement) {
+  size_t position = 0;
+
+  if (pattern.text.empty()) {
+    return;
+  }
+  while ((position = text.find(pattern.text, position)) != std::string::npos) {
+    text.replace(position, pattern.text.size(), replacement.text);
+    position += replacement.text.size();
+  }
+}
+
+void String::toUpperCase() {
+  for (size_t i = 0; i < text.size(); i++) {
+    text[i] = toupper((unsigned char)text[i]);
+  }
+}
+
+void String::toLowerCase() {
+  for (size_t i = 0; i < text.size(); i++) {
+    text[i] = tolower((unsigned char)text[i]);
+  }
+}
+
+void String::trim() {
+  size_t first = text.find_first_not_of(" \t\r\n");
+  size_t last = text.find_last_not_of(" \t\r\n");
+
+  text = first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+}
+
+void String::toCharArray(char* buffer, unsigned int size) const {
+  if (size > 0) {
+    strlcpy(buffer, text.c_str(), size);
+  }
+}
+
+String operator+(const String &a, const String &b) { String sum(a); sum += b; return sum; }
+String operator+(const String &a, const char* b) { String sum(a); sum += b; return sum; }
+String operator+(const char* a, const String &b) { String sum(a); sum += b; return sum; }
+String operator+(const String &a, char b) { String sum(a); sum += b; return sum; }
+String operator+(char a, const String &b) { String sum(a); sum += b; return sum; }
+String operator+(const String &a, int b) { return a + String(b); }
+String operator+(const String &a, unsigned int b) { return a + String(b); }
+String operator+(const String &a, long b) { return a + String(b); }
+String operator+(const String &a, unsigned long b) { return a + String(b); }
+
+
+// Print
+
+size_t Print::write(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    write(data[i]);
+  }
+  return length;
+}
+
+size_t Print::printf(const char* format, ...) {
+  va_list args;
+  int length;
+  std::vector<char> buffer;
+
+  va_start(args, format);
+  length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  if (length <= 0) {
+    return 0;
+  }
+
+  buffer.resize(length + 1);
+  va_start(args, format);
+  vsnprintf(buffer.data(), buffer.size(), format, args);
+  va_end(args);
+
+  return write((const uint8_t*)buffer.data(), length);
+}
+
+
+// Serial monitor
+
+static std::string serialOutput;            // Written to serial monitor
+static std::deque<char> serialInput;        // Typed on serial monitor, not read yet
+static bool serialEcho = false;             // Serial output is written to stdout as well
+
+std::string &hostSerialOutput() {
+  return serialOutput;
+}
+
+void hostSerialEcho(bool echo) {
+  serialEcho = echo;
+}
+
+void hostSerialInput(const char* text) {
+  serialInput.insert(serialInput.end(), text, text + strlen(text));
+}
+
+int HardwareSerial::available() {
+  return serialInput.size();
+}
+
+int HardwareSerial::read() {
+  int c;
+
+  if (serialInput.empty()) {
+    return -1;
+  }
+  c = (unsigned char)serialInput.front();
+  serialInput.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek() {
+  return serialInput.empty() ? -1 : (unsigned char)serialInput.front();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+  serialOutput.append((const char*)data, length);
+  if (serialEcho) {
+    fwrite(data, 1, length, stdout);
+  }
+  return length;
+}
+
+
+// Time
+
+uint32_t millis() {
+  return virtualMillis();
+}
+
+uint32_t micros() {
+  return virtualMicros();
+}
+
+void delay(unsigned long ms) {
+  virtualDelay(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+  virtualAdvance(us);
+}
+
+void yield() {
+  hostUpdate();
+}
+
+uint64_t hostTime() {
+  return virtualTime;
+}
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)(virtualTime * 240);
+}
+
+// Advance virtual clock to <time> at most, applying events on the way
+static void advanceTo(uint64_t time) {
+  uint64_t next;
+
+  while (virtualTime < time) {
+    next = min(time, hostNextEvent());
+    if (next > virtualTime) {
+      virtualTime = next;
+    }
+    hostUpdate();
+  }
+}
+
+
+// Math
+
+static uint32_t randomState = 0x2545F491;   // State of xorshift generator
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) {
+    return -1;
+  }
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+uint32_t esp_random() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+long random(long howBig) {
+  return howBig > 0 ? esp_random() % howBig : 0;
+}
+
+long random(long howSmall, long howBig) {
+  return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+  randomState = seed != 0 ? seed : 0x2545F491;
+}
+
+
+// Pins
+
+#define HOST_PINS          40               // GPIOs of ESP32
+
+typedef struct {
+  int level;                                // Level driven by test or written by sketch
+  void (*isr)(void);                        // Interrupt service routine; NULL if none
+  int mode;                                 // Edges calling <isr>
+} hostPin;
+
+static hostPin pins[HOST_PINS];             // State of the pins
+static bool pinsReady = false;              // Pins have been initialized
+static std::multimap<uint64_t, std::pair<uint8_t, int> > pinEvents;
+                                            // Levels driven in the future by time
+
+static hostPin &pinAt(uint8_t pin) {
+  // Inputs are pulled up, so buttons are released
+  if (!pinsReady) {
+    for (unsigned int i = 0; i < HOST_PINS; i++) {
+      pins[i].level = HIGH;
+      pins[i].isr = NULL;
+      pins[i].mode = 0;
+    }
+    pinsReady = true;
+  }
+  return pins[pin % HOST_PINS];
+}
+
+void hostSetPin(uint8_t pin, int level) {
+  hostPin &p = pinAt(pin);
+
+  if (p.level == level) {
+    return;
+  }
+  p.level = level;
+  if (p.isr != NULL && (p.mode == CHANGE || (p.mode == FALLING && level == LOW) || (p.mode == RISING && level == HIGH))) {
+    p.isr();
+  }
+}
+
+void hostSetPinAt(uint8_t pin, int level, uint64_t time) {
+  pinEvents.insert(std::make_pair(time, std::make_pair(pin, level)));
+}
+
+int hostGetPin(uint8_t pin) {
+  return pinAt(pin).level;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  pinAt(pin);
+}
+
+int digitalRead(uint8_t pin) {
+  hostUpdate();
+  return pinAt(pin).level;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  pinAt(pin).level = value ? HIGH : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+  pinAt(pin).isr = isr;
+  pinAt(pin).mode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  pinAt(pin).isr = NULL;
+}
+
+void noInterrupts() {}
+void interrupts() {}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level) {
+  return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+  throw hostDeepSleep();
+}
+
+
+// ADC
+
+static uint16_t analogLevels[10] = { 0 };   // Level of ADC1 channels
+static uint32_t noiseState = 0x1234567;     // State of noise generator
+
+static struct {
+  bool initialized = false;                 // Driver has been initialized
+  bool running = false;                     // Conversions are running
+  uint32_t storeBytes = 0;                  // Size of DMA buffer
+  uint32_t blockBytes = 0;                  // Bytes per block handed out
+  uint32_t frequency = 0;                   // Conversions per second
+  uint8_t channel = 0;                      // Channel converted
+  uint64_t startTime = 0;                   // Virtual time conversions have been started; unit: us
+  uint64_t converted = 0;                   // Conversions since start
+  uint64_t pending = 0;                     // Conversions in DMA buffer
+  uint64_t runTime = 0;                     // Time conversions have been running before last start; unit: us
+  unsigned long starts = 0;                 // Number of starts
+} adc;
+
+int8_t digitalPinToAnalogChannel(uint8_t pin) {
+  static const int8_t channels[HOST_PINS] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  4,  5,  6,  7,  0,  1,  2,  3 };
+  return channels[pin % HOST_PINS];
+}
+
+void hostSetAnalog(uint8_t pin, uint16_t value) {
+  int8_t channel = digitalPinToAnalogChannel(pin);
+
+  if (channel >= 0) {
+    analogLevels[channel] = min(value, (uint16_t)4095);
+  }
+}
+
+uint16_t analogRead(uint8_t pin) {
+  int8_t channel = digitalPinToAnalogChannel(pin);
+
+  return channel >= 0 ? analogLevels[channel] : 0;
+}
+
+uint64_t hostAdcRunTime() {
+  return adc.runTime + (adc.running ? virtualTime - adc.startTime : 0);
+}
+
+unsigned long hostAdcStarts() {
+  return adc.starts;
+}
+
+// Take over conversions since last call into DMA buffer
+static void adcConvert() {
+  uint64_t converted;
+
+  if (!adc.running) {
+    return;
+  }
+  converted = (virtualTime - adc.startTime) * adc.frequency / 1000000;
+  adc.pending = min(adc.pending + converted - adc.converted, (uint64_t)adc.storeBytes / SOC_ADC_DIGI_RESULT_BYTES);
+  adc.converted = converted;
+}
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t* config) {
+  adc.initialized = true;
+  adc.storeBytes = config->max_store_buf_size;
+  adc.blockBytes = config->conv_num_each_intr;
+  adc.pending = 0;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize() {
+  adc_digi_stop();
+  adc.initialized = false;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t* config) {
+  adc.frequency = config->sample_freq_hz;
+  adc.channel = ((const adc_digi_pattern_config_t*)config->adc_pattern)->channel;
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_start() {
+  if (!adc.initialized) {
+    return ESP_FAIL;
+  }
+  if (!adc.running) {
+    adc.running = true;
+    adc.startTime = virtualTime;
+    adc.converted = 0;
+    adc.starts++;
+  }
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_stop() {
+  if (adc.running) {
+    adcConvert();
+    adc.running = false;
+    adc.runTime += virtualTime - adc.startTime;
+  }
+  return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t* buffer, uint32_t length, uint32_t* lengthRead, uint32_t timeout) {
+  uint32_t count = min(length, adc.blockBytes) / SOC_ADC_DIGI_RESULT_BYTES;
+  uint64_t deadline = virtualTime + (uint64_t)timeout * 1000;
+  adc_digi_output_data_t result;
+
+  // A block is waited for up to <timeout> while conversions are running
+  adcConvert();
+  while (adc.running && adc.pending < count && virtualTime < deadline) {
+    advanceTo(min(deadline, virtualTime + 100));
+    adcConvert();
+  }
+  if (!adc.initialized || count == 0 || adc.pending < count) {
+    *lengthRead = 0;
+    return ESP_ERR_TIMEOUT;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    noiseState = noiseState * 1103515245 + 12345;
+    result.type1.channel = adc.channel;
+    result.type1.data = constrain((int)analogLevels[adc.channel % 10] + (int)((noiseState >> 16) % 7) - 3, 0, 4095);
+    memcpy(buffer + i * SOC_ADC_DIGI_RESULT_BYTES, &result, SOC_ADC_DIGI_RESULT_BYTES);
+  }
+  adc.pending -= count;
+  *lengthRead = count * SOC_ADC_DIGI_RESULT_BYTES;
+  return ESP_OK;
+}
+
+
+// I2C devices
+
+#define HOST_OLED_I2C    0x3c               // I2C address of OLED display
+#define HOST_PCF_I2C     0x20               // I2C address of PCF8574
+
+static uint8_t pcfPort = 0xFF;              // Pins of PCF8574
+static unsigned long oledTransmissions = 0; // I2C transmissions to OLED display
+
+void hostSetPcfPort(uint8_t port) {
+  pcfPort = port;
+}
+
+unsigned long hostOledTransmissions() {
+  return oledTransmissions;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  if (address == HOST_OLED_I2C) {
+    oledTransmissions++;
+    return 0;
+  }
+  return address == HOST_PCF_I2C ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  if (address != HOST_PCF_I2C || quantity == 0) {
+    return 0;
+  }
+  received = pcfPort;
+  return 1;
+}
+
+int TwoWire::read() {
+  int c = received;
+
+  received = -1;
+  return c;
+}
+
+
+// EEPROM
+
+bool EEPROMClass::begin(size_t size) {
+  if (size > HOST_EEPROM_SIZE) {
+    return false;
+  }
+  this->size = size;
+  return true;
+}
+
+
+// Tasks
+/*
+ * Tasks are coroutines: a task runs as soon as it is created or
+ * notified while waiting, until it waits again. So everything runs in
+ * one thread in a reproducible order.
+ */
+
+#define HOST_TASK_STACK 262144              // Stack of a task; unit: bytes
+
+typedef struct {
+  void (*function)(void*);                  // Task function
+  void* parameter;                          // Parameter of task function
+  ucontext_t context;                       // Context of task
+  ucontext_t* resumer;                      // Context to return to when task waits
+  std::vector<char> stack;                  // Stack of task
+  uint32_t notifications;                   // Notifications not taken yet
+  bool waiting;                             // Task waits for notification
+  uint64_t wakeTime;                        // Virtual time delay of task ends; 0 if task isn't delayed; unit: us
+  bool deleted;                             // Task has been deleted or returned
+} hostTask;
+
+static hostTask loopTask = {};              // Task executing setup() and loop()
+static hostTask* currentTask = &loopTask;   // Task running
+static std::vector<hostTask*> tasks;        // Tasks created, except <loopTask>
+
+// Run task until it waits
+static void runTask(hostTask* task) {
+  hostTask* previous = currentTask;
+  ucontext_t here;
+
+  if (task->deleted) {
+    return;
+  }
+  task->resumer = &here;
+  currentTask = task;
+  swapcontext(&here, &task->context);
+  currentTask = previous;
+}
+
+// Return from running task to the one that ran it
+static void suspendTask() {
+  swapcontext(&currentTask->context, currentTask->resumer);
+}
+
+static void startTask() {
+  currentTask->function(currentTask->parameter);
+  currentTask->deleted = true;
+  suspendTask();
+}
+
+BaseType_t xTaskCreate(void (*function)(void*), const char* name, uint32_t stackSize, void* parameter, unsigned int priority, TaskHandle_t* handle) {
+  hostTask* task = new hostTask();
+
+  task->function = function;
+  task->parameter = parameter;
+  task->stack.resize(HOST_TASK_STACK);
+  getcontext(&task->context);
+  task->context.uc_stack.ss_sp = task->stack.data();
+  task->context.uc_stack.ss_size = task->stack.size();
+  task->context.uc_link = NULL;
+  makecontext(&task->context, startTask, 0);
+
+  if (handle != NULL) {
+    *handle = task;
+  }
+  tasks.push_back(task);
+  runTask(task);
+
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*function)(void*), const char* name, uint32_t stackSize, void* parameter, unsigned int priority, TaskHandle_t* handle, BaseType_t core) {
+  return xTaskCreate(function, name, stackSize, parameter, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+  hostTask* task = handle != NULL ? (hostTask*)handle : currentTask;
+
+  task->deleted = true;
+  if (task == currentTask && task != &loopTask) {
+    suspendTask();
+  }
+}
+
+void vTaskDelay(TickType_t ticks) {
+  hostTask* task = currentTask;
+
+  // The loop task advances the virtual clock, other tasks sleep until it has passed their delay
+  if (task == &loopTask) {
+    advanceTo(virtualTime + (uint64_t)ticks * 1000);
+    return;
+  }
+  task->wakeTime = max(virtualTime + (uint64_t)ticks * 1000, (uint64_t)1);
+  while (task->wakeTime != 0) {
+    suspendTask();
+  }
+}
+
+// Resume tasks whose delay has passed
+static void wakeTasks() {
+  for (size_t i = 0; i < tasks.size(); i++) {
+    if (!tasks[i]->deleted && tasks[i]->wakeTime != 0 && tasks[i]->wakeTime <= virtualTime) {
+      tasks[i]->wakeTime = 0;
+      runTask(tasks[i]);
+    }
+  }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return currentTask;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  hostTask* task = currentTask;
+  uint64_t deadline;
+  uint32_t taken;
+
+  if (task != &loopTask) {
+    // Other tasks only wait without timeout
+    while (task->notifications == 0) {
+      task->waiting = true;
+      suspendTask();
+    }
+    task->waiting = false;
+  }
+  else {
+    // The loop task waits in virtual time; events due meanwhile may notify it
+    deadline = virtualTime + (ticks == portMAX_DELAY ? (uint64_t)3600000000 : (uint64_t)ticks * 1000);
+    hostUpdate();
+    while (task->notifications == 0 && virtualTime < deadline) {
+      advanceTo(min(deadline, hostNextEvent()));
+    }
+  }
+
+  taken = task->notifications;
+  if (taken > 0) {
+    task->notifications = clear ? 0 : taken - 1;
+  }
+  return clear ? taken : min(taken, 1u);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+  hostTask* task = (hostTask*)handle;
+
+  task->notifications++;
+  if (task->waiting && task != currentTask) {
+    runTask(task);
+  }
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t handle, BaseType_t* higherPriorityTaskWoken) {
+  xTaskNotifyGive(handle);
+}
+
+
+// WiFi
+
+static struct {
+  bool available = true;                    // Access point is in range
+  unsigned long associateTime = 800;        // Time to associate; unit: ms
+  wl_status_t status = WL_IDLE_STATUS;      // Station state
+  uint64_t associatedAt = 0;                // Virtual time association completes; 0 if not associating; unit: us
+  wifi_ps_type_t sleep = WIFI_PS_MIN_MODEM; // Power save mode
+  std::vector<std::pair<WiFiEventCb, arduino_event_id_t> > handlers;
+                                            // Event handlers
+} wifi;
+
+static void closeSockets();
+
+void hostWiFiSetup(bool available, unsigned long associateTime) {
+  wifi.available = available;
+  wifi.associateTime = associateTime;
+}
+
+void hostWiFiDrop() {
+  wifi.status = WL_CONNECTION_LOST;
+  wifi.associatedAt = 0;
+  closeSockets();
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase) {
+  wifi.status = WL_DISCONNECTED;
+  wifi.associatedAt = wifi.available ? max(virtualTime + wifi.associateTime * (uint64_t)1000, (uint64_t)1) : 0;
+  return wifi.status;
+}
+
+bool WiFiClass::reconnect() {
+  begin(NULL);
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff) {
+  wifi.status = WL_DISCONNECTED;
+  wifi.associatedAt = 0;
+  closeSockets();
+  return true;
+}
+
+wl_status_t WiFiClass::status() {
+  hostUpdate();
+  return wifi.status;
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+  static const uint8_t address[6] = { 0x24, 0x6F, 0x28, 0x0A, 0x0B, 0x0C };
+
+  memcpy(mac, address, sizeof(address));
+  return mac;
+}
+
+IPAddress WiFiClass::localIP() {
+  return wifi.status == WL_CONNECTED ? IPAddress(192, 168, 1, 50) : IPAddress();
+}
+
+int WiFiClass::onEvent(WiFiEventCb handler, arduino_event_id_t event) {
+  wifi.handlers.push_back(std::make_pair(handler, event));
+  return wifi.handlers.size();
+}
+
+bool WiFiClass::setSleep(wifi_ps_type_t mode) {
+  wifi.sleep = mode;
+  return true;
+}
+
+wifi_ps_type_t WiFiClass::getSleep() {
+  return wifi.sleep;
+}
+
+// Complete association if it is due
+static void associate() {
+  if (wifi.associatedAt == 0 || virtualTime < wifi.associatedAt) {
+    return;
+  }
+  wifi.associatedAt = 0;
+  wifi.status = WL_CONNECTED;
+  for (size_t i = 0; i < wifi.handlers.size(); i++) {
+    if (wifi.handlers[i].second == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+      wifi.handlers[i].first(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    }
+  }
+}
+
+
+// IP address
+
+IPAddress::IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  octets[0] = a;
+  octets[1] = b;
+  octets[2] = c;
+  octets[3] = d;
+}
+
+IPAddress::IPAddress(uint32_t address) {
+  memcpy(octets, &address, 4);
+}
+
+bool IPAddress::fromString(const char* text) {
+  unsigned int a, b, c, d;
+  char end;
+
+  if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+    return false;
+  }
+  *this = IPAddress(a, b, c, d);
+  return true;
+}
+
+String IPAddress::toString() const {
+  char text[16];
+
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+  return String(text);
+}
+
+IPAddress::operator uint32_t() const {
+  uint32_t address;
+
+  memcpy(&address, octets, 4);
+  return address;
+}
+
+size_t IPAddress::printTo(Print &out) const {
+  return out.print(toString());
+}
+
+
+// WiThrottle servers
+
+#define HOST_FD_BASE       60               // First socket number
+
+#define SOCKET_CONNECTING   0               // Connection is being established
+#define SOCKET_CONNECTED    1               // Connection established
+#define SOCKET_FAILED       2               // Connection refused or broken
+
+typedef struct {
+  uint32_t ip;                              // IP address of WiThrottle server
+  uint16_t port;                            // Port of WiThrottle server
+  HostPeer* peer;                           // WiThrottle server; NULL refuses connections
+  unsigned long connectTime;                // Time to establish a connection; unit: ms
+} hostListener;
+
+typedef struct {
+  uint64_t time;                            // Virtual time data arrives; unit: us
+  std::string data;                         // Data
+} hostChunk;
+
+typedef struct {
+  bool open;                                // Socket is open on WiThrottle's side
+  int flags;                                // File status flags, e. g. O_NONBLOCK
+  int state;                                // State of connection
+  uint64_t readyAt;                         // Virtual time connection is established or refused; unit: us
+  HostPeer* peer;                           // WiThrottle server connected to
+  std::deque<hostChunk> received;           // Data sent by WiThrottle server
+  uint64_t closedAt;                        // Virtual time WiThrottle server closes connection; UINT64_MAX if open; unit: us
+} hostSocket;
+
+static std::vector<hostListener> listeners; // WiThrottle servers
+static std::vector<hostSocket> sockets;     // Sockets by number - HOST_FD_BASE
+static bool announced = false;              // A WiThrottle server answers mDNS queries
+static IPAddress announcedIP;               // IP address answering mDNS queries
+static uint16_t announcedPort;              // Port answering mDNS queries
+static unsigned long queryTime = 0;         // Time an mDNS query takes; unit: ms
+
+static hostSocket* socketAt(int fd) {
+  if (fd < HOST_FD_BASE || fd - HOST_FD_BASE >= (int)sockets.size() || !sockets[fd - HOST_FD_BASE].open) {
+    return NULL;
+  }
+  return &sockets[fd - HOST_FD_BASE];
+}
+
+void hostListen(IPAddress ip, uint16_t port, HostPeer* peer, unsigned long connectTime) {
+  for (size_t i = 0; i < listeners.size(); i++) {
+    if (listeners[i].ip == (uint32_t)ip && listeners[i].port == port) {
+      listeners[i].peer = peer;
+      listeners[i].connectTime = connectTime;
+      return;
+    }
+  }
+  listeners.push_back({ (uint32_t)ip, port, peer, connectTime });
+}
+
+void hostAnnounce(IPAddress ip, uint16_t port, unsigned long queryTime) {
+  announced = true;
+  announcedIP = ip;
+  announcedPort = port;
+  ::queryTime = queryTime;
+}
+
+void hostWithdraw() {
+  announced = false;
+}
+
+void hostCloseAll() {
+  for (size_t i = 0; i < sockets.size(); i++) {
+    if (sockets[i].open && sockets[i].state == SOCKET_CONNECTED) {
+      sockets[i].closedAt = min(sockets[i].closedAt, virtualTime);
+    }
+  }
+}
+
+// Break all connections, e. g. after WiFi has been lost
+static void closeSockets() {
+  for (size_t i = 0; i < sockets.size(); i++) {
+    if (sockets[i].open) {
+      sockets[i].state = SOCKET_FAILED;
+      sockets[i].closedAt = min(sockets[i].closedAt, virtualTime);
+      sockets[i].received.clear();
+    }
+  }
+}
+
+void HostConnection::send(const std::string &data, unsigned long latency) {
+  hostSocket* socket = socketAt(fd);
+  uint64_t time = virtualTime + latency * (uint64_t)1000;
+
+  if (socket == NULL || socket->state != SOCKET_CONNECTED || socket->closedAt != UINT64_MAX) {
+    return;
+  }
+
+  // Data arrives in the order it has been sent
+  if (!socket->received.empty()) {
+    time = max(time, socket->received.back().time);
+  }
+  socket->received.push_back({ time, data });
+}
+
+void HostConnection::close(unsigned long latency) {
+  hostSocket* socket = socketAt(fd);
+
+  if (socket != NULL) {
+    socket->closedAt = min(socket->closedAt, virtualTime + latency * (uint64_t)1000);
+  }
+}
+
+// Establish or refuse connections that are due
+static void establish() {
+  for (size_t i = 0; i < sockets.size(); i++) {
+    hostSocket &socket = sockets[i];
+
+    if (socket.open && socket.state == SOCKET_CONNECTING && virtualTime >= socket.readyAt) {
+      if (socket.peer != NULL && wifi.status == WL_CONNECTED) {
+        socket.state = SOCKET_CONNECTED;
+        socket.peer->accepted(HostConnection { (int)i + HOST_FD_BASE });
+      }
+      else {
+        socket.state = SOCKET_FAILED;
+      }
+    }
+  }
+}
+
+// Get bytes arrived on socket
+static size_t arrived(const hostSocket &socket) {
+  size_t count = 0;
+
+  for (size_t i = 0; i < socket.received.size() && socket.received[i].time <= virtualTime; i++) {
+    count += socket.received[i].data.size();
+  }
+  return count;
+}
+
+int lwip_socket(int domain, int type, int protocol) {
+  hostSocket socket;
+
+  socket.open = true;
+  socket.flags = 0;
+  socket.state = SOCKET_FAILED;
+  socket.readyAt = 0;
+  socket.peer = NULL;
+  socket.closedAt = UINT64_MAX;
+  sockets.push_back(socket);
+
+  return sockets.size() - 1 + HOST_FD_BASE;
+}
+
+int lwip_connect(int fd, const struct sockaddr* address, socklen_t length) {
+  hostSocket* socket = socketAt(fd);
+  const struct sockaddr_in* target = (const struct sockaddr_in*)address;
+  unsigned long connectTime = 1;            // Time until connection is refused without listener; unit: ms
+
+  if (socket == NULL) {
+    errno = EBADF;
+    return -1;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    errno = EHOSTUNREACH;
+    return -1;
+  }
+
+  for (size_t i = 0; i < listeners.size(); i++) {
+    if (listeners[i].ip == target->sin_addr.s_addr && listeners[i].port == ntohs(target->sin_port)) {
+      socket->peer = listeners[i].peer;
+      connectTime = listeners[i].connectTime;
+    }
+  }
+  socket->state = SOCKET_CONNECTING;
+  socket->readyAt = virtualTime + connectTime * (uint64_t)1000;
+
+  // A blocking socket waits for the connection
+  if ((socket->flags & O_NONBLOCK) == 0) {
+    advanceTo(socket->readyAt);
+    if (socket->state != SOCKET_CONNECTED) {
+      errno = ECONNREFUSED;
+      return -1;
+    }
+    return 0;
+  }
+
+  errno = EINPROGRESS;
+  return -1;
+}
+
+int lwip_select(int count, fd_set* readable, fd_set* writable, fd_set* failed, struct timeval* timeout) {
+  uint64_t deadline = timeout == NULL ? UINT64_MAX : virtualTime + timeout->tv_sec * (uint64_t)1000000 + timeout->tv_usec;
+  fd_set readableIn;
+  fd_set writableIn;
+  hostSocket* socket;
+  int ready;
+
+  FD_ZERO(&readableIn);
+  FD_ZERO(&writableIn);
+  if (readable != NULL) {
+    readableIn = *readable;
+  }
+  if (writable != NULL) {
+    writableIn = *writable;
+  }
+  if (failed != NULL) {
+    FD_ZERO(failed);
+  }
+
+  while (true) {
+    hostUpdate();
+    ready = 0;
+    if (readable != NULL) {
+      FD_ZERO(readable);
+    }
+    if (writable != NULL) {
+      FD_ZERO(writable);
+    }
+
+    for (int fd = HOST_FD_BASE; fd < count; fd++) {
+      socket = socketAt(fd);
+      if (socket == NULL) {
+        continue;
+      }
+      if (FD_ISSET(fd, &readableIn) && (arrived(*socket) > 0 || socket->state == SOCKET_FAILED || virtualTime >= socket->closedAt)) {
+        FD_SET(fd, readable);
+        ready++;
+      }
+      if (FD_ISSET(fd, &writableIn) && socket->state != SOCKET_CONNECTING) {
+        FD_SET(fd, writable);
+        ready++;
+      }
+    }
+
+    if (ready > 0 || virtualTime >= deadline) {
+      return ready;
+    }
+    advanceTo(min(deadline, hostNextEvent()));
+  }
+}
+
+int lwip_getsockopt(int fd, int level, int option, void* value, socklen_t* length) {
+  hostSocket* socket = socketAt(fd);
+
+  if (socket == NULL) {
+    errno = EBADF;
+    return -1;
+  }
+  if (level == SOL_SOCKET && option == SO_ERROR) {
+    *(int*)value = socket->state == SOCKET_FAILED ? ECONNREFUSED : 0;
+  }
+  return 0;
+}
+
+ssize_t lwip_recv(int fd, void* data, size_t size, int flags) {
+  hostSocket* socket = socketAt(fd);
+  size_t count = 0;
+  size_t part;
+
+  if (socket == NULL) {
+    errno = EBADF;
+    return -1;
+  }
+  hostUpdate();
+
+  while (count < size && !socket->received.empty() && socket->received.front().time <= virtualTime) {
+    hostChunk &chunk = socket->received.front();
+
+    part = min(size - count, chunk.data.size());
+    memcpy((char*)data + count, chunk.data.data(), part);
+    count += part;
+    if (flags & MSG_PEEK) {
+      break;
+    }
+    chunk.data.erase(0, part);
+    if (chunk.data.empty()) {
+      socket->received.pop_front();
+    }
+  }
+
+  if (count > 0) {
+    return count;
+  }
+  if (socket->state == SOCKET_FAILED || virtualTime >= socket->closedAt) {
+    return 0;
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+ssize_t lwip_send(int fd, const void* data, size_t size, int flags) {
+  hostSocket* socket = socketAt(fd);
+
+  if (socket == NULL || socket->state != SOCKET_CONNECTED || virtualTime >= socket->closedAt) {
+    errno = EPIPE;
+    return -1;
+  }
+  if (socket->peer != NULL) {
+    socket->peer->received(HostConnection { fd }, (const char*)data, size);
+  }
+  return size;
+}
+
+int lwip_close(int fd) {
+  hostSocket* socket = socketAt(fd);
+
+  if (socket == NULL) {
+    errno = EBADF;
+    return -1;
+  }
+  socket->open = false;
+  socket->received.clear();
+  if (socket->state == SOCKET_CONNECTED && socket->peer != NULL) {
+    socket->peer->closed(HostConnection { fd });
+  }
+  return 0;
+}
+
+int lwip_fcntl(int fd, int command, int value) {
+  hostSocket* socket = socketAt(fd);
+
+  if (socket == NULL) {
+    errno = EBADF;
+    return -1;
+  }
+  if (command == F_GETFL) {
+    return socket->flags;
+  }
+  if (command == F_SETFL) {
+    socket->flags = value;
+  }
+  return 0;
+}
+
+
+// TCP client
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  struct sockaddr_in address;
+
+  stop();
+  fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = (uint32_t)ip;
+  address.sin_port = htons(port);
+  if (lwip_connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+    stop();
+    return 0;
+  }
+  return 1;
+}
+
+uint8_t WiFiClient::connected() {
+  hostSocket* socket = socketAt(fd);
+
+  if (socket == NULL) {
+    return false;
+  }
+  hostUpdate();
+  return arrived(*socket) > 0 || (socket->state == SOCKET_CONNECTED && virtualTime < socket->closedAt);
+}
+
+void WiFiClient::stop() {
+  if (socketAt(fd) != NULL) {
+    lwip_close(fd);
+  }
+  fd = -1;
+}
+
+size_t WiFiClient::write(const uint8_t* data, size_t length) {
+  ssize_t written = lwip_send(fd, data, length, 0);
+
+  return written < 0 ? 0 : written;
+}
+
+int WiFiClient::available() {
+  hostSocket* socket = socketAt(fd);
+
+  if (socket == NULL) {
+    return 0;
+  }
+  hostUpdate();
+  return arrived(*socket);
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* data, size_t size) {
+  if (socketAt(fd) == NULL) {
+    return -1;
+  }
+  return lwip_recv(fd, data, size, 0);
+}
+
+int WiFiClient::peek() {
+  uint8_t c;
+
+  return socketAt(fd) != NULL && lwip_recv(fd, &c, 1, MSG_PEEK) == 1 ? c : -1;
+}
+
+
+// mDNS
+
+#define HOST_MDNS_TIMEOUT 3000              // Time an mDNS query without answer takes; unit: ms
+
+int MDNSResponder::queryService(const char* service, const char* protocol) {
+  // The query blocks until a WiThrottle server answers or it times out
+  vTaskDelay(pdMS_TO_TICKS(announced ? queryTime : HOST_MDNS_TIMEOUT));
+  return announced ? 1 : 0;
+}
+
+IPAddress MDNSResponder::IP(int index) {
+  return announcedIP;
+}
+
+uint16_t MDNSResponder::port(int index) {
+  return announcedPort;
+}
+
+
+// Events
+
+void hostUpdate() {
+  static bool updating = false;             // Events are being applied; interrupt service routines may read pins
+
+  if (updating) {
+    return;
+  }
+  updating = true;
+
+  while (!pinEvents.empty() && pinEvents.begin()->first <= virtualTime) {
+    std::pair<uint8_t, int> event = pinEvents.begin()->second;
+
+    pinEvents.erase(pinEvents.begin());
+    hostSetPin(event.first, event.second);
+  }
+  associate();
+  establish();
+  wakeTasks();
+
+  updating = false;
+}
+
+uint64_t hostNextEvent() {
+  uint64_t next = UINT64_MAX;
+
+  if (!pinEvents.empty()) {
+    next = min(next, pinEvents.begin()->first);
+  }
+  if (wifi.associatedAt != 0) {
+    next = min(next, wifi.associatedAt);
+  }
+  for (size_t i = 0; i < tasks.size(); i++) {
+    if (!tasks[i]->deleted && tasks[i]->wakeTime != 0) {
+      next = min(next, tasks[i]->wakeTime);
+    }
+  }
+  for (size_t i = 0; i < sockets.size(); i++) {
+    if (!sockets[i].open) {
+      continue;
+    }
+    if (sockets[i].state == SOCKET_CONNECTING) {
+      next = min(next, sockets[i].readyAt);
+    }
+    if (!sockets[i].received.empty()) {
+      next = min(next, sockets[i].received.front().time);
+    }
+    next = min(next, sockets[i].closedAt);
+  }
+
+  // Events in the past are due at once
+  return max(next, virtualTime);
+}
@@ -0,0 +1,44 @@
+/*
+ * Declaration of the emulated EEPROM for host builds
+ *
+ * The emulated flash starts erased (0xFF) and survives as long as the
+ * process; Host.h can inspect it and count commits.
+ */
+
+#ifndef _HOST_EEPROM_H_
+#define _HOST_EEPROM_H_
+
+#include <Arduino.h>
+
+
+#define HOST_EEPROM_SIZE 4096               // Size of emulated flash
+
+class EEPROMClass {
+  public:
+    uint8_t data[HOST_EEPROM_SIZE];         // Contents
+    size_t size = 0;                        // Size requested by begin()
+    unsigned long commits = 0;              // Number of commits, i. e. flash writes
+
+    EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+
+    bool begin(size_t size);
+    uint8_t read(int address) { return data[address]; }
+    void write(int address, uint8_t value) { data[address] = value; }
+    bool commit() { commits++; return true; }
+    size_t length() { return size; }
+
+    template <typename T>
+    T &get(int address, T &value) {
+      memcpy(&value, data + address, sizeof(T));
+      return value;
+    }
+
+    template <typename T>
+    const T &put(int address, const T &value) {
+      memcpy(data + address, &value, sizeof(T));
+      return value;
+    }
+};
+
+extern EEPROMClass EEPROM;
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Declaration of the emulated mDNS responder for host builds
+ *
+ * A query finds the WiThrottle server announced by hostAnnounce().
+ */
+
+#ifndef _HOST_ESPMDNS_H_
+#define _HOST_ESPMDNS_H_
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <string>
+
+
+class MDNSResponder {
+  public:
+    std::string hostname;                   // Host name the responder has been started with
+
+    bool begin(const char* hostname) { this->hostname = hostname; return true; }
+    int queryService(const char* service, const char* protocol);
+    IPAddress IP(int index);
+    uint16_t port(int index);
+};
+
+extern MDNSResponder MDNS;
+#endif
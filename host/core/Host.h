@@ -0,0 +1,82 @@
+/*
+ * Declaration of the controls of the emulated core for host builds
+ *
+ * Tests drive the emulated hardware and network from here: pins and
+ * potentiometer, port expander, serial monitor, WiFi association and
+ * the WiThrottle servers sockets connect to. Everything happens in
+ * virtual time (see Clock.h): events are scheduled at a virtual time and
+ * take effect as soon as the clock has passed it and the sketch looks,
+ * or the test calls hostUpdate().
+ */
+
+#ifndef _HOST_H_
+#define _HOST_H_
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <WiFi.h>
+#include <string>
+
+
+// Virtual clock
+uint64_t hostTime();                        // Virtual time without advancing it; unit: us
+void hostUpdate();                          // Apply all events due at the virtual time
+uint64_t hostNextEvent();                   // Virtual time of next scheduled event; UINT64_MAX if none; unit: us
+
+// Pins
+void hostSetPin(uint8_t pin, int level);    // Drive input pin now; interrupt service routines attached are called
+void hostSetPinAt(uint8_t pin, int level, uint64_t time);
+                                            // Drive input pin at virtual time <time>; unit: us
+int hostGetPin(uint8_t pin);                // Get level of pin, e. g. of an LED
+
+// ADC
+void hostSetAnalog(uint8_t pin, uint16_t value);
+                                            // Set level converted by ADC; 0 to 4095
+uint64_t hostAdcRunTime();                  // Time ADC continuous mode has been running; unit: us
+unsigned long hostAdcStarts();              // Number of times ADC continuous mode has been started
+
+// I2C devices
+void hostSetPcfPort(uint8_t port);          // Set pins of PCF8574; LOW = pressed
+unsigned long hostOledTransmissions();      // Number of I2C transmissions to OLED display
+
+// Serial monitor
+std::string &hostSerialOutput();            // Everything written to serial monitor so far
+void hostSerialEcho(bool echo);             // Also write serial output to stdout
+void hostSerialInput(const char* text);     // Type text on serial monitor
+
+// WiFi
+void hostWiFiSetup(bool available, unsigned long associateTime);
+                                            // Set if access point is in range and time to associate; unit: ms
+void hostWiFiDrop();                        // Lose association, e. g. out of range; all connections break
+
+// WiThrottle servers
+class HostConnection {
+  public:
+    int fd;                                 // Socket of WiThrottle on the other end
+
+    void send(const std::string &data, unsigned long latency = 0);
+                                            // Send data arriving after <latency>; may hold any byte; unit: ms
+    void close(unsigned long latency = 0);  // Close connection after <latency>; unit: ms
+};
+
+class HostPeer {
+  public:
+    virtual ~HostPeer() {}
+    virtual void accepted(HostConnection connection) {}
+                                            // Connection has been established
+    virtual void received(HostConnection connection, const char* data, size_t length) {}
+                                            // WiThrottle wrote data
+    virtual void closed(HostConnection connection) {}
+                                            // WiThrottle closed connection
+};
+
+void hostListen(IPAddress ip, uint16_t port, HostPeer* peer, unsigned long connectTime);
+                                            // Accept connections after <connectTime>; peer NULL refuses; unit: ms
+void hostAnnounce(IPAddress ip, uint16_t port, unsigned long queryTime = 0);
+                                            // Answer mDNS queries with WiThrottle server after <queryTime>; unit: ms
+void hostWithdraw();                        // Stop answering mDNS queries; queries time out
+void hostCloseAll();                        // Close all connections from the servers' side
+
+// Sleep
+struct hostDeepSleep {};                    // Thrown by esp_deep_sleep_start()
+#endif
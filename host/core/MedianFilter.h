@@ -0,0 +1,41 @@
+/*
+ * Declaration of the median filter for host builds
+ *
+ * Same interface and behaviour as https://github.com/daPhoosa/MedianFilter:
+ * in() adds a value to the window and returns the median of the window.
+ */
+
+#ifndef _HOST_MEDIAN_FILTER_H_
+#define _HOST_MEDIAN_FILTER_H_
+
+#include <Arduino.h>
+#include <vector>
+
+
+class MedianFilter {
+  private:
+    std::vector<int> window;                // Last values, oldest first
+    unsigned int next = 0;                  // Position of oldest value
+
+  public:
+    MedianFilter(int size, int seed) : window(size, seed) {}
+
+    int in(int value) {
+      std::vector<int> sorted;              // Values of window sorted
+
+      window[next] = value;
+      next = (next + 1) % window.size();
+      sorted = window;
+      std::sort(sorted.begin(), sorted.end());
+
+      return sorted[sorted.size() / 2];
+    }
+
+    int out() {
+      std::vector<int> sorted = window;     // Values of window sorted
+
+      std::sort(sorted.begin(), sorted.end());
+      return sorted[sorted.size() / 2];
+    }
+};
+#endif
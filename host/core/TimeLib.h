@@ -0,0 +1,16 @@
+/*
+ * Declaration of the parts of https://github.com/PaulStoffregen/Time used
+ * by the sketch, for host builds
+ */
+
+#ifndef _HOST_TIME_LIB_H_
+#define _HOST_TIME_LIB_H_
+
+#include <Arduino.h>
+#include <time.h>
+
+
+inline int hour(time_t t) { return (t / 3600) % 24; }
+inline int minute(time_t t) { return (t / 60) % 60; }
+inline int second(time_t t) { return t % 60; }
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Declaration of the emulated WiFi for host builds
+ *
+ * The station associates after a delay set by Host.h. Sockets connect
+ * to the WiThrottle servers listening in the same process (see Host.h
+ * and lwip/sockets.h).
+ */
+
+#ifndef _HOST_WIFI_H_
+#define _HOST_WIFI_H_
+
+#include <Arduino.h>
+
+
+// IP address
+class IPAddress : public Printable {
+  private:
+    uint8_t octets[4];                      // Octets in network order
+
+  public:
+    // Constructors
+    IPAddress() : IPAddress(0, 0, 0, 0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d);
+    IPAddress(uint32_t address);            // Address in network byte order, as in sin_addr
+
+    // Conversion
+    bool fromString(const char* text);
+    bool fromString(const String &text) { return fromString(text.c_str()); }
+    String toString() const;
+    operator uint32_t() const;              // Address in network byte order, as in sin_addr
+    uint8_t operator[](int index) const { return octets[index]; }
+    uint8_t &operator[](int index) { return octets[index]; }
+    size_t printTo(Print &out) const;
+
+    // Comparison
+    bool operator==(const IPAddress &other) const { return memcmp(octets, other.octets, 4) == 0; }
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+};
+
+
+// WiFi
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_PS_NONE,
+  WIFI_PS_MIN_MODEM,
+  WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7
+} arduino_event_id_t;
+
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+
+class WiFiClass {
+  public:
+    // Connection
+    wl_status_t begin(const char* ssid, const char* passphrase = NULL);
+    bool reconnect();
+    bool disconnect(bool wifiOff = false);
+    wl_status_t status();
+    bool setHostname(const char* hostname) { return true; }
+    uint8_t* macAddress(uint8_t* mac);
+    IPAddress localIP();
+
+    // Events
+    int onEvent(WiFiEventCb handler, arduino_event_id_t event);
+
+    // Power save
+    bool setSleep(bool enabled) { return setSleep(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE); }
+    bool setSleep(wifi_ps_type_t mode);
+    wifi_ps_type_t getSleep();
+};
+
+extern WiFiClass WiFi;
+
+
+// TCP client on an emulated socket
+/*
+ * Copies refer to the same socket; the socket is only closed by stop().
+ */
+class WiFiClient : public Stream {
+  private:
+    int fd = -1;                            // Socket; -1 if not connected
+
+  public:
+    // Constructors
+    WiFiClient() {}
+    WiFiClient(int fd) : fd(fd) {}
+
+    // Connection
+    int connect(IPAddress ip, uint16_t port);
+    uint8_t connected();
+    void stop();
+    int setNoDelay(bool noDelay) { return 0; }
+    operator bool() { return connected(); }
+
+    // Transfer
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t length);
+    using Print::write;
+    int available();
+    int read();
+    int read(uint8_t* data, size_t size);
+    int peek();
+};
+#endif
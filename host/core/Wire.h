@@ -0,0 +1,39 @@
+/*
+ * Declaration of the emulated I2C bus for host builds
+ *
+ * Devices are attached by Host.h: the OLED display accepts everything,
+ * the PCF8574 answers with the port state set by the test.
+ */
+
+#ifndef _HOST_WIRE_H_
+#define _HOST_WIRE_H_
+
+#include <Arduino.h>
+
+
+class TwoWire : public Stream {
+  private:
+    uint8_t address = 0;                    // Device of actual transmission
+    int received = -1;                      // Byte requested from device; -1 if none
+
+  public:
+    // Bus
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+    bool setClock(uint32_t frequency) { return true; }
+
+    // Write
+    void beginTransmission(uint8_t address) { this->address = address; }
+    uint8_t endTransmission(bool sendStop = true);
+    size_t write(uint8_t c) { return 1; }
+    size_t write(const uint8_t* data, size_t length) { return length; }
+    using Print::write;
+
+    // Read
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    int available() { return received >= 0; }
+    int read();
+    int peek() { return received; }
+};
+
+extern TwoWire Wire;
+#endif
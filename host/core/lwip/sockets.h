@@ -0,0 +1,40 @@
+/*
+ * Declaration of the emulated lwIP sockets for host builds
+ *
+ * As lwIP does with LWIP_COMPAT_SOCKETS, the POSIX names are mapped to
+ * lwip_ functions, which work on sockets connected to the WiThrottle
+ * servers listening in the same process. Types and constants are the
+ * host's.
+ */
+
+#ifndef _HOST_LWIP_SOCKETS_H_
+#define _HOST_LWIP_SOCKETS_H_
+
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+int lwip_socket(int domain, int type, int protocol);
+int lwip_connect(int fd, const struct sockaddr* address, socklen_t length);
+int lwip_select(int count, fd_set* readable, fd_set* writable, fd_set* failed, struct timeval* timeout);
+int lwip_getsockopt(int fd, int level, int option, void* value, socklen_t* length);
+ssize_t lwip_recv(int fd, void* data, size_t size, int flags);
+ssize_t lwip_send(int fd, const void* data, size_t size, int flags);
+int lwip_close(int fd);
+int lwip_fcntl(int fd, int command, int value);
+
+#define socket(domain, type, protocol) lwip_socket(domain, type, protocol)
+#define connect(fd, address, length) lwip_connect(fd, address, length)
+#define select(count, readable, writable, failed, timeout) lwip_select(count, readable, writable, failed, timeout)
+#define getsockopt(fd, level, option, value, length) lwip_getsockopt(fd, level, option, value, length)
+#define recv(fd, data, size, flags) lwip_recv(fd, data, size, flags)
+#define send(fd, data, size, flags) lwip_send(fd, data, size, flags)
+#define close(fd) lwip_close(fd)
+#define fcntl(fd, command, value) lwip_fcntl(fd, command, value)
+#endif